@@ -0,0 +1,228 @@
+#include "BCEncoder.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace
+{
+
+u16 PackRGB565(const f32* color)
+{
+    u32 r = static_cast<u32>(std::lround(std::clamp(color[0], 0.0f, 255.0f) * 31.0f / 255.0f));
+    u32 g = static_cast<u32>(std::lround(std::clamp(color[1], 0.0f, 255.0f) * 63.0f / 255.0f));
+    u32 b = static_cast<u32>(std::lround(std::clamp(color[2], 0.0f, 255.0f) * 31.0f / 255.0f));
+    return static_cast<u16>((r << 11) | (g << 5) | b);
+}
+
+void UnpackRGB565(u16 packed, i32* color)
+{
+    i32 r = (packed >> 11) & 31;
+    i32 g = (packed >> 5) & 63;
+    i32 b = packed & 31;
+    color[0] = (r << 3) | (r >> 2);
+    color[1] = (g << 2) | (g >> 4);
+    color[2] = (b << 3) | (b >> 2);
+}
+
+// Range fit: endpoints are the extremes of the block's colors projected onto their principal axis,
+// inset slightly to reduce the error of the interpolated entries.
+void EncodeColorBlock(const u8* block_rgba, u8* out)
+{
+    f32 mean[3] = {0.0f, 0.0f, 0.0f};
+    for (u32 i = 0; i < 16; i++) {
+        for (u32 c = 0; c < 3; c++)
+            mean[c] += block_rgba[i * 4 + c];
+    }
+    for (u32 c = 0; c < 3; c++)
+        mean[c] /= 16.0f;
+
+    f32 cov[6] = {0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f};
+    for (u32 i = 0; i < 16; i++) {
+        f32 r = block_rgba[i * 4 + 0] - mean[0];
+        f32 g = block_rgba[i * 4 + 1] - mean[1];
+        f32 b = block_rgba[i * 4 + 2] - mean[2];
+        cov[0] += r * r;
+        cov[1] += r * g;
+        cov[2] += r * b;
+        cov[3] += g * g;
+        cov[4] += g * b;
+        cov[5] += b * b;
+    }
+
+    // power iteration for the principal axis
+    f32 axis[3] = {1.0f, 1.0f, 1.0f};
+    for (u32 iter = 0; iter < 8; iter++) {
+        f32 x = cov[0] * axis[0] + cov[1] * axis[1] + cov[2] * axis[2];
+        f32 y = cov[1] * axis[0] + cov[3] * axis[1] + cov[4] * axis[2];
+        f32 z = cov[2] * axis[0] + cov[4] * axis[1] + cov[5] * axis[2];
+        f32 len = std::max(std::max(std::fabs(x), std::fabs(y)), std::fabs(z));
+        if (len < 1e-6f)
+            break;
+        axis[0] = x / len;
+        axis[1] = y / len;
+        axis[2] = z / len;
+    }
+
+    f32 min_proj = 1e30f;
+    f32 max_proj = -1e30f;
+    for (u32 i = 0; i < 16; i++) {
+        f32 proj = (block_rgba[i * 4 + 0] - mean[0]) * axis[0] + (block_rgba[i * 4 + 1] - mean[1]) * axis[1] +
+                   (block_rgba[i * 4 + 2] - mean[2]) * axis[2];
+        min_proj = std::min(min_proj, proj);
+        max_proj = std::max(max_proj, proj);
+    }
+
+    f32 axis_len_sq = axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2];
+    f32 inset = (max_proj - min_proj) / 16.0f;
+    f32 lo = axis_len_sq > 0.0f ? (min_proj + inset) / axis_len_sq : 0.0f;
+    f32 hi = axis_len_sq > 0.0f ? (max_proj - inset) / axis_len_sq : 0.0f;
+
+    f32 end0[3], end1[3];
+    for (u32 c = 0; c < 3; c++) {
+        end0[c] = mean[c] + axis[c] * hi;
+        end1[c] = mean[c] + axis[c] * lo;
+    }
+
+    u16 c0 = PackRGB565(end0);
+    u16 c1 = PackRGB565(end1);
+    // four-color mode needs c0 > c1
+    if (c0 < c1)
+        std::swap(c0, c1);
+
+    u32 indices = 0;
+    if (c0 != c1) {
+        i32 palette[4][3];
+        UnpackRGB565(c0, palette[0]);
+        UnpackRGB565(c1, palette[1]);
+        for (u32 c = 0; c < 3; c++) {
+            palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+            palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+        }
+
+        for (u32 i = 0; i < 16; i++) {
+            u32 best = 0;
+            i32 best_dist = 0x7fffffff;
+            for (u32 p = 0; p < 4; p++) {
+                i32 dr = block_rgba[i * 4 + 0] - palette[p][0];
+                i32 dg = block_rgba[i * 4 + 1] - palette[p][1];
+                i32 db = block_rgba[i * 4 + 2] - palette[p][2];
+                i32 dist = dr * dr + dg * dg + db * db;
+                if (dist < best_dist) {
+                    best_dist = dist;
+                    best = p;
+                }
+            }
+            indices |= best << (i * 2);
+        }
+    }
+
+    out[0] = static_cast<u8>(c0 & 0xff);
+    out[1] = static_cast<u8>(c0 >> 8);
+    out[2] = static_cast<u8>(c1 & 0xff);
+    out[3] = static_cast<u8>(c1 >> 8);
+    std::memcpy(out + 4, &indices, 4);
+}
+
+void ExtractBlock(u32 width, u32 height, const u8* rgba, u32 bx, u32 by, u8* block)
+{
+    for (u32 y = 0; y < 4; y++) {
+        u32 sy = std::min(by * 4 + y, height - 1);
+        for (u32 x = 0; x < 4; x++) {
+            u32 sx = std::min(bx * 4 + x, width - 1);
+            std::memcpy(block + (y * 4 + x) * 4, rgba + (static_cast<u64>(sy) * width + sx) * 4, 4);
+        }
+    }
+}
+
+} // namespace
+
+u32 BCEncoder::GetBlockSize(Format format)
+{
+    return format == BC1 ? 8 : 16;
+}
+
+void BCEncoder::CompressImage(Format format, u32 width, u32 height, const u8* rgba, std::vector<u8>& out)
+{
+    u32 blocks_x = (width + 3) / 4;
+    u32 blocks_y = (height + 3) / 4;
+    u32 block_size = GetBlockSize(format);
+    out.resize(static_cast<u64>(blocks_x) * blocks_y * block_size);
+
+    u8 block[64];
+    u8* dst = out.data();
+    for (u32 by = 0; by < blocks_y; by++) {
+        for (u32 bx = 0; bx < blocks_x; bx++) {
+            ExtractBlock(width, height, rgba, bx, by, block);
+            switch (format) {
+            case BC1:
+                EncodeBC1Block(block, dst);
+                break;
+            case BC3:
+                EncodeBC3Block(block, dst);
+                break;
+            case BC5:
+                EncodeBC5Block(block, dst);
+                break;
+            }
+            dst += block_size;
+        }
+    }
+}
+
+void BCEncoder::EncodeBC1Block(const u8* block_rgba, u8* out)
+{
+    EncodeColorBlock(block_rgba, out);
+}
+
+void BCEncoder::EncodeBC3Block(const u8* block_rgba, u8* out)
+{
+    EncodeBC4Block(block_rgba + 3, out);
+    EncodeColorBlock(block_rgba, out + 8);
+}
+
+void BCEncoder::EncodeBC5Block(const u8* block_rgba, u8* out)
+{
+    EncodeBC4Block(block_rgba + 0, out);
+    EncodeBC4Block(block_rgba + 1, out + 8);
+}
+
+void BCEncoder::EncodeBC4Block(const u8* block_rgba, u8* out)
+{
+    u8 lo = 255;
+    u8 hi = 0;
+    for (u32 i = 0; i < 16; i++) {
+        lo = std::min(lo, block_rgba[i * 4]);
+        hi = std::max(hi, block_rgba[i * 4]);
+    }
+
+    // eight-value mode: a0 > a1 with six interpolated values in between
+    out[0] = hi;
+    out[1] = lo;
+
+    u64 indices = 0;
+    if (hi != lo) {
+        i32 palette[8];
+        palette[0] = hi;
+        palette[1] = lo;
+        for (i32 i = 2; i < 8; i++)
+            palette[i] = ((8 - i) * hi + (i - 1) * lo) / 7;
+
+        for (u32 i = 0; i < 16; i++) {
+            i32 value = block_rgba[i * 4];
+            u64 best = 0;
+            i32 best_dist = 256;
+            for (u32 p = 0; p < 8; p++) {
+                i32 dist = std::abs(value - palette[p]);
+                if (dist < best_dist) {
+                    best_dist = dist;
+                    best = p;
+                }
+            }
+            indices |= best << (i * 3);
+        }
+    }
+
+    for (u32 i = 0; i < 6; i++)
+        out[2 + i] = static_cast<u8>((indices >> (i * 8)) & 0xff);
+}
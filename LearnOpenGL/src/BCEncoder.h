@@ -0,0 +1,30 @@
+#pragma once
+
+#include "defines.h"
+
+#include <vector>
+
+// CPU encoders for the BC1 (DXT1), BC3 (DXT5) and BC5 (RGTC2) block compression formats.
+// All functions take tightly packed 8-bit RGBA images.
+class BCEncoder
+{
+public:
+    enum Format
+    {
+        BC1,
+        BC3,
+        BC5
+    };
+
+    // encoded size of one 4x4 block
+    static u32 GetBlockSize(Format format);
+
+    // Compresses a whole image. Edge blocks of images that are not a multiple of 4 repeat the last row/column.
+    static void CompressImage(Format format, u32 width, u32 height, const u8* rgba, std::vector<u8>& out);
+
+    static void EncodeBC1Block(const u8* block_rgba, u8* out);
+    static void EncodeBC3Block(const u8* block_rgba, u8* out);
+    static void EncodeBC5Block(const u8* block_rgba, u8* out);
+    // single channel block, reading every 4th byte starting at block_rgba
+    static void EncodeBC4Block(const u8* block_rgba, u8* out);
+};
@@ -0,0 +1,51 @@
+#pragma once
+
+#include "defines.h"
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+
+// Axis-aligned box as center and half size
+struct BoundingBox
+{
+    glm::vec3 center;
+    glm::vec3 extent;
+
+    static BoundingBox FromMinMax(const glm::vec3& min, const glm::vec3& max)
+    {
+        return {(min + max) * 0.5f, (max - min) * 0.5f};
+    }
+
+    // smallest box holding both
+    static BoundingBox Merge(const BoundingBox& a, const BoundingBox& b)
+    {
+        return FromMinMax(glm::min(a.center - a.extent, b.center - b.extent),
+                          glm::max(a.center + a.extent, b.center + b.extent));
+    }
+
+    // box around the transformed box: each new half size is the sum of the absolute transformed half sizes
+    BoundingBox Transform(const glm::mat4& m) const
+    {
+        BoundingBox box;
+        box.center = glm::vec3(m * glm::vec4(center, 1.0f));
+        for (u32 i = 0; i < 3; i++) {
+            box.extent[i] = std::abs(m[0][i]) * extent.x + std::abs(m[1][i]) * extent.y + std::abs(m[2][i]) * extent.z;
+        }
+        return box;
+    }
+};
+
+struct BoundingSphere
+{
+    glm::vec3 center;
+    f32 radius;
+
+    // the radius grows with the largest axis scale
+    BoundingSphere Transform(const glm::mat4& m) const
+    {
+        f32 scale = std::max(glm::length(glm::vec3(m[0])), std::max(glm::length(glm::vec3(m[1])),
+                                                                    glm::length(glm::vec3(m[2]))));
+        return {glm::vec3(m * glm::vec4(center, 1.0f)), radius * scale};
+    }
+};
@@ -0,0 +1,339 @@
+#include "ClusterGrid.h"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#define CLUSTER_AVX
+#elif defined(__SSE__) || defined(_M_X64) || defined(_M_AMD64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <xmmintrin.h>
+#define CLUSTER_SSE
+#endif
+
+// the slices in between are spaced exponentially from here to DEPTH_FAR, in view units
+const f32 ClusterGrid::DEPTH_NEAR = 1.0f;
+const f32 ClusterGrid::DEPTH_FAR = 250.0f;
+
+void PointLights::Clear()
+{
+    position_x.clear();
+    position_y.clear();
+    position_z.clear();
+    radius.clear();
+    color_r.clear();
+    color_g.clear();
+    color_b.clear();
+}
+
+void PointLights::Add(const glm::vec3& position, f32 light_radius, const glm::vec3& color)
+{
+    position_x.push_back(position.x);
+    position_y.push_back(position.y);
+    position_z.push_back(position.z);
+    radius.push_back(light_radius);
+    color_r.push_back(color.x);
+    color_g.push_back(color.y);
+    color_b.push_back(color.z);
+}
+
+u32 PointLights::GetCount() const
+{
+    return static_cast<u32>(position_x.size());
+}
+
+void ClusterGrid::Configure(f32 fov_y, f32 aspect, f32 near_plane, f32 far_plane)
+{
+    glm::vec4 projection(fov_y, aspect, near_plane, far_plane);
+    if (projection == m_Projection)
+        return;
+    m_Projection = projection;
+
+    // slice k starts at DEPTH_NEAR * (DEPTH_FAR / DEPTH_NEAR)^(k / GRID_Z)
+    f32 ratio = std::log(DEPTH_FAR / DEPTH_NEAR);
+    m_SliceScale = GRID_Z / ratio;
+    m_SliceBias = -std::log(DEPTH_NEAR) * m_SliceScale;
+    m_Depths[0] = near_plane;
+    for (u32 z = 1; z < GRID_Z; z++)
+        m_Depths[z] = DEPTH_NEAR * std::exp(ratio * z / GRID_Z);
+    m_Depths[GRID_Z] = far_plane;
+
+    // a tile's corners at both ends of the slice, in view space looking down -z
+    f32 tan_y = std::tan(fov_y * 0.5f);
+    f32 tan_x = tan_y * aspect;
+    for (u32 z = 0; z < GRID_Z; z++) {
+        f32 near_depth = m_Depths[z];
+        f32 far_depth = m_Depths[z + 1];
+        for (u32 y = 0; y < GRID_Y; y++) {
+            f32 y0 = (-1.0f + 2.0f * y / GRID_Y) * tan_y;
+            f32 y1 = (-1.0f + 2.0f * (y + 1) / GRID_Y) * tan_y;
+            for (u32 x = 0; x < GRID_X; x++) {
+                f32 x0 = (-1.0f + 2.0f * x / GRID_X) * tan_x;
+                f32 x1 = (-1.0f + 2.0f * (x + 1) / GRID_X) * tan_x;
+                glm::vec3 min(std::min(x0 * near_depth, x0 * far_depth), std::min(y0 * near_depth, y0 * far_depth),
+                              -far_depth);
+                glm::vec3 max(std::max(x1 * near_depth, x1 * far_depth), std::max(y1 * near_depth, y1 * far_depth),
+                              -near_depth);
+                m_Bounds[x + y * GRID_X + z * GRID_X * GRID_Y] = BoundingBox::FromMinMax(min, max);
+            }
+
+            // the whole row: tiles further out reach further at the far end of the slice
+            glm::vec3 min(-tan_x * far_depth, std::min(y0 * near_depth, y0 * far_depth), -far_depth);
+            glm::vec3 max(tan_x * far_depth, std::max(y1 * near_depth, y1 * far_depth), -near_depth);
+            m_RowBounds[y + z * GRID_Y] = BoundingBox::FromMinMax(min, max);
+        }
+    }
+}
+
+void ClusterGrid::Bin(const PointLights& lights, const glm::mat4& view, ThreadPool* pool)
+{
+    TransformLights(lights, view);
+
+    if (pool) {
+        for (u32 z = 0; z < GRID_Z; z++)
+            pool->Submit([this, z]() { BinSlice(z); });
+        pool->Wait();
+    }
+    else {
+        for (u32 z = 0; z < GRID_Z; z++)
+            BinSlice(z);
+    }
+    Merge();
+}
+
+void ClusterGrid::BinScalar(const PointLights& lights, const glm::mat4& view)
+{
+    TransformLights(lights, view);
+
+    const u32 slice_clusters = GRID_X * GRID_Y;
+    for (u32 z = 0; z < GRID_Z; z++) {
+        Slice& slice = m_Slices[z];
+        slice.indices.clear();
+        slice.counts.assign(slice_clusters, 0);
+        for (u32 c = 0; c < slice_clusters; c++) {
+            const BoundingBox& box = m_Bounds[c + z * slice_clusters];
+            for (u32 i = 0; i < m_ViewX.size(); i++) {
+                f32 dx = std::max(std::abs(m_ViewX[i] - box.center.x) - box.extent.x, 0.0f);
+                f32 dy = std::max(std::abs(m_ViewY[i] - box.center.y) - box.extent.y, 0.0f);
+                f32 dz = std::max(std::abs(m_ViewZ[i] - box.center.z) - box.extent.z, 0.0f);
+                if (dx * dx + dy * dy + dz * dz <= m_Radius[i] * m_Radius[i]) {
+                    slice.indices.push_back(static_cast<u16>(i));
+                    slice.counts[c]++;
+                }
+            }
+        }
+    }
+    Merge();
+}
+
+const std::vector<ClusterGrid::Cluster>& ClusterGrid::GetClusters() const
+{
+    return m_Clusters;
+}
+
+const std::vector<u16>& ClusterGrid::GetIndices() const
+{
+    return m_Indices;
+}
+
+const BoundingBox& ClusterGrid::GetBounds(u32 cluster) const
+{
+    return m_Bounds[cluster];
+}
+
+u32 ClusterGrid::GetMaxClusterLights() const
+{
+    return m_MaxClusterLights;
+}
+
+f32 ClusterGrid::GetSliceScale() const
+{
+    return m_SliceScale;
+}
+
+f32 ClusterGrid::GetSliceBias() const
+{
+    return m_SliceBias;
+}
+
+const char* ClusterGrid::GetInstructionSet()
+{
+#if defined(CLUSTER_AVX)
+    return "AVX";
+#elif defined(CLUSTER_SSE)
+    return "SSE";
+#else
+    return "scalar";
+#endif
+}
+
+void ClusterGrid::TransformLights(const PointLights& lights, const glm::mat4& view)
+{
+    u32 count = std::min(lights.GetCount(), MAX_LIGHTS);
+    m_ViewX.resize(count);
+    m_ViewY.resize(count);
+    m_ViewZ.resize(count);
+    m_Radius.resize(count);
+    for (u32 i = 0; i < count; i++) {
+        f32 x = lights.position_x[i];
+        f32 y = lights.position_y[i];
+        f32 z = lights.position_z[i];
+        m_ViewX[i] = view[0][0] * x + view[1][0] * y + view[2][0] * z + view[3][0];
+        m_ViewY[i] = view[0][1] * x + view[1][1] * y + view[2][1] * z + view[3][1];
+        m_ViewZ[i] = view[0][2] * x + view[1][2] * y + view[2][2] * z + view[3][2];
+        m_Radius[i] = lights.radius[i];
+    }
+}
+
+void ClusterGrid::Candidates::Clear()
+{
+    x.clear();
+    y.clear();
+    z.clear();
+    radius_squared.clear();
+    light.clear();
+}
+
+void ClusterGrid::Candidates::Add(f32 light_x, f32 light_y, f32 light_z, f32 light_radius_squared, u16 index)
+{
+    x.push_back(light_x);
+    y.push_back(light_y);
+    z.push_back(light_z);
+    radius_squared.push_back(light_radius_squared);
+    light.push_back(index);
+}
+
+void ClusterGrid::Candidates::Pad()
+{
+    // a negative reach never covers a squared distance
+    size_t padded = (light.size() + WIDTH - 1) / WIDTH * WIDTH;
+    x.resize(padded, 0.0f);
+    y.resize(padded, 0.0f);
+    z.resize(padded, 0.0f);
+    radius_squared.resize(padded, -1.0f);
+    light.resize(padded, 0);
+}
+
+void ClusterGrid::BinSlice(u32 z)
+{
+    Slice& slice = m_Slices[z];
+    slice.lights.Clear();
+    slice.indices.clear();
+    slice.counts.assign(GRID_X * GRID_Y, 0);
+
+    // only the lights reaching into the slice's depth range are tested against its rows
+    f32 near_depth = m_Depths[z];
+    f32 far_depth = m_Depths[z + 1];
+    for (u32 i = 0; i < m_ViewX.size(); i++) {
+        f32 depth = -m_ViewZ[i];
+        if (depth + m_Radius[i] < near_depth || depth - m_Radius[i] > far_depth)
+            continue;
+        slice.lights.Add(m_ViewX[i], m_ViewY[i], m_ViewZ[i], m_Radius[i] * m_Radius[i], static_cast<u16>(i));
+    }
+    slice.lights.Pad();
+
+    // and only the lights touching a row against its clusters
+    for (u32 y = 0; y < GRID_Y; y++) {
+        slice.row.Clear();
+        if (Test(slice.lights, m_RowBounds[y + z * GRID_Y], &slice.row, slice.indices) == 0)
+            continue;
+        slice.row.Pad();
+
+        for (u32 x = 0; x < GRID_X; x++) {
+            u32 cluster = x + y * GRID_X;
+            slice.counts[cluster] = Test(slice.row, m_Bounds[cluster + z * GRID_X * GRID_Y], nullptr, slice.indices);
+        }
+    }
+}
+
+u32 ClusterGrid::Test(const Candidates& candidates, const BoundingBox& box, Candidates* touching,
+                      std::vector<u16>& indices)
+{
+    u32 count = 0;
+    u32 padded = static_cast<u32>(candidates.light.size());
+
+    // squared distance from the light to the box, zero inside it
+#if defined(CLUSTER_AVX)
+    const u32 LANES = 8;
+    __m256 sign = _mm256_set1_ps(-0.0f);
+    __m256 zero = _mm256_setzero_ps();
+    __m256 cx = _mm256_set1_ps(box.center.x);
+    __m256 cy = _mm256_set1_ps(box.center.y);
+    __m256 cz = _mm256_set1_ps(box.center.z);
+    __m256 ex = _mm256_set1_ps(box.extent.x);
+    __m256 ey = _mm256_set1_ps(box.extent.y);
+    __m256 ez = _mm256_set1_ps(box.extent.z);
+    for (u32 i = 0; i < padded; i += LANES) {
+        __m256 dx = _mm256_max_ps(
+            _mm256_sub_ps(_mm256_andnot_ps(sign, _mm256_sub_ps(_mm256_loadu_ps(&candidates.x[i]), cx)), ex), zero);
+        __m256 dy = _mm256_max_ps(
+            _mm256_sub_ps(_mm256_andnot_ps(sign, _mm256_sub_ps(_mm256_loadu_ps(&candidates.y[i]), cy)), ey), zero);
+        __m256 dz = _mm256_max_ps(
+            _mm256_sub_ps(_mm256_andnot_ps(sign, _mm256_sub_ps(_mm256_loadu_ps(&candidates.z[i]), cz)), ez), zero);
+        __m256 distance =
+            _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy)), _mm256_mul_ps(dz, dz));
+        u32 mask = static_cast<u32>(_mm256_movemask_ps(
+            _mm256_cmp_ps(distance, _mm256_loadu_ps(&candidates.radius_squared[i]), _CMP_LE_OQ)));
+#elif defined(CLUSTER_SSE)
+    const u32 LANES = 4;
+    __m128 sign = _mm_set1_ps(-0.0f);
+    __m128 zero = _mm_setzero_ps();
+    __m128 cx = _mm_set1_ps(box.center.x);
+    __m128 cy = _mm_set1_ps(box.center.y);
+    __m128 cz = _mm_set1_ps(box.center.z);
+    __m128 ex = _mm_set1_ps(box.extent.x);
+    __m128 ey = _mm_set1_ps(box.extent.y);
+    __m128 ez = _mm_set1_ps(box.extent.z);
+    for (u32 i = 0; i < padded; i += LANES) {
+        __m128 dx =
+            _mm_max_ps(_mm_sub_ps(_mm_andnot_ps(sign, _mm_sub_ps(_mm_loadu_ps(&candidates.x[i]), cx)), ex), zero);
+        __m128 dy =
+            _mm_max_ps(_mm_sub_ps(_mm_andnot_ps(sign, _mm_sub_ps(_mm_loadu_ps(&candidates.y[i]), cy)), ey), zero);
+        __m128 dz =
+            _mm_max_ps(_mm_sub_ps(_mm_andnot_ps(sign, _mm_sub_ps(_mm_loadu_ps(&candidates.z[i]), cz)), ez), zero);
+        __m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+        u32 mask =
+            static_cast<u32>(_mm_movemask_ps(_mm_cmple_ps(distance, _mm_loadu_ps(&candidates.radius_squared[i]))));
+#else
+    const u32 LANES = 1;
+    for (u32 i = 0; i < padded; i += LANES) {
+        f32 dx = std::max(std::abs(candidates.x[i] - box.center.x) - box.extent.x, 0.0f);
+        f32 dy = std::max(std::abs(candidates.y[i] - box.center.y) - box.extent.y, 0.0f);
+        f32 dz = std::max(std::abs(candidates.z[i] - box.center.z) - box.extent.z, 0.0f);
+        u32 mask = dx * dx + dy * dy + dz * dz <= candidates.radius_squared[i] ? 1 : 0;
+#endif
+        for (u32 lane = 0; mask != 0; lane++, mask >>= 1) {
+            if ((mask & 1) == 0)
+                continue;
+            u32 j = i + lane;
+            if (touching)
+                touching->Add(candidates.x[j], candidates.y[j], candidates.z[j], candidates.radius_squared[j],
+                              candidates.light[j]);
+            else
+                indices.push_back(candidates.light[j]);
+            count++;
+        }
+    }
+    return count;
+}
+
+void ClusterGrid::Merge()
+{
+    u32 total = 0;
+    for (const Slice& slice : m_Slices)
+        total += static_cast<u32>(slice.indices.size());
+    m_Indices.resize(total);
+
+    u32 first = 0;
+    m_MaxClusterLights = 0;
+    const u32 slice_clusters = GRID_X * GRID_Y;
+    for (u32 z = 0; z < GRID_Z; z++) {
+        const Slice& slice = m_Slices[z];
+        std::copy(slice.indices.begin(), slice.indices.end(), m_Indices.begin() + first);
+        for (u32 c = 0; c < slice_clusters; c++) {
+            m_Clusters[c + z * slice_clusters] = {first, slice.counts[c]};
+            first += slice.counts[c];
+            m_MaxClusterLights = std::max(m_MaxClusterLights, slice.counts[c]);
+        }
+    }
+}
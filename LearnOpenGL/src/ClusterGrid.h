@@ -0,0 +1,114 @@
+#pragma once
+
+#include "defines.h"
+
+#include "Bounds.h"
+#include "ThreadPool.h"
+
+#include <glm/glm.hpp>
+
+#include <vector>
+
+// Point lights laid out structure-of-arrays, so binning can test several lights against a cluster at once.
+class PointLights
+{
+public:
+    void Clear();
+    void Add(const glm::vec3& position, f32 radius, const glm::vec3& color);
+
+    u32 GetCount() const;
+
+    std::vector<f32> position_x, position_y, position_z;
+    std::vector<f32> radius;
+    std::vector<f32> color_r, color_g, color_b;
+};
+
+// Splits the view frustum into GRID_X x GRID_Y screen tiles and GRID_Z depth slices, and lists for every cluster
+// the lights whose spheres touch its view-space bounding box. The slices are spaced exponentially between
+// DEPTH_NEAR and DEPTH_FAR; the first one reaches down to the near plane and the last one out to the far plane.
+//
+// CPU only, LightManager uploads the lists. Clusters are numbered x + y * GRID_X + z * GRID_X * GRID_Y.
+class ClusterGrid
+{
+public:
+    static constexpr u32 GRID_X = 16;
+    static constexpr u32 GRID_Y = 9;
+    static constexpr u32 GRID_Z = 24;
+    static constexpr u32 CLUSTER_COUNT = GRID_X * GRID_Y * GRID_Z;
+    static constexpr u32 MAX_LIGHTS = 65535; // light indices are 16-bit
+    static constexpr u32 WIDTH = 8;          // lights per SIMD group, the candidate arrays are padded to it
+
+    // range of GetIndices
+    struct Cluster
+    {
+        u32 first;
+        u32 count;
+    };
+
+    // Rebuilds the cluster bounds for a perspective projection, if it changed
+    void Configure(f32 fov_y, f32 aspect, f32 near_plane, f32 far_plane);
+
+    // Bins the lights (world space) as seen through view, testing 8 lights at a time with AVX, 4 with SSE.
+    // With a pool the depth slices are binned on its threads, Bin waits for them. At most MAX_LIGHTS are binned.
+    void Bin(const PointLights& lights, const glm::mat4& view, ThreadPool* pool);
+
+    // reference implementation of Bin, every light against every cluster on the calling thread
+    void BinScalar(const PointLights& lights, const glm::mat4& view);
+
+    const std::vector<Cluster>& GetClusters() const;
+    const std::vector<u16>& GetIndices() const;
+    const BoundingBox& GetBounds(u32 cluster) const;
+    u32 GetMaxClusterLights() const;
+
+    // a fragment at view depth d is in slice clamp(floor(log(d) * scale + bias), 0, GRID_Z - 1)
+    f32 GetSliceScale() const;
+    f32 GetSliceBias() const;
+
+    // "AVX", "SSE" or "scalar", whichever Bin uses in this build
+    static const char* GetInstructionSet();
+
+private:
+    static const f32 DEPTH_NEAR;
+    static const f32 DEPTH_FAR;
+
+    // view-space lights to test, padded to WIDTH with lights that touch nothing
+    struct Candidates
+    {
+        std::vector<f32> x, y, z, radius_squared;
+        std::vector<u16> light;
+
+        void Clear();
+        void Add(f32 light_x, f32 light_y, f32 light_z, f32 light_radius_squared, u16 index);
+        void Pad();
+    };
+
+    // the lights reaching into one depth slice and into one row of its tiles, and the lists binned from them
+    struct Slice
+    {
+        Candidates lights;
+        Candidates row;
+        std::vector<u16> indices;
+        std::vector<u32> counts; // per cluster of the slice
+    };
+
+    // view-space light positions, so the cluster bounds don't move with the camera
+    void TransformLights(const PointLights& lights, const glm::mat4& view);
+    void BinSlice(u32 z);
+    // appends the candidates touching box to touching, or to indices when touching is null; returns how many
+    static u32 Test(const Candidates& candidates, const BoundingBox& box, Candidates* touching,
+                    std::vector<u16>& indices);
+    // concatenates the slice lists into m_Clusters and m_Indices
+    void Merge();
+
+    std::vector<f32> m_ViewX, m_ViewY, m_ViewZ, m_Radius;
+    std::vector<Slice> m_Slices = std::vector<Slice>(GRID_Z);
+    std::vector<BoundingBox> m_Bounds = std::vector<BoundingBox>(CLUSTER_COUNT);
+    std::vector<BoundingBox> m_RowBounds = std::vector<BoundingBox>(GRID_Y * GRID_Z); // a row of tiles in a slice
+    std::vector<Cluster> m_Clusters = std::vector<Cluster>(CLUSTER_COUNT, Cluster{0, 0});
+    std::vector<u16> m_Indices;
+    f32 m_Depths[GRID_Z + 1] = {};
+    glm::vec4 m_Projection = glm::vec4(0.0f); // fov_y, aspect, near and far the bounds were built for
+    f32 m_SliceScale = 0.0f;
+    f32 m_SliceBias = 0.0f;
+    u32 m_MaxClusterLights = 0;
+};
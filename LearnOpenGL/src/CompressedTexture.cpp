@@ -0,0 +1,209 @@
+#include "CompressedTexture.h"
+
+#include "Log.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+
+namespace
+{
+
+const char* COOKED_DIRECTORY = "cache/textures";
+
+const u32 DDS_MAGIC = 0x20534444; // "DDS "
+
+const u32 DDSD_CAPS = 0x1;
+const u32 DDSD_HEIGHT = 0x2;
+const u32 DDSD_WIDTH = 0x4;
+const u32 DDSD_PIXELFORMAT = 0x1000;
+const u32 DDSD_MIPMAPCOUNT = 0x20000;
+const u32 DDSD_LINEARSIZE = 0x80000;
+const u32 DDPF_FOURCC = 0x4;
+const u32 DDSCAPS_COMPLEX = 0x8;
+const u32 DDSCAPS_TEXTURE = 0x1000;
+const u32 DDSCAPS_MIPMAP = 0x400000;
+
+constexpr u32 MakeFourCC(char a, char b, char c, char d)
+{
+    return static_cast<u32>(a) | (static_cast<u32>(b) << 8) | (static_cast<u32>(c) << 16) |
+           (static_cast<u32>(d) << 24);
+}
+
+struct DDSPixelFormat
+{
+    u32 size;
+    u32 flags;
+    u32 four_cc;
+    u32 rgb_bit_count;
+    u32 r_mask;
+    u32 g_mask;
+    u32 b_mask;
+    u32 a_mask;
+};
+
+struct DDSHeader
+{
+    u32 size;
+    u32 flags;
+    u32 height;
+    u32 width;
+    u32 pitch_or_linear_size;
+    u32 depth;
+    u32 mip_map_count;
+    u32 reserved1[11];
+    DDSPixelFormat pixel_format;
+    u32 caps;
+    u32 caps2;
+    u32 caps3;
+    u32 caps4;
+    u32 reserved2;
+};
+
+STATIC_ASSERT(sizeof(DDSHeader) == 124, "Expected DDSHeader to be 124 bytes.");
+
+u32 FormatFromFourCC(u32 four_cc)
+{
+    if (four_cc == MakeFourCC('D', 'X', 'T', '1'))
+        return GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+    if (four_cc == MakeFourCC('D', 'X', 'T', '5'))
+        return GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+    if (four_cc == MakeFourCC('A', 'T', 'I', '2') || four_cc == MakeFourCC('B', 'C', '5', 'U'))
+        return GL_COMPRESSED_RG_RGTC2;
+    return 0;
+}
+
+u32 FourCCFromFormat(u32 format)
+{
+    switch (format) {
+    case GL_COMPRESSED_RGB_S3TC_DXT1_EXT:
+        return MakeFourCC('D', 'X', 'T', '1');
+    case GL_COMPRESSED_RGBA_S3TC_DXT5_EXT:
+        return MakeFourCC('D', 'X', 'T', '5');
+    case GL_COMPRESSED_RG_RGTC2:
+        return MakeFourCC('A', 'T', 'I', '2');
+    default:
+        return 0;
+    }
+}
+
+} // namespace
+
+b8 CompressedTexture::Load(const std::string& path, CompressedImage& image)
+{
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file)
+        return false;
+
+    u64 file_size = static_cast<u64>(file.tellg());
+    file.seekg(0);
+
+    u32 magic = 0;
+    DDSHeader header;
+    if (file_size < sizeof(magic) + sizeof(header))
+        return false;
+    file.read(reinterpret_cast<char*>(&magic), sizeof(magic));
+    file.read(reinterpret_cast<char*>(&header), sizeof(header));
+
+    if (magic != DDS_MAGIC || header.size != sizeof(DDSHeader) || !(header.pixel_format.flags & DDPF_FOURCC)) {
+        LOG_ERROR("CompressedTexture: {0} is not a supported DDS file", path);
+        return false;
+    }
+
+    image.format = FormatFromFourCC(header.pixel_format.four_cc);
+    if (image.format == 0) {
+        LOG_ERROR("CompressedTexture: {0} uses an unsupported pixel format", path);
+        return false;
+    }
+
+    image.width = header.width;
+    image.height = header.height;
+    image.levels.clear();
+
+    u32 block_size = GetBlockSize(image.format);
+    u32 level_count = (header.flags & DDSD_MIPMAPCOUNT) ? std::max(header.mip_map_count, 1u) : 1;
+    u32 width = header.width;
+    u32 height = header.height;
+    u64 offset = 0;
+    for (u32 i = 0; i < level_count; i++) {
+        u64 size = static_cast<u64>(std::max((width + 3) / 4, 1u)) * std::max((height + 3) / 4, 1u) * block_size;
+        image.levels.push_back({width, height, offset, size});
+        offset += size;
+        width = std::max(width / 2, 1u);
+        height = std::max(height / 2, 1u);
+    }
+
+    u64 data_offset = sizeof(magic) + sizeof(header);
+    if (data_offset + offset > file_size) {
+        LOG_ERROR("CompressedTexture: {0} is truncated", path);
+        return false;
+    }
+
+    image.data.resize(offset);
+    file.read(reinterpret_cast<char*>(image.data.data()), offset);
+    return static_cast<b8>(file.good());
+}
+
+b8 CompressedTexture::Save(const std::string& path, const CompressedImage& image)
+{
+    DDSHeader header = {};
+    header.size = sizeof(DDSHeader);
+    header.flags = DDSD_CAPS | DDSD_HEIGHT | DDSD_WIDTH | DDSD_PIXELFORMAT | DDSD_MIPMAPCOUNT | DDSD_LINEARSIZE;
+    header.height = image.height;
+    header.width = image.width;
+    header.pitch_or_linear_size = image.levels.empty() ? 0 : static_cast<u32>(image.levels[0].size);
+    header.mip_map_count = static_cast<u32>(image.levels.size());
+    header.pixel_format.size = sizeof(DDSPixelFormat);
+    header.pixel_format.flags = DDPF_FOURCC;
+    header.pixel_format.four_cc = FourCCFromFormat(image.format);
+    header.caps = DDSCAPS_TEXTURE | DDSCAPS_MIPMAP | DDSCAPS_COMPLEX;
+
+    std::error_code ec;
+    std::filesystem::create_directories(std::filesystem::path(path).parent_path(), ec);
+
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file) {
+        LOG_ERROR("CompressedTexture: Failed to open {0} for writing", path);
+        return false;
+    }
+
+    file.write(reinterpret_cast<const char*>(&DDS_MAGIC), sizeof(DDS_MAGIC));
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(image.data.data()), image.data.size());
+    return static_cast<b8>(file.good());
+}
+
+std::string CompressedTexture::GetCookedPath(const std::string& source_path)
+{
+    std::string name = std::filesystem::path(source_path).lexically_normal().generic_string();
+    for (char& c : name) {
+        if (c == '/' || c == '\\' || c == ':')
+            c = '_';
+    }
+    return std::string(COOKED_DIRECTORY) + "/" + name + ".dds";
+}
+
+b8 CompressedTexture::IsCookedUpToDate(const std::string& source_path)
+{
+    std::error_code ec;
+    auto cooked_time = std::filesystem::last_write_time(GetCookedPath(source_path), ec);
+    if (ec)
+        return false;
+    auto source_time = std::filesystem::last_write_time(source_path, ec);
+    if (ec)
+        return false;
+    return cooked_time >= source_time;
+}
+
+u32 CompressedTexture::GetBlockSize(u32 format)
+{
+    switch (format) {
+    case GL_COMPRESSED_RGB_S3TC_DXT1_EXT:
+        return 8;
+    case GL_COMPRESSED_RGBA_S3TC_DXT5_EXT:
+    case GL_COMPRESSED_RG_RGTC2:
+        return 16;
+    default:
+        return 0;
+    }
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include "defines.h"
+
+#include <glad/glad.h>
+
+#include "Texture2D.h"
+
+#include <string>
+#include <vector>
+
+// S3TC is an extension, not part of the core profile headers
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#endif
+#ifndef GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+
+// Block-compressed image with its full mip chain, as stored in a cooked .dds file.
+struct CompressedImage
+{
+    u32 format; // GL internal format
+    u32 width;
+    u32 height;
+    std::vector<TextureLevel> levels;
+    std::vector<u8> data;
+};
+
+// Reads and writes cooked textures (DDS containers holding DXT1, DXT5 or ATI2/BC5 data).
+class CompressedTexture
+{
+public:
+    static b8 Load(const std::string& path, CompressedImage& image);
+    static b8 Save(const std::string& path, const CompressedImage& image);
+
+    // Where the cooker writes the compressed version of source_path.
+    static std::string GetCookedPath(const std::string& source_path);
+
+    // Returns true if a cooked file exists that is at least as new as source_path.
+    static b8 IsCookedUpToDate(const std::string& source_path);
+
+    // Size of one 4x4 block of the given GL format, or 0 if the format is not block compressed.
+    static u32 GetBlockSize(u32 format);
+};
@@ -0,0 +1,166 @@
+#include "DeferredRenderer.h"
+
+#include "GpuProfiler.h"
+#include "Log.h"
+#include "OcclusionCuller.h"
+#include "Timer.h"
+
+enum GBufferTarget
+{
+    AlbedoSpecular = 0,
+    Normal,
+    Depth
+};
+
+static const char* const SAMPLER_NAMES[] = {"gAlbedoSpecular", "gNormal", "gDepth"};
+
+Shader* DeferredRenderer::s_LightingShader = nullptr;
+u32 DeferredRenderer::s_Framebuffer = 0;
+u32 DeferredRenderer::s_Textures[3] = {0, 0, 0};
+u32 DeferredRenderer::s_EmptyVAO = 0;
+u32 DeferredRenderer::s_Width = 0;
+u32 DeferredRenderer::s_Height = 0;
+ShadingPath DeferredRenderer::s_Path = ShadingPath::Forward;
+GpuTimer DeferredRenderer::s_LightingTimer;
+u32 DeferredRenderer::s_Frame = 0;
+DeferredRenderer::Stats DeferredRenderer::s_Stats = {0.0, {0.0, 0.0}, 0};
+
+// screen-sized texture without mipmaps, sampled texel for texel
+static u32 CreateTarget(GLenum internal_format, GLenum format, GLenum type, u32 width, u32 height)
+{
+    u32 texture;
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexImage2D(GL_TEXTURE_2D, 0, internal_format, width, height, 0, format, type, nullptr);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    return texture;
+}
+
+void DeferredRenderer::Init(Shader& lighting_shader, u32 width, u32 height)
+{
+    s_LightingShader = &lighting_shader;
+    s_Width = width;
+    s_Height = height;
+
+    // the depth format matches the scene framebuffer's, so Resolve can blit it across
+    s_Textures[AlbedoSpecular] = CreateTarget(GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE, width, height);
+    s_Textures[Normal] = CreateTarget(GL_RG16, GL_RG, GL_UNSIGNED_SHORT, width, height);
+    s_Textures[Depth] = CreateTarget(GL_DEPTH_COMPONENT24, GL_DEPTH_COMPONENT, GL_UNSIGNED_INT, width, height);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    glGenFramebuffers(1, &s_Framebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, s_Framebuffer);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, s_Textures[AlbedoSpecular], 0);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, s_Textures[Normal], 0);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, s_Textures[Depth], 0);
+    const GLenum draw_buffers[] = {GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1};
+    glDrawBuffers(2, draw_buffers);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+        LOG_ERROR("DeferredRenderer: G-buffer framebuffer incomplete");
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    glGenVertexArrays(1, &s_EmptyVAO);
+    s_LightingTimer.Init();
+
+    s_Stats.gbuffer_bytes = static_cast<u64>(width) * height * BYTES_PER_PIXEL;
+    LOG_INFO("DeferredRenderer: {0}x{1} G-buffer, {2:.1f} MB", width, height,
+             s_Stats.gbuffer_bytes / (1024.0 * 1024.0));
+}
+
+void DeferredRenderer::Shutdown()
+{
+    s_LightingTimer.Shutdown();
+    glDeleteVertexArrays(1, &s_EmptyVAO);
+    glDeleteFramebuffers(1, &s_Framebuffer);
+    glDeleteTextures(3, s_Textures);
+    s_EmptyVAO = 0;
+    s_Framebuffer = 0;
+    for (u32& texture : s_Textures)
+        texture = 0;
+    s_LightingShader = nullptr;
+}
+
+void DeferredRenderer::SetPath(ShadingPath path)
+{
+    s_Path = path;
+}
+
+ShadingPath DeferredRenderer::GetPath()
+{
+    return s_Path;
+}
+
+void DeferredRenderer::BeginGeometry()
+{
+    glBindFramebuffer(GL_FRAMEBUFFER, s_Framebuffer);
+    const f32 zero[] = {0.0f, 0.0f, 0.0f, 0.0f};
+    const f32 far_depth = 1.0f;
+    glClearBufferfv(GL_COLOR, 0, zero);
+    glClearBufferfv(GL_COLOR, 1, zero);
+    glClearBufferfv(GL_DEPTH, 0, &far_depth);
+}
+
+void DeferredRenderer::Resolve(u32 framebuffer, const glm::mat4& view_projection, f32 shininess)
+{
+    GpuProfiler::Scope scope("Deferred lighting");
+    s_LightingTimer.Begin(s_Frame);
+
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, s_Framebuffer);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, framebuffer);
+    glBlitFramebuffer(0, 0, s_Width, s_Height, 0, 0, s_Width, s_Height, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+
+    // every covered pixel exactly once, the empty ones keep the scene's clear color
+    glDisable(GL_DEPTH_TEST);
+    glDepthMask(GL_FALSE);
+    s_LightingShader->Use();
+    s_LightingShader->SetMat4("inverseViewProjection", glm::inverse(view_projection));
+    s_LightingShader->SetFloat("shininess", shininess);
+    for (u32 i = 0; i < 3; i++) {
+        glActiveTexture(GL_TEXTURE0 + i);
+        glBindTexture(GL_TEXTURE_2D, s_Textures[i]);
+    }
+    glBindVertexArray(s_EmptyVAO);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    glBindVertexArray(0);
+    glActiveTexture(GL_TEXTURE0);
+    glDepthMask(GL_TRUE);
+    glEnable(GL_DEPTH_TEST);
+
+    GpuTimer::End();
+}
+
+void DeferredRenderer::EndFrame()
+{
+    // the slot written FRAMES_IN_FLIGHT frames ago, normally long done; if not the sample is dropped
+    s_Frame++;
+    GpuTimer::Sample lighting = s_LightingTimer.Read(s_Frame, s_Stats.lighting_ms);
+    if (lighting == GpuTimer::Sample::Dropped)
+        return;
+    b8 deferred = lighting == GpuTimer::Sample::Ready;
+
+    // the draw timers are as old as this one, so a lighting sample marks a deferred frame
+    OcclusionCuller::Stats draws = OcclusionCuller::GetStats();
+    if (draws.draw_ms > 0.0) {
+        f64& average = s_Stats.scene_ms[static_cast<u32>(deferred ? ShadingPath::Deferred : ShadingPath::Forward)];
+        f64 total = draws.prepass_ms + draws.draw_ms + (deferred ? s_Stats.lighting_ms : 0.0);
+        UpdateRunningAverage(average, total);
+    }
+}
+
+void DeferredRenderer::AssignTextureUnits(Shader& shader)
+{
+    shader.Use();
+    for (u32 i = 0; i < 3; i++) {
+        if (shader.HasUniform(SAMPLER_NAMES[i]))
+            shader.SetInt(SAMPLER_NAMES[i], static_cast<i32>(i));
+    }
+}
+
+DeferredRenderer::Stats DeferredRenderer::GetStats()
+{
+    return s_Stats;
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include "defines.h"
+
+#include "GpuTimer.h"
+#include "Shader.h"
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+enum class ShadingPath
+{
+    Forward = 0, // the model shaders light every fragment they draw
+    Deferred     // the model shaders fill the G-buffer, one full-screen pass lights it
+};
+
+// Deferred shading into the scene framebuffer.
+//
+// The G-buffer is 12 bytes per pixel: albedo and specular strength (RGBA8), the world-space normal octahedral
+// encoded (RG16) and the depth buffer (DEPTH_COMPONENT24), from which the lighting pass reconstructs positions.
+// The lighting pass is one full-screen triangle that shades every covered pixel with the key light, the shadowed
+// sun and the point lights of its LightManager cluster, so its cost follows pixels times the lights overlapping them,
+// not the triangle count. GL thread only.
+class DeferredRenderer
+{
+public:
+    static const u32 PATH_COUNT = 2;
+    static const u32 BYTES_PER_PIXEL = 12;
+
+    struct Stats
+    {
+        f64 lighting_ms;          // GPU time of the lighting pass
+        f64 scene_ms[PATH_COUNT]; // running average of the scene's GPU time per path, lighting included
+        u64 gbuffer_bytes;        // all three targets
+    };
+
+    // lighting_shader is deferred_lighting_vs/fs.glsl, width and height the size of the scene framebuffer
+    static void Init(Shader& lighting_shader, u32 width, u32 height);
+    static void Shutdown();
+
+    static void SetPath(ShadingPath path);
+    static ShadingPath GetPath();
+
+    // Binds and clears the G-buffer; the draws that follow must use the shaders built from gbuffer_fs.glsl
+    static void BeginGeometry();
+
+    // Lights the G-buffer into framebuffer and copies its depth there, so forward draws can follow.
+    // Leaves framebuffer bound with depth testing on.
+    static void Resolve(u32 framebuffer, const glm::mat4& view_projection, f32 shininess);
+
+    // Moves to the next frame's timer and folds the latest GPU times into the averages. Once per frame on
+    // either path, after the scene is drawn.
+    static void EndFrame();
+
+    // points the lighting shader's G-buffer samplers at their texture units
+    static void AssignTextureUnits(Shader& shader);
+
+    static Stats GetStats();
+
+private:
+    static Shader* s_LightingShader;
+    static u32 s_Framebuffer;
+    static u32 s_Textures[3]; // albedo and specular, normal, depth
+    static u32 s_EmptyVAO;    // the full-screen triangle comes from gl_VertexID
+    static u32 s_Width;
+    static u32 s_Height;
+    static ShadingPath s_Path;
+    static GpuTimer s_LightingTimer;
+    static u32 s_Frame;
+    static Stats s_Stats;
+};
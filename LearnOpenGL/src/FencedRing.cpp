@@ -0,0 +1,134 @@
+#include "FencedRing.h"
+
+#include "Log.h"
+
+#include <algorithm>
+#include <cstring>
+
+void FencedRing::Init(const char* name, u32 stride, u32 capacity)
+{
+    m_Name = name;
+    m_Stride = stride;
+    Grow(capacity);
+}
+
+void FencedRing::Shutdown()
+{
+    DeleteFences();
+    glDeleteBuffers(1, &m_Buffer);
+    m_Buffer = 0;
+    m_Capacity = 0;
+    m_Next = 0;
+}
+
+void FencedRing::BeginFrame()
+{
+    m_Frame = (m_Frame + 1) % FRAMES_IN_FLIGHT;
+    m_Next = 0;
+
+    // the GPU may still be reading this segment from FRAMES_IN_FLIGHT frames ago
+    GLsync& fence = m_Fences[m_Frame];
+    if (fence) {
+        if (glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0) == GL_TIMEOUT_EXPIRED) {
+            LOG_TRACE("{0}: Waiting for frame segment {1}", m_Name, m_Frame);
+            glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000);
+        }
+        glDeleteSync(fence);
+        fence = nullptr;
+    }
+}
+
+void FencedRing::EndFrame()
+{
+    m_Fences[m_Frame] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+u32 FencedRing::Write(const void* elements, u32 element_size, u32 count)
+{
+    if (count == 0)
+        return m_Next;
+    if (m_Next + count > m_Capacity)
+        Grow(std::max(m_Capacity * 2, m_Next + count));
+
+    u32 first = m_Next;
+    m_Next += count;
+
+    // the fence in BeginFrame guarantees the GPU is done with this range
+    GLsizeiptr size = static_cast<GLsizeiptr>(count) * m_Stride;
+    glBindBuffer(GL_COPY_WRITE_BUFFER, m_Buffer);
+    u8* dst = static_cast<u8*>(glMapBufferRange(GL_COPY_WRITE_BUFFER, GetOffset(first), size,
+                                                GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT |
+                                                    GL_MAP_UNSYNCHRONIZED_BIT));
+    if (dst) {
+        const u8* src = static_cast<const u8*>(elements);
+        if (element_size == m_Stride) {
+            std::memcpy(dst, src, static_cast<size_t>(size));
+        }
+        else {
+            for (u32 i = 0; i < count; i++)
+                std::memcpy(dst + static_cast<size_t>(i) * m_Stride, src + static_cast<size_t>(i) * element_size,
+                            element_size);
+        }
+        glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+    }
+    else {
+        LOG_ERROR("{0}: Failed to map {1} elements", m_Name, count);
+    }
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+    return first;
+}
+
+GLintptr FencedRing::GetOffset(u32 index) const
+{
+    return (static_cast<GLintptr>(m_Frame) * m_Capacity + index) * m_Stride;
+}
+
+u32 FencedRing::GetBuffer() const
+{
+    return m_Buffer;
+}
+
+u32 FencedRing::GetStride() const
+{
+    return m_Stride;
+}
+
+u32 FencedRing::GetCapacity() const
+{
+    return m_Capacity;
+}
+
+void FencedRing::Grow(u32 capacity)
+{
+    u32 buffer;
+    glGenBuffers(1, &buffer);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+    glBufferData(GL_COPY_WRITE_BUFFER, static_cast<GLsizeiptr>(capacity) * m_Stride * FRAMES_IN_FLIGHT, nullptr,
+                 GL_STREAM_DRAW);
+
+    // keep the elements already written this frame, the other segments are free in a fresh buffer
+    if (m_Buffer) {
+        LOG_TRACE("{0}: Growing to {1} elements per frame", m_Name, capacity);
+        glBindBuffer(GL_COPY_READ_BUFFER, m_Buffer);
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, GetOffset(0),
+                            static_cast<GLintptr>(m_Frame) * capacity * m_Stride,
+                            static_cast<GLsizeiptr>(m_Next) * m_Stride);
+        glBindBuffer(GL_COPY_READ_BUFFER, 0);
+        glDeleteBuffers(1, &m_Buffer);
+        DeleteFences();
+    }
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+    m_Buffer = buffer;
+    m_Capacity = capacity;
+}
+
+void FencedRing::DeleteFences()
+{
+    for (GLsync& fence : m_Fences) {
+        if (fence)
+            glDeleteSync(fence);
+        fence = nullptr;
+    }
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include "defines.h"
+
+#include <glad/glad.h>
+
+// A buffer of fixed-size elements written by the CPU every frame, with one segment per frame in flight.
+//
+// A segment is only rewritten after the fence of the frame that last used it has passed, so writes map their range
+// unsynchronized and never stall on the GPU. The buffer grows when a frame writes more than a segment holds, keeping
+// the elements already written that frame. Used by the object blocks of UniformBuffers and by InstanceBuffer.
+// GL thread only.
+class FencedRing
+{
+public:
+    static const u32 FRAMES_IN_FLIGHT = 3;
+
+    // stride is the byte distance between elements, capacity the elements per frame; name prefixes the log lines
+    void Init(const char* name, u32 stride, u32 capacity);
+    void Shutdown();
+
+    // Moves to the next segment, waiting for the GPU if it still reads it. Once per frame, before the first Write.
+    void BeginFrame();
+    // Fences the segment written this frame. Once per frame, after its last draw.
+    void EndFrame();
+
+    // Copies count elements of element_size bytes into this frame's segment, one per stride, and returns the index
+    // of the first one. Elements stay valid until the end of the frame.
+    u32 Write(const void* elements, u32 element_size, u32 count);
+
+    // byte offset in the buffer of element index of this frame; invalidated by the next Write that grows
+    GLintptr GetOffset(u32 index) const;
+    u32 GetBuffer() const;
+    u32 GetStride() const;
+    u32 GetCapacity() const;
+
+private:
+    // reallocates the buffer for capacity elements per frame, keeping this frame's elements
+    void Grow(u32 capacity);
+    void DeleteFences();
+
+    const char* m_Name = "";
+    u32 m_Buffer = 0;
+    u32 m_Stride = 0;
+    u32 m_Capacity = 0;
+    u32 m_Frame = 0;
+    u32 m_Next = 0;
+    GLsync m_Fences[FRAMES_IN_FLIGHT] = {};
+};
@@ -0,0 +1,203 @@
+#include "Frustum.h"
+
+#include <cmath>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#define FRUSTUM_AVX
+#elif defined(__SSE__) || defined(_M_X64) || defined(_M_AMD64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <xmmintrin.h>
+#define FRUSTUM_SSE
+#endif
+
+// padding boxes sit behind every plane
+static const f32 CULLED_EXTENT = -1e30f;
+
+void CullBatch::Clear()
+{
+    m_Count = 0;
+    center_x.clear();
+    center_y.clear();
+    center_z.clear();
+    extent_x.clear();
+    extent_y.clear();
+    extent_z.clear();
+}
+
+void CullBatch::Add(const BoundingBox& box)
+{
+    // the arrays grow a whole group at a time, the slots not used yet stay padding
+    if (m_Count == center_x.size()) {
+        center_x.resize(m_Count + WIDTH, 0.0f);
+        center_y.resize(m_Count + WIDTH, 0.0f);
+        center_z.resize(m_Count + WIDTH, 0.0f);
+        extent_x.resize(m_Count + WIDTH, CULLED_EXTENT);
+        extent_y.resize(m_Count + WIDTH, CULLED_EXTENT);
+        extent_z.resize(m_Count + WIDTH, CULLED_EXTENT);
+    }
+
+    center_x[m_Count] = box.center.x;
+    center_y[m_Count] = box.center.y;
+    center_z[m_Count] = box.center.z;
+    extent_x[m_Count] = box.extent.x;
+    extent_y[m_Count] = box.extent.y;
+    extent_z[m_Count] = box.extent.z;
+    m_Count++;
+}
+
+u32 CullBatch::GetCount() const
+{
+    return m_Count;
+}
+
+Frustum::Frustum()
+{
+    // accepts everything
+    for (glm::vec4& plane : m_Planes)
+        plane = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+}
+
+Frustum::Frustum(const glm::mat4& view_projection)
+{
+    // rows of the matrix, glm is column major
+    glm::vec4 rows[4];
+    for (u32 i = 0; i < 4; i++)
+        rows[i] = glm::vec4(view_projection[0][i], view_projection[1][i], view_projection[2][i], view_projection[3][i]);
+
+    // -w <= x, y, z <= w in clip space
+    m_Planes[Left] = rows[3] + rows[0];
+    m_Planes[Right] = rows[3] - rows[0];
+    m_Planes[Bottom] = rows[3] + rows[1];
+    m_Planes[Top] = rows[3] - rows[1];
+    m_Planes[Near] = rows[3] + rows[2];
+    m_Planes[Far] = rows[3] - rows[2];
+
+    for (glm::vec4& plane : m_Planes)
+        plane /= glm::length(glm::vec3(plane));
+}
+
+b8 Frustum::IsVisible(const BoundingBox& box) const
+{
+    for (const glm::vec4& plane : m_Planes) {
+        // distance of the center plus the box's reach towards the plane normal
+        f32 distance = plane.x * box.center.x + plane.y * box.center.y + plane.z * box.center.z + plane.w;
+        f32 radius = std::abs(plane.x) * box.extent.x + std::abs(plane.y) * box.extent.y +
+                     std::abs(plane.z) * box.extent.z;
+        if (distance + radius < 0.0f)
+            return false;
+    }
+    return true;
+}
+
+Frustum::Containment Frustum::Classify(const BoundingBox& box) const
+{
+    Containment result = Containment::Inside;
+    for (const glm::vec4& plane : m_Planes) {
+        f32 distance = plane.x * box.center.x + plane.y * box.center.y + plane.z * box.center.z + plane.w;
+        f32 radius = std::abs(plane.x) * box.extent.x + std::abs(plane.y) * box.extent.y +
+                     std::abs(plane.z) * box.extent.z;
+        if (distance + radius < 0.0f)
+            return Containment::Outside;
+        if (distance - radius < 0.0f)
+            result = Containment::Intersecting;
+    }
+    return result;
+}
+
+u32 Frustum::Cull(const CullBatch& batch, std::vector<u8>& visible) const
+{
+#if defined(FRUSTUM_AVX) || defined(FRUSTUM_SSE)
+#if defined(FRUSTUM_AVX)
+    const u32 LANES = 8;
+#else
+    const u32 LANES = 4;
+#endif
+
+    u32 count = batch.GetCount();
+    visible.resize(count);
+
+    u32 visible_count = 0;
+    for (u32 i = 0; i < count; i += LANES) {
+#if defined(FRUSTUM_AVX)
+        __m256 cx = _mm256_loadu_ps(&batch.center_x[i]);
+        __m256 cy = _mm256_loadu_ps(&batch.center_y[i]);
+        __m256 cz = _mm256_loadu_ps(&batch.center_z[i]);
+        __m256 ex = _mm256_loadu_ps(&batch.extent_x[i]);
+        __m256 ey = _mm256_loadu_ps(&batch.extent_y[i]);
+        __m256 ez = _mm256_loadu_ps(&batch.extent_z[i]);
+        __m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+
+        for (const glm::vec4& plane : m_Planes) {
+            __m256 distance = _mm256_add_ps(
+                _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(plane.x), cx), _mm256_mul_ps(_mm256_set1_ps(plane.y), cy)),
+                _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(plane.z), cz), _mm256_set1_ps(plane.w)));
+            __m256 radius = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(std::abs(plane.x)), ex),
+                                                        _mm256_mul_ps(_mm256_set1_ps(std::abs(plane.y)), ey)),
+                                          _mm256_mul_ps(_mm256_set1_ps(std::abs(plane.z)), ez));
+            inside = _mm256_and_ps(inside, _mm256_cmp_ps(_mm256_add_ps(distance, radius), _mm256_setzero_ps(),
+                                                         _CMP_GE_OQ));
+        }
+        u32 mask = static_cast<u32>(_mm256_movemask_ps(inside));
+#else
+        __m128 cx = _mm_loadu_ps(&batch.center_x[i]);
+        __m128 cy = _mm_loadu_ps(&batch.center_y[i]);
+        __m128 cz = _mm_loadu_ps(&batch.center_z[i]);
+        __m128 ex = _mm_loadu_ps(&batch.extent_x[i]);
+        __m128 ey = _mm_loadu_ps(&batch.extent_y[i]);
+        __m128 ez = _mm_loadu_ps(&batch.extent_z[i]);
+        __m128 inside = _mm_cmpeq_ps(_mm_setzero_ps(), _mm_setzero_ps());
+
+        for (const glm::vec4& plane : m_Planes) {
+            __m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(plane.x), cx),
+                                                    _mm_mul_ps(_mm_set1_ps(plane.y), cy)),
+                                         _mm_add_ps(_mm_mul_ps(_mm_set1_ps(plane.z), cz), _mm_set1_ps(plane.w)));
+            __m128 radius = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(std::abs(plane.x)), ex),
+                                                  _mm_mul_ps(_mm_set1_ps(std::abs(plane.y)), ey)),
+                                       _mm_mul_ps(_mm_set1_ps(std::abs(plane.z)), ez));
+            inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(distance, radius), _mm_setzero_ps()));
+        }
+        u32 mask = static_cast<u32>(_mm_movemask_ps(inside));
+#endif
+
+        for (u32 lane = 0; lane < LANES && i + lane < count; lane++) {
+            u8 lane_visible = (mask >> lane) & 1;
+            visible[i + lane] = lane_visible;
+            visible_count += lane_visible;
+        }
+    }
+    return visible_count;
+#else
+    return CullScalar(batch, visible);
+#endif
+}
+
+u32 Frustum::CullScalar(const CullBatch& batch, std::vector<u8>& visible) const
+{
+    u32 count = batch.GetCount();
+    visible.resize(count);
+
+    u32 visible_count = 0;
+    for (u32 i = 0; i < count; i++) {
+        BoundingBox box = {glm::vec3(batch.center_x[i], batch.center_y[i], batch.center_z[i]),
+                           glm::vec3(batch.extent_x[i], batch.extent_y[i], batch.extent_z[i])};
+        visible[i] = IsVisible(box) ? 1 : 0;
+        visible_count += visible[i];
+    }
+    return visible_count;
+}
+
+const glm::vec4& Frustum::GetPlane(u32 plane) const
+{
+    return m_Planes[plane];
+}
+
+const char* Frustum::GetInstructionSet()
+{
+#if defined(FRUSTUM_AVX)
+    return "AVX";
+#elif defined(FRUSTUM_SSE)
+    return "SSE";
+#else
+    return "scalar";
+#endif
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include "defines.h"
+
+#include "Bounds.h"
+
+#include <glm/glm.hpp>
+
+#include <vector>
+
+// Bounding boxes laid out structure-of-arrays, so the frustum test can load one component of several boxes at
+// once. The arrays are padded to a multiple of CullBatch::WIDTH with boxes that are always culled.
+class CullBatch
+{
+public:
+    static const u32 WIDTH = 8;
+
+    void Clear();
+    void Add(const BoundingBox& box);
+
+    u32 GetCount() const;
+
+    std::vector<f32> center_x, center_y, center_z;
+    std::vector<f32> extent_x, extent_y, extent_z;
+
+private:
+    u32 m_Count = 0;
+};
+
+// Six planes pointing inwards, taken from a view-projection matrix (Gribb & Hartmann)
+class Frustum
+{
+public:
+    enum Plane
+    {
+        Left = 0,
+        Right,
+        Bottom,
+        Top,
+        Near,
+        Far,
+        Count
+    };
+
+    enum class Containment
+    {
+        Outside,
+        Intersecting,
+        Inside
+    };
+
+    Frustum();
+    explicit Frustum(const glm::mat4& view_projection);
+
+    // false only if the box is entirely outside one of the planes
+    b8 IsVisible(const BoundingBox& box) const;
+
+    // Inside when the box is entirely on the inner side of every plane, so nothing within it needs testing
+    Containment Classify(const BoundingBox& box) const;
+
+    // Writes 1 for every visible box of the batch and 0 otherwise, returns the number visible.
+    // Tests 8 boxes at a time with AVX, 4 with SSE, or falls back to CullScalar.
+    u32 Cull(const CullBatch& batch, std::vector<u8>& visible) const;
+
+    // reference implementation of Cull, one box at a time
+    u32 CullScalar(const CullBatch& batch, std::vector<u8>& visible) const;
+
+    const glm::vec4& GetPlane(u32 plane) const;
+
+    // "AVX", "SSE" or "scalar", whichever Cull uses in this build
+    static const char* GetInstructionSet();
+
+private:
+    glm::vec4 m_Planes[Count]; // xyz = normal, w = distance
+};
@@ -0,0 +1,356 @@
+#include "GeometryArena.h"
+
+#include "Log.h"
+#include "VertexPacking.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+#include <vector>
+
+GeometryArena* GeometryArena::s_Arenas[2] = {nullptr, nullptr};
+u32 GeometryArena::s_NextId = 0;
+
+void RangeAllocator::Reset(u32 capacity)
+{
+    m_FreeRanges.clear();
+    if (capacity > 0)
+        m_FreeRanges[0] = capacity;
+    m_Capacity = capacity;
+    m_Used = 0;
+}
+
+b8 RangeAllocator::Allocate(u32 size, u32& offset)
+{
+    for (auto it = m_FreeRanges.begin(); it != m_FreeRanges.end(); ++it) {
+        if (it->second < size)
+            continue;
+
+        offset = it->first;
+        u32 remaining = it->second - size;
+        m_FreeRanges.erase(it);
+        if (remaining > 0)
+            m_FreeRanges[offset + size] = remaining;
+        m_Used += size;
+        return true;
+    }
+    return false;
+}
+
+void RangeAllocator::Free(u32 offset, u32 size)
+{
+    if (size == 0)
+        return;
+    m_Used -= size;
+
+    auto next = m_FreeRanges.lower_bound(offset);
+
+    // merge with the free range right after
+    if (next != m_FreeRanges.end() && offset + size == next->first) {
+        size += next->second;
+        next = m_FreeRanges.erase(next);
+    }
+
+    // and with the one right before
+    if (next != m_FreeRanges.begin()) {
+        auto prev = std::prev(next);
+        if (prev->first + prev->second == offset) {
+            prev->second += size;
+            return;
+        }
+    }
+    m_FreeRanges[offset] = size;
+}
+
+void RangeAllocator::Grow(u32 capacity)
+{
+    if (capacity <= m_Capacity)
+        return;
+
+    u32 old_capacity = m_Capacity;
+    m_Capacity = capacity;
+    m_Used += capacity - old_capacity; // Free subtracts it again
+    Free(old_capacity, capacity - old_capacity);
+}
+
+u32 RangeAllocator::GetCapacity() const
+{
+    return m_Capacity;
+}
+
+u32 RangeAllocator::GetUsed() const
+{
+    return m_Used;
+}
+
+u32 RangeAllocator::GetFreeRangeCount() const
+{
+    return static_cast<u32>(m_FreeRanges.size());
+}
+
+GeometryArena& GeometryArena::Get(VertexFormat format)
+{
+    GeometryArena*& arena = s_Arenas[static_cast<u32>(format)];
+    if (!arena)
+        arena = new GeometryArena(format);
+    return *arena;
+}
+
+void GeometryArena::Shutdown()
+{
+    for (GeometryArena*& arena : s_Arenas) {
+        if (arena) {
+            arena->Destroy();
+            delete arena;
+            arena = nullptr;
+        }
+    }
+}
+
+GeometryArena::GeometryArena(VertexFormat format)
+    : m_Format(format), m_Id(s_NextId++), m_VertexSize(format == VertexFormat::Packed ? sizeof(PackedVertex) : sizeof(Vertex)),
+      m_PositionSize(format == VertexFormat::Packed ? sizeof(PackedVertex::position) : sizeof(Vertex::position)),
+      m_VBO(0), m_PositionVBO(0), m_EBO(0)
+{
+    glGenBuffers(1, &m_VBO);
+    glBindBuffer(GL_ARRAY_BUFFER, m_VBO);
+    glBufferData(GL_ARRAY_BUFFER, static_cast<GLsizeiptr>(INITIAL_VERTEX_CAPACITY) * m_VertexSize, nullptr,
+                 GL_STATIC_DRAW);
+
+    glGenBuffers(1, &m_PositionVBO);
+    glBindBuffer(GL_ARRAY_BUFFER, m_PositionVBO);
+    glBufferData(GL_ARRAY_BUFFER, static_cast<GLsizeiptr>(INITIAL_VERTEX_CAPACITY) * m_PositionSize, nullptr,
+                 GL_STATIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    // not through GL_ELEMENT_ARRAY_BUFFER, which would attach it to whatever VAO is bound
+    glGenBuffers(1, &m_EBO);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, m_EBO);
+    glBufferData(GL_COPY_WRITE_BUFFER, INITIAL_INDEX_CAPACITY, nullptr, GL_STATIC_DRAW);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+    m_Vertices.Reset(INITIAL_VERTEX_CAPACITY);
+    m_Indices.Reset(INITIAL_INDEX_CAPACITY);
+    LinkAttributes();
+}
+
+void GeometryArena::Destroy()
+{
+    m_VAO.Destroy();
+    m_PositionVAO.Destroy();
+    glDeleteBuffers(1, &m_VBO);
+    glDeleteBuffers(1, &m_PositionVBO);
+    glDeleteBuffers(1, &m_EBO);
+    m_VBO = 0;
+    m_PositionVBO = 0;
+    m_EBO = 0;
+}
+
+b8 GeometryArena::AllocateVertices(u32 count, Block& block)
+{
+    block = {0, count};
+    if (m_Vertices.Allocate(count, block.offset))
+        return true;
+
+    u32 capacity = 0;
+    if (!GetGrownCapacity(static_cast<u64>(m_Vertices.GetCapacity()) + count, m_Vertices.GetCapacity(),
+                          MAX_BUFFER_SIZE / m_VertexSize, capacity)) {
+        LOG_ERROR("GeometryArena: {0} more vertices would grow the vertex buffer past {1} bytes", count,
+                  MAX_BUFFER_SIZE);
+        block = {0, 0};
+        return false;
+    }
+    GrowVertices(capacity);
+    return m_Vertices.Allocate(count, block.offset);
+}
+
+b8 GeometryArena::AllocateIndices(u32 bytes, Block& block)
+{
+    // 16 and 32-bit indices share the buffer, every block starts 4-byte aligned
+    u64 size = (static_cast<u64>(bytes) + INDEX_ALIGNMENT - 1) / INDEX_ALIGNMENT * INDEX_ALIGNMENT;
+    block = {0, static_cast<u32>(size)};
+    if (size <= MAX_BUFFER_SIZE && m_Indices.Allocate(block.size, block.offset))
+        return true;
+
+    u32 capacity = 0;
+    if (!GetGrownCapacity(m_Indices.GetCapacity() + size, m_Indices.GetCapacity(), MAX_BUFFER_SIZE, capacity)) {
+        LOG_ERROR("GeometryArena: {0} more index bytes would grow the index buffer past {1} bytes", bytes,
+                  MAX_BUFFER_SIZE);
+        block = {0, 0};
+        return false;
+    }
+    GrowIndices(capacity);
+    return m_Indices.Allocate(block.size, block.offset);
+}
+
+void GeometryArena::Free(const Block& vertices, const Block& indices)
+{
+    m_Vertices.Free(vertices.offset, vertices.size);
+    m_Indices.Free(indices.offset, indices.size);
+}
+
+void GeometryArena::UploadVertices(u32 first_vertex, const void* data, u32 count)
+{
+    glBindBuffer(GL_ARRAY_BUFFER, m_VBO);
+    glBufferSubData(GL_ARRAY_BUFFER, static_cast<GLintptr>(first_vertex) * m_VertexSize,
+                    static_cast<GLsizeiptr>(count) * m_VertexSize, data);
+
+    // both vertex layouts start with the position
+    std::vector<u8> positions(static_cast<size_t>(count) * m_PositionSize);
+    const u8* src = static_cast<const u8*>(data);
+    for (u32 i = 0; i < count; i++)
+        std::memcpy(&positions[static_cast<size_t>(i) * m_PositionSize], src + static_cast<size_t>(i) * m_VertexSize,
+                    m_PositionSize);
+    glBindBuffer(GL_ARRAY_BUFFER, m_PositionVBO);
+    glBufferSubData(GL_ARRAY_BUFFER, static_cast<GLintptr>(first_vertex) * m_PositionSize,
+                    static_cast<GLsizeiptr>(positions.size()), positions.data());
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void GeometryArena::UploadIndices(u32 offset, const void* data, u32 bytes)
+{
+    // the element binding is VAO state, upload through the copy target so no VAO is disturbed
+    glBindBuffer(GL_COPY_WRITE_BUFFER, m_EBO);
+    glBufferSubData(GL_COPY_WRITE_BUFFER, offset, bytes, data);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+}
+
+void GeometryArena::Bind()
+{
+    m_VAO.Bind();
+}
+
+void GeometryArena::Unbind()
+{
+    m_VAO.Unbind();
+}
+
+void GeometryArena::BindPositions()
+{
+    m_PositionVAO.Bind();
+}
+
+VertexFormat GeometryArena::GetFormat() const
+{
+    return m_Format;
+}
+
+u32 GeometryArena::GetId() const
+{
+    return m_Id;
+}
+
+GeometryArena::Stats GeometryArena::GetStats() const
+{
+    Stats stats;
+    stats.vertex_bytes = static_cast<u64>(m_Vertices.GetUsed()) * (m_VertexSize + m_PositionSize);
+    stats.vertex_capacity = static_cast<u64>(m_Vertices.GetCapacity()) * (m_VertexSize + m_PositionSize);
+    stats.index_bytes = m_Indices.GetUsed();
+    stats.index_capacity = m_Indices.GetCapacity();
+    stats.free_ranges = m_Vertices.GetFreeRangeCount() + m_Indices.GetFreeRangeCount();
+    return stats;
+}
+
+GeometryArena::Stats GeometryArena::GetTotalStats()
+{
+    Stats total = {0, 0, 0, 0, 0};
+    for (GeometryArena* arena : s_Arenas) {
+        if (!arena)
+            continue;
+        Stats stats = arena->GetStats();
+        total.vertex_bytes += stats.vertex_bytes;
+        total.vertex_capacity += stats.vertex_capacity;
+        total.index_bytes += stats.index_bytes;
+        total.index_capacity += stats.index_capacity;
+        total.free_ranges += stats.free_ranges;
+    }
+    return total;
+}
+
+b8 GeometryArena::GetGrownCapacity(u64 capacity, u32 current, u64 max_capacity, u32& grown)
+{
+    if (capacity > max_capacity)
+        return false;
+    grown = static_cast<u32>(std::max(capacity, std::min<u64>(static_cast<u64>(current) * 2, max_capacity)));
+    return true;
+}
+
+void GeometryArena::GrowVertices(u32 capacity)
+{
+    LOG_TRACE("GeometryArena: Growing vertex buffer to {0} vertices", capacity);
+    GLsizeiptr size = static_cast<GLsizeiptr>(m_Vertices.GetCapacity());
+    m_VBO = ResizeBuffer(m_VBO, size * m_VertexSize, static_cast<GLsizeiptr>(capacity) * m_VertexSize);
+    m_PositionVBO =
+        ResizeBuffer(m_PositionVBO, size * m_PositionSize, static_cast<GLsizeiptr>(capacity) * m_PositionSize);
+    m_Vertices.Grow(capacity);
+
+    // the attribute pointers still reference the old buffer
+    LinkAttributes();
+}
+
+void GeometryArena::GrowIndices(u32 capacity)
+{
+    LOG_TRACE("GeometryArena: Growing index buffer to {0} bytes", capacity);
+    m_EBO = ResizeBuffer(m_EBO, m_Indices.GetCapacity(), capacity);
+    m_Indices.Grow(capacity);
+    LinkAttributes();
+}
+
+u32 GeometryArena::ResizeBuffer(u32 buffer, GLsizeiptr size, GLsizeiptr new_size)
+{
+    u32 resized;
+    glGenBuffers(1, &resized);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, resized);
+    glBufferData(GL_COPY_WRITE_BUFFER, new_size, nullptr, GL_STATIC_DRAW);
+
+    glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+    glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, size);
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+    glDeleteBuffers(1, &buffer);
+    return resized;
+}
+
+void GeometryArena::LinkAttributes()
+{
+    // the element buffer binding is VAO state, the array buffer is picked up by each LinkAttrib
+    m_VAO.Bind();
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_EBO);
+    glBindBuffer(GL_ARRAY_BUFFER, m_VBO);
+
+    if (m_Format == VertexFormat::Packed) {
+        // the integer attributes stay unnormalized, the shader scales them itself
+        // vertex positions + bitangent sign
+        m_VAO.LinkAttrib(0, 4, GL_SHORT, sizeof(PackedVertex), (void*)offsetof(PackedVertex, position));
+        // octahedral vertex normals
+        m_VAO.LinkAttrib(1, 2, GL_SHORT, sizeof(PackedVertex), (void*)offsetof(PackedVertex, normal));
+        // vertex texture coordinates
+        m_VAO.LinkAttrib(2, 2, GL_HALF_FLOAT, sizeof(PackedVertex), (void*)offsetof(PackedVertex, tex_coords));
+        // octahedral vertex tangent
+        m_VAO.LinkAttrib(3, 2, GL_BYTE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, tangent));
+    }
+    else {
+        // vertex positions
+        m_VAO.LinkAttrib(0, 3, GL_FLOAT, sizeof(Vertex), (void*)0);
+        // vertex normals
+        m_VAO.LinkAttrib(1, 3, GL_FLOAT, sizeof(Vertex), (void*)offsetof(Vertex, normal));
+        // vertex texture coordinates
+        m_VAO.LinkAttrib(2, 2, GL_FLOAT, sizeof(Vertex), (void*)offsetof(Vertex, tex_coords));
+        // vertex tangent
+        m_VAO.LinkAttrib(3, 3, GL_FLOAT, sizeof(Vertex), (void*)offsetof(Vertex, tangents));
+        // vertex bitangent
+        m_VAO.LinkAttrib(4, 3, GL_FLOAT, sizeof(Vertex), (void*)offsetof(Vertex, bitangents));
+    }
+
+    // the position stream, read the same way as attribute 0 above so both VAOs produce identical depths
+    m_PositionVAO.Bind();
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_EBO);
+    glBindBuffer(GL_ARRAY_BUFFER, m_PositionVBO);
+    if (m_Format == VertexFormat::Packed)
+        m_PositionVAO.LinkAttrib(0, 4, GL_SHORT, m_PositionSize, (void*)0);
+    else
+        m_PositionVAO.LinkAttrib(0, 3, GL_FLOAT, m_PositionSize, (void*)0);
+
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
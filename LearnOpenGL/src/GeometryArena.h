@@ -0,0 +1,113 @@
+#pragma once
+
+#include "defines.h"
+
+#include "Mesh.h"
+#include "VertexArray.h"
+
+#include <map>
+
+// First-fit sub-allocator over [0, capacity). Freed ranges are merged with their neighbours.
+class RangeAllocator
+{
+public:
+    void Reset(u32 capacity);
+
+    // returns false if no free range is large enough
+    b8 Allocate(u32 size, u32& offset);
+    void Free(u32 offset, u32 size);
+
+    // makes [old capacity, capacity) available
+    void Grow(u32 capacity);
+
+    u32 GetCapacity() const;
+    u32 GetUsed() const;
+    u32 GetFreeRangeCount() const;
+
+private:
+    std::map<u32, u32> m_FreeRanges; // offset -> size
+    u32 m_Capacity = 0;
+    u32 m_Used = 0;
+};
+
+// One vertex buffer, one index buffer and one VAO shared by every model of a vertex format.
+// Models sub-allocate a vertex block and an index block and draw their meshes as base-vertex ranges inside them,
+// so a whole model draws with a single VAO bind. The buffers grow when full; allocated offsets stay valid.
+//
+// The positions are also kept in a stream of their own with a second VAO, for passes that only need depth: 12
+// bytes per vertex instead of the whole Vertex (8 instead of a PackedVertex, whose packed position they keep).
+class GeometryArena
+{
+public:
+    struct Block
+    {
+        u32 offset; // vertices for vertex blocks, bytes for index blocks
+        u32 size;
+    };
+
+    struct Stats
+    {
+        u64 vertex_bytes;
+        u64 vertex_capacity;
+        u64 index_bytes;
+        u64 index_capacity;
+        u32 free_ranges;
+    };
+
+    static const u32 INITIAL_VERTEX_CAPACITY = 1 << 18;
+    static const u32 INITIAL_INDEX_CAPACITY = 4 << 20; // bytes
+    static const u32 INDEX_ALIGNMENT = 4;
+    // largest buffer the arena grows to, in bytes; fits GLsizeiptr and the u32 byte offsets of index blocks
+    static constexpr u64 MAX_BUFFER_SIZE = u64(1) << 31;
+
+    // The arena of a vertex format, created on first use. GL thread only.
+    static GeometryArena& Get(VertexFormat format);
+    static void Shutdown();
+
+    // false if the buffer would have to grow past MAX_BUFFER_SIZE
+    b8 AllocateVertices(u32 count, Block& block);
+    b8 AllocateIndices(u32 bytes, Block& block);
+    void Free(const Block& vertices, const Block& indices);
+
+    void UploadVertices(u32 first_vertex, const void* data, u32 count);
+    void UploadIndices(u32 offset, const void* data, u32 bytes);
+
+    void Bind();
+    void Unbind();
+    // the position-only VAO, same indices and base vertices; attribute 0 as in the full VAO
+    void BindPositions();
+
+    VertexFormat GetFormat() const;
+    // unique per arena, in creation order
+    u32 GetId() const;
+    Stats GetStats() const;
+    static Stats GetTotalStats();
+
+private:
+    GeometryArena(VertexFormat format);
+
+    void Destroy();
+    // to at least capacity elements, doubling where it stays under max_capacity; false if capacity is over it
+    static b8 GetGrownCapacity(u64 capacity, u32 current, u64 max_capacity, u32& grown);
+    void GrowVertices(u32 capacity);
+    void GrowIndices(u32 capacity);
+    void LinkAttributes();
+
+    // copies the first size bytes of buffer into a new buffer of new_size bytes
+    static u32 ResizeBuffer(u32 buffer, GLsizeiptr size, GLsizeiptr new_size);
+
+    VertexFormat m_Format;
+    u32 m_Id;
+    u32 m_VertexSize;
+    u32 m_PositionSize;
+    VertextArray m_VAO;
+    VertextArray m_PositionVAO;
+    u32 m_VBO;
+    u32 m_PositionVBO;
+    u32 m_EBO;
+    RangeAllocator m_Vertices;
+    RangeAllocator m_Indices;
+
+    static GeometryArena* s_Arenas[2];
+    static u32 s_NextId;
+};
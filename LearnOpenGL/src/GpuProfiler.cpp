@@ -0,0 +1,216 @@
+#include "GpuProfiler.h"
+
+#include "Log.h"
+#include "Timer.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+
+GpuProfiler::Frame GpuProfiler::s_Frames[RING_SIZE];
+u64 GpuProfiler::s_FrameNumber = 0;
+b8 GpuProfiler::s_Supported = false;
+b8 GpuProfiler::s_InFrame = false;
+std::vector<GpuProfiler::Result> GpuProfiler::s_Results;
+std::unordered_map<std::string, f64> GpuProfiler::s_Averages;
+std::vector<GpuProfiler::TraceEvent> GpuProfiler::s_Trace;
+std::string GpuProfiler::s_TracePath;
+u32 GpuProfiler::s_TraceFrames = 0;
+GpuProfiler::Stats GpuProfiler::s_Stats = {0, 0, 0, 0};
+
+void GpuProfiler::Init()
+{
+    GLint bits = 0;
+    glGetQueryiv(GL_TIMESTAMP, GL_QUERY_COUNTER_BITS, &bits);
+    s_Stats.timestamp_bits = bits;
+    s_Supported = bits > 0;
+    if (s_Supported)
+        LOG_INFO("GpuProfiler: {0}-bit timestamps, read back after {1} frames", bits, RING_SIZE);
+    else
+        LOG_WARN("GpuProfiler: the driver has no timestamp queries, GPU profiling is off");
+}
+
+void GpuProfiler::Shutdown()
+{
+    if (s_TraceFrames > 0 && !s_Trace.empty())
+        WriteTrace();
+    for (Frame& frame : s_Frames) {
+        if (!frame.queries.empty())
+            glDeleteQueries(static_cast<GLsizei>(frame.queries.size()), frame.queries.data());
+        frame = Frame();
+    }
+    s_Results.clear();
+    s_Averages.clear();
+    s_Supported = false;
+}
+
+b8 GpuProfiler::IsSupported()
+{
+    return s_Supported;
+}
+
+void GpuProfiler::BeginFrame()
+{
+    if (!s_Supported)
+        return;
+
+    s_FrameNumber++;
+    Frame& frame = s_Frames[s_FrameNumber % RING_SIZE];
+    if (frame.pending)
+        Read(frame);
+
+    frame.used = 0;
+    frame.scopes.clear();
+    frame.open.clear();
+    frame.number = s_FrameNumber;
+    s_InFrame = true;
+    Begin("Frame");
+}
+
+void GpuProfiler::EndFrame()
+{
+    if (!s_InFrame)
+        return;
+
+    Frame& frame = s_Frames[s_FrameNumber % RING_SIZE];
+    if (frame.open.size() > 1)
+        LOG_WARN("GpuProfiler: {0} scopes still open at the end of the frame", frame.open.size() - 1);
+    while (!frame.open.empty())
+        End();
+    frame.pending = true;
+    s_InFrame = false;
+}
+
+void GpuProfiler::Begin(const char* name)
+{
+    if (!s_InFrame)
+        return;
+
+    Frame& frame = s_Frames[s_FrameNumber % RING_SIZE];
+    u32 depth = static_cast<u32>(frame.open.size());
+    frame.open.push_back(static_cast<u32>(frame.scopes.size()));
+    frame.scopes.push_back({name, depth, WriteTimestamp(frame), 0});
+}
+
+void GpuProfiler::End()
+{
+    if (!s_InFrame)
+        return;
+
+    Frame& frame = s_Frames[s_FrameNumber % RING_SIZE];
+    if (frame.open.empty()) {
+        LOG_WARN("GpuProfiler: End without Begin");
+        return;
+    }
+    frame.scopes[frame.open.back()].end = WriteTimestamp(frame);
+    frame.open.pop_back();
+}
+
+u32 GpuProfiler::WriteTimestamp(Frame& frame)
+{
+    if (frame.used == frame.queries.size()) {
+        u32 query;
+        glGenQueries(1, &query);
+        frame.queries.push_back(query);
+    }
+    glQueryCounter(frame.queries[frame.used], GL_TIMESTAMP);
+    return frame.used++;
+}
+
+void GpuProfiler::Read(Frame& frame)
+{
+    frame.pending = false;
+
+    // timestamps needn't finish in order, so every one is checked before any is read
+    for (u32 i = 0; i < frame.used; i++) {
+        GLint done = 0;
+        glGetQueryObjectiv(frame.queries[i], GL_QUERY_RESULT_AVAILABLE, &done);
+        if (!done) {
+            s_Stats.frames_dropped++;
+            return;
+        }
+    }
+
+    std::vector<GLuint64> timestamps(frame.used);
+    for (u32 i = 0; i < frame.used; i++)
+        glGetQueryObjectui64v(frame.queries[i], GL_QUERY_RESULT, &timestamps[i]);
+
+    // each scope's path is its parent's plus its name, so scopes are averaged with their namesakes of past frames
+    std::vector<std::string> paths;
+    s_Results.clear();
+    for (const ScopeRecord& scope : frame.scopes) {
+        paths.resize(scope.depth + 1);
+        paths[scope.depth] = scope.depth > 0 ? paths[scope.depth - 1] + "/" + scope.name : scope.name;
+
+        u64 begin = timestamps[scope.begin];
+        u64 end = std::max<u64>(timestamps[scope.end], begin);
+        f64 ms = (end - begin) / 1e6;
+        f64& average = s_Averages[paths[scope.depth]];
+        UpdateRunningAverage(average, ms);
+        s_Results.push_back({scope.name, scope.depth, ms, average});
+
+        if (s_TraceFrames > 0)
+            s_Trace.push_back({scope.name, frame.number, begin, end});
+    }
+    s_Stats.frames_read++;
+    s_Stats.queries = frame.used;
+
+    if (s_TraceFrames > 0 && --s_TraceFrames == 0)
+        WriteTrace();
+}
+
+void GpuProfiler::CaptureTrace(u32 frames, const std::string& path)
+{
+    s_Trace.clear();
+    s_TracePath = path;
+    s_TraceFrames = s_Supported ? frames : 0;
+    if (!s_Supported)
+        LOG_WARN("GpuProfiler: no timestamp queries, nothing to capture");
+}
+
+b8 GpuProfiler::IsCapturing()
+{
+    return s_TraceFrames > 0;
+}
+
+void GpuProfiler::WriteTrace()
+{
+    s_TraceFrames = 0;
+    std::ofstream out(s_TracePath, std::ios::trunc);
+    if (!out) {
+        LOG_ERROR("GpuProfiler: Failed to open {0} for writing", s_TracePath);
+        s_Trace.clear();
+        return;
+    }
+
+    // complete ("X") events in microseconds from the first scope; nesting follows from the times
+    u64 origin = s_Trace.empty() ? 0 : s_Trace.front().begin;
+    for (const TraceEvent& event : s_Trace)
+        origin = std::min(origin, event.begin);
+    out << std::fixed << std::setprecision(3);
+    out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    out << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":1,\"args\":{\"name\":\"GPU\"}}";
+    for (const TraceEvent& event : s_Trace) {
+        out << ",\n{\"name\":\"" << event.name << "\",\"cat\":\"gpu\",\"ph\":\"X\",\"pid\":1,\"tid\":1,\"ts\":"
+            << (event.begin - origin) / 1e3 << ",\"dur\":" << (event.end - event.begin) / 1e3
+            << ",\"args\":{\"frame\":" << event.frame << "}}";
+    }
+    out << "\n]}\n";
+    out.close();
+
+    if (!out)
+        LOG_ERROR("GpuProfiler: Failed to write {0}", s_TracePath);
+    else
+        LOG_INFO("GpuProfiler: {0} scopes written to {1}", s_Trace.size(), s_TracePath);
+    s_Trace.clear();
+}
+
+const std::vector<GpuProfiler::Result>& GpuProfiler::GetResults()
+{
+    return s_Results;
+}
+
+GpuProfiler::Stats GpuProfiler::GetStats()
+{
+    return s_Stats;
+}
@@ -0,0 +1,115 @@
+#pragma once
+
+#include "defines.h"
+
+#include <glad/glad.h>
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// GPU time of named, nested scopes, from a GL_TIMESTAMP query at either end of each.
+//
+// Timestamps rather than GL_TIME_ELAPSED queries, so scopes can nest and can wrap the GL_TIME_ELAPSED timers of
+// OcclusionCuller, DeferredRenderer and ShadowCascades, which would otherwise end each other's queries. A frame's
+// queries are read back RING_SIZE frames later; if they aren't done by then the frame is dropped rather than
+// waited for. Every frame is one "Frame" scope around the scopes opened between BeginFrame and EndFrame.
+// Drivers without timestamp bits (GL_QUERY_COUNTER_BITS of 0) leave the profiler off. GL thread only.
+class GpuProfiler
+{
+public:
+    static constexpr u32 RING_SIZE = 4;
+    static constexpr const char* TRACE_PATH = "gpu_trace.json";
+
+    // Opens a scope for its lifetime. name must outlive the profiler, a string literal.
+    class Scope
+    {
+    public:
+        explicit Scope(const char* name) { GpuProfiler::Begin(name); }
+        ~Scope() { GpuProfiler::End(); }
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+    };
+
+    // one scope of the latest frame read back, in the order they were opened
+    struct Result
+    {
+        const char* name;
+        u32 depth;      // 0 for the frame itself
+        f64 ms;
+        f64 average_ms; // running average of the scope with the same path
+    };
+
+    struct Stats
+    {
+        u64 frames_read;
+        u64 frames_dropped; // their queries weren't done after RING_SIZE frames
+        u32 queries;        // timestamps written in the latest frame read
+        i32 timestamp_bits;
+    };
+
+    static void Init();
+    static void Shutdown();
+
+    static b8 IsSupported();
+
+    // Reads back the frame RING_SIZE frames old and opens this frame's "Frame" scope
+    static void BeginFrame();
+    // Closes the "Frame" scope, and any left open with a warning
+    static void EndFrame();
+
+    static void Begin(const char* name);
+    static void End();
+
+    // Writes the next frames read back to path as Chrome trace_event JSON, for chrome://tracing or Perfetto.
+    // Replaces a capture already running.
+    static void CaptureTrace(u32 frames, const std::string& path);
+    static b8 IsCapturing();
+
+    static const std::vector<Result>& GetResults();
+    static Stats GetStats();
+
+private:
+    struct ScopeRecord
+    {
+        const char* name;
+        u32 depth;
+        u32 begin; // index into the frame's queries
+        u32 end;
+    };
+
+    struct Frame
+    {
+        std::vector<u32> queries; // grown on demand and kept
+        u32 used = 0;
+        std::vector<ScopeRecord> scopes;
+        std::vector<u32> open; // scopes not ended yet, innermost last
+        u64 number = 0;
+        b8 pending = false; // ended and not read back yet
+    };
+
+    struct TraceEvent
+    {
+        const char* name;
+        u64 frame;
+        u64 begin; // ns, GPU clock
+        u64 end;
+    };
+
+    // writes a timestamp into the next free query of frame, returns its index
+    static u32 WriteTimestamp(Frame& frame);
+    static void Read(Frame& frame);
+    static void WriteTrace();
+
+    static Frame s_Frames[RING_SIZE];
+    static u64 s_FrameNumber;
+    static b8 s_Supported;
+    static b8 s_InFrame;
+    static std::vector<Result> s_Results;
+    static std::unordered_map<std::string, f64> s_Averages; // by path, "Frame/Scene/Draws"
+    static std::vector<TraceEvent> s_Trace;
+    static std::string s_TracePath;
+    static u32 s_TraceFrames; // still to capture
+    static Stats s_Stats;
+};
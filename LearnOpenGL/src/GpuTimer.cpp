@@ -0,0 +1,45 @@
+#include "GpuTimer.h"
+
+void GpuTimer::Init()
+{
+    glGenQueries(FRAMES_IN_FLIGHT, m_Queries);
+}
+
+void GpuTimer::Shutdown()
+{
+    glDeleteQueries(FRAMES_IN_FLIGHT, m_Queries);
+    for (u32 i = 0; i < FRAMES_IN_FLIGHT; i++) {
+        m_Queries[i] = 0;
+        m_Issued[i] = false;
+    }
+}
+
+void GpuTimer::Begin(u32 frame)
+{
+    u32 slot = frame % FRAMES_IN_FLIGHT;
+    glBeginQuery(GL_TIME_ELAPSED, m_Queries[slot]);
+    m_Issued[slot] = true;
+}
+
+void GpuTimer::End()
+{
+    glEndQuery(GL_TIME_ELAPSED);
+}
+
+GpuTimer::Sample GpuTimer::Read(u32 frame, f64& ms)
+{
+    u32 slot = frame % FRAMES_IN_FLIGHT;
+    if (!m_Issued[slot])
+        return Sample::None;
+    m_Issued[slot] = false;
+
+    u32 done = 0;
+    glGetQueryObjectuiv(m_Queries[slot], GL_QUERY_RESULT_AVAILABLE, &done);
+    if (!done)
+        return Sample::Dropped;
+
+    GLuint64 elapsed = 0;
+    glGetQueryObjectui64v(m_Queries[slot], GL_QUERY_RESULT, &elapsed);
+    ms = elapsed / 1e6;
+    return Sample::Ready;
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include "defines.h"
+
+#include <glad/glad.h>
+
+// GPU time of a stretch of commands, from a GL_TIME_ELAPSED query per frame in flight.
+//
+// The caller numbers its frames. A frame's query is read back when its slot comes round again, FRAMES_IN_FLIGHT
+// frames later, and the sample is dropped rather than waited for if the result hasn't arrived by then.
+// GL_TIME_ELAPSED queries can't nest, so only one timer may be open at a time. GL thread only.
+class GpuTimer
+{
+public:
+    static const u32 FRAMES_IN_FLIGHT = 3;
+
+    enum class Sample
+    {
+        None,    // nothing was timed in that frame
+        Dropped, // the result hadn't arrived in time
+        Ready
+    };
+
+    void Init();
+    void Shutdown();
+
+    void Begin(u32 frame);
+    // ends the open timer, whichever it is
+    static void End();
+
+    // Reads back what was timed in the slot of frame, in milliseconds, and frees the slot to be timed again.
+    // ms is left alone unless the sample is Ready.
+    Sample Read(u32 frame, f64& ms);
+
+private:
+    u32 m_Queries[FRAMES_IN_FLIGHT] = {};
+    b8 m_Issued[FRAMES_IN_FLIGHT] = {};
+};
@@ -0,0 +1,25 @@
+#pragma once
+
+#include "defines.h"
+
+#include <string>
+
+const u64 FNV1A_OFFSET_BASIS = 0xcbf29ce484222325ull;
+const u64 FNV1A_PRIME = 0x100000001b3ull;
+
+// 64-bit FNV-1a hash, chainable through the seed parameter.
+inline u64 HashBytes(const void* data, u64 size, u64 seed = FNV1A_OFFSET_BASIS)
+{
+    const u8* bytes = static_cast<const u8*>(data);
+    u64 hash = seed;
+    for (u64 i = 0; i < size; i++) {
+        hash ^= bytes[i];
+        hash *= FNV1A_PRIME;
+    }
+    return hash;
+}
+
+inline u64 HashString(const std::string& str, u64 seed = FNV1A_OFFSET_BASIS)
+{
+    return HashBytes(str.data(), str.size(), seed);
+}
@@ -1,6 +1,22 @@
 #include "ImGuiLayer.h"
 #include "imgui.h"
 
+#include "DeferredRenderer.h"
+#include "Frustum.h"
+#include "GeometryArena.h"
+#include "GpuProfiler.h"
+#include "LightManager.h"
+#include "Model.h"
+#include "ModelLoader.h"
+#include "OcclusionCuller.h"
+#include "RenderQueue.h"
+#include "ShaderManager.h"
+#include "ShadowCascades.h"
+#include "StressScene.h"
+#include "TextureRegistry.h"
+#include "TextureStreamer.h"
+
+#include <cmath>
 #include <iostream>
 
 ImGuiLayer::ImGuiLayer()
@@ -86,6 +102,68 @@ void ImGuiLayer::OnImGuiRender(ImTextureID texture, ImVec2 image_size)
     ImGui::End();
 
     ImGui::Begin("Render Settings");
+
+    bool sort_draws = RenderQueue::IsSorting();
+    if (ImGui::Checkbox("Sort draws by state", &sort_draws))
+        RenderQueue::SetSorting(sort_draws);
+
+    const char* shading_paths[] = {"Forward", "Deferred"};
+    i32 shading_path = static_cast<i32>(DeferredRenderer::GetPath());
+    if (ImGui::Combo("Shading", &shading_path, shading_paths, IM_ARRAYSIZE(shading_paths)))
+        DeferredRenderer::SetPath(static_cast<ShadingPath>(shading_path));
+
+    bool depth_prepass = RenderQueue::IsDepthPrepass();
+    if (ImGui::Checkbox("Depth pre-pass", &depth_prepass))
+        RenderQueue::SetDepthPrepass(depth_prepass);
+
+    const char* occlusion_modes[] = {"Off", "Previous frame", "Conditional render"};
+    i32 occlusion_mode = static_cast<i32>(OcclusionCuller::GetMode());
+    if (ImGui::Combo("Occlusion culling", &occlusion_mode, occlusion_modes, IM_ARRAYSIZE(occlusion_modes)))
+        OcclusionCuller::SetMode(static_cast<OcclusionMode>(occlusion_mode));
+
+    bool lod_enabled = Model::IsLodEnabled();
+    if (ImGui::Checkbox("Levels of detail", &lod_enabled))
+        Model::SetLodEnabled(lod_enabled);
+    f32 lod_threshold = Model::GetLodThreshold();
+    if (ImGui::SliderFloat("LOD error (pixels)", &lod_threshold, 0.25f, 8.0f))
+        Model::SetLodThreshold(lod_threshold);
+
+    const char* stress_modes[] = {"Off", "Submit per copy", "Instanced"};
+    i32 stress_mode = static_cast<i32>(StressScene::GetMode());
+    if (ImGui::Combo("Stress scene", &stress_mode, stress_modes, IM_ARRAYSIZE(stress_modes)))
+        StressScene::SetMode(static_cast<StressMode>(stress_mode));
+    i32 stress_count = static_cast<i32>(StressScene::GetCount());
+    if (ImGui::SliderInt("Stress copies", &stress_count, 1, 20000))
+        StressScene::SetCount(static_cast<u32>(stress_count));
+
+    bool shadows = ShadowCascades::IsEnabled();
+    if (ImGui::Checkbox("Sun shadows", &shadows))
+        ShadowCascades::SetEnabled(shadows);
+    // degrees around the vertical axis and above the horizon; turning the sun redraws every cascade's cache
+    glm::vec3 sun = ShadowCascades::GetLightDirection();
+    f32 sun_azimuth = glm::degrees(std::atan2(sun.z, sun.x));
+    f32 sun_elevation = glm::degrees(std::asin(-sun.y));
+    b8 sun_changed = ImGui::SliderFloat("Sun azimuth", &sun_azimuth, -180.0f, 180.0f);
+    sun_changed |= ImGui::SliderFloat("Sun elevation", &sun_elevation, 5.0f, 89.0f);
+    if (sun_changed) {
+        f32 azimuth = glm::radians(sun_azimuth);
+        f32 elevation = glm::radians(sun_elevation);
+        ShadowCascades::SetLightDirection(glm::vec3(std::cos(elevation) * std::cos(azimuth), -std::sin(elevation),
+                                                    std::cos(elevation) * std::sin(azimuth)));
+    }
+
+    i32 light_count = static_cast<i32>(LightManager::GetCount());
+    if (ImGui::SliderInt("Point lights", &light_count, 0, 10000))
+        LightManager::SetCount(static_cast<u32>(light_count));
+
+    if (ImGui::Button("Reload shaders"))
+        ShaderManager::ReloadAll();
+
+    TextureStreamer::Stats stream_stats = TextureStreamer::GetStats();
+    i32 upload_budget_mb = static_cast<i32>(stream_stats.budget / (1024 * 1024));
+    if (ImGui::SliderInt("Texture upload MB/frame", &upload_budget_mb, 1, 64))
+        TextureStreamer::SetBudget(static_cast<u64>(upload_budget_mb) * 1024 * 1024);
+
     ImGui::End();
 
     ImGui::Begin("Metrics");
@@ -93,6 +171,120 @@ void ImGuiLayer::OnImGuiRender(ImTextureID texture, ImVec2 image_size)
     ImGui::Text("Dear ImGui %s", ImGui::GetVersion());
     ImGui::Text("Application average\n %.3f ms/frame (%.1f FPS)", 1000.0f / io.Framerate, io.Framerate);
 
+    RenderQueue::Stats queue_stats = RenderQueue::GetStats();
+    ImGui::Separator();
+    ImGui::Text("Meshes visible: %u / %u (%s culling)", queue_stats.meshes_visible, queue_stats.meshes_tested,
+                Frustum::GetInstructionSet());
+    ImGui::Text("Node subtrees culled: %u", queue_stats.subtrees_culled);
+    ImGui::Text("Triangles: %.2f M (%.2f M at full detail)", queue_stats.triangles / 1e6,
+                queue_stats.full_triangles / 1e6);
+
+    OcclusionCuller::Stats occlusion_stats = OcclusionCuller::GetStats();
+    ImGui::Text("Occluded draws: %u culled, %u retested, %u queries", occlusion_stats.culled_draws,
+                occlusion_stats.deferred_draws, occlusion_stats.queries);
+    ImGui::Text("Draws GPU: %.3f ms, occlusion queries %.3f ms, ~%.3f ms saved", occlusion_stats.draw_ms,
+                occlusion_stats.query_ms, occlusion_stats.saved_ms);
+    ImGui::Text("Scene GPU: %.3f ms with depth pre-pass (%.3f ms of it pre-pass), %.3f ms without",
+                queue_stats.gpu_ms[1], occlusion_stats.prepass_ms, queue_stats.gpu_ms[0]);
+    ImGui::Text("Draws: %u, texture binds: %u", queue_stats.packets, queue_stats.texture_binds);
+    ImGui::Text("State changes: %u (unsorted %u)", queue_stats.state_changes, queue_stats.unsorted_state_changes);
+    ImGui::Text("Draw loop CPU: %.3f ms (%.2f us/draw)", queue_stats.flush_ms,
+                queue_stats.packets > 0 ? queue_stats.flush_ms * 1000.0 / queue_stats.packets : 0.0);
+    ImGui::Text("Unknown uniform lookups: %u", Shader::GetUnknownUniformLookups());
+
+    StressScene::Stats stress_stats = StressScene::GetStats();
+    if (StressScene::GetMode() != StressMode::Off) {
+        ImGui::Text("Stress copies: %u, %.3f ms CPU", stress_stats.copies, stress_stats.cpu_ms);
+        if (StressScene::GetMode() == StressMode::Instanced)
+            ImGui::Text("Instances drawn: %u", stress_stats.visible);
+    }
+    ImGui::Text("Stress frame: %.2f ms per copy loop, %.2f ms instanced (vsync off)",
+                stress_stats.frame_ms[static_cast<u32>(StressMode::Loop)],
+                stress_stats.frame_ms[static_cast<u32>(StressMode::Instanced)]);
+
+    DeferredRenderer::Stats deferred_stats = DeferredRenderer::GetStats();
+    ImGui::Text("Shading GPU: forward %.3f ms, deferred %.3f ms (lighting pass %.3f ms)",
+                deferred_stats.scene_ms[static_cast<u32>(ShadingPath::Forward)],
+                deferred_stats.scene_ms[static_cast<u32>(ShadingPath::Deferred)], deferred_stats.lighting_ms);
+    ImGui::Text("G-buffer: %u bytes/pixel, %.1f MB", DeferredRenderer::BYTES_PER_PIXEL,
+                deferred_stats.gbuffer_bytes / (1024.0 * 1024.0));
+
+    LightManager::Stats light_stats = LightManager::GetStats();
+    ImGui::Text("Point lights: %u, %u cluster entries (%u clusters lit, at most %u in one)", light_stats.lights,
+                light_stats.indices, light_stats.lit_clusters, light_stats.max_cluster_lights);
+    ImGui::Text("Light binning CPU: %.3f ms (%s), upload %.3f ms", light_stats.bin_ms,
+                ClusterGrid::GetInstructionSet(), light_stats.upload_ms);
+
+    ShadowCascades::Stats shadow_stats = ShadowCascades::GetStats();
+    ImGui::Text("Shadow cascades: %u frames rendered", shadow_stats.frames);
+    for (u32 c = 0; c < ShadowCascades::CASCADE_COUNT; c++) {
+        const ShadowCascades::CascadeStats& cascade = shadow_stats.cascades[c];
+        ImGui::Text(" %u: to %.1f, %.3f/texel, %u re-renders (%.1f%%), static %.3f ms, dynamic %.3f ms", c,
+                    cascade.far_depth, cascade.texel_size, cascade.rerenders,
+                    shadow_stats.frames > 0 ? 100.0 * cascade.rerenders / shadow_stats.frames : 0.0,
+                    cascade.static_ms, cascade.dynamic_ms);
+    }
+
+    ImGui::Separator();
+    GpuProfiler::Stats profiler_stats = GpuProfiler::GetStats();
+    if (!GpuProfiler::IsSupported()) {
+        ImGui::Text("GPU profile: no timestamp queries");
+    }
+    else {
+        ImGui::Text("GPU profile: %llu frames read, %llu dropped, %u timestamps",
+                    static_cast<unsigned long long>(profiler_stats.frames_read),
+                    static_cast<unsigned long long>(profiler_stats.frames_dropped), profiler_stats.queries);
+
+        // the scopes in the order they were opened; children of a collapsed node are skipped
+        const std::vector<GpuProfiler::Result>& results = GpuProfiler::GetResults();
+        u32 open_depth = 0;
+        for (u32 i = 0; i < results.size(); i++) {
+            const GpuProfiler::Result& result = results[i];
+            if (result.depth > open_depth)
+                continue;
+            for (; open_depth > result.depth; open_depth--)
+                ImGui::TreePop();
+
+            b8 leaf = i + 1 == results.size() || results[i + 1].depth <= result.depth;
+            ImGuiTreeNodeFlags flags = ImGuiTreeNodeFlags_DefaultOpen | ImGuiTreeNodeFlags_SpanFullWidth;
+            if (leaf)
+                flags |= ImGuiTreeNodeFlags_Leaf | ImGuiTreeNodeFlags_NoTreePushOnOpen;
+            b8 open = ImGui::TreeNodeEx(reinterpret_cast<void*>(static_cast<intptr_t>(i)), flags,
+                                        "%s: %.3f ms (avg %.3f)", result.name, result.ms, result.average_ms);
+            if (open && !leaf)
+                open_depth++;
+        }
+        for (; open_depth > 0; open_depth--)
+            ImGui::TreePop();
+
+        static i32 trace_frames = 60;
+        ImGui::SliderInt("Trace frames", &trace_frames, 1, 600);
+        if (GpuProfiler::IsCapturing())
+            ImGui::Text("Capturing to %s...", GpuProfiler::TRACE_PATH);
+        else if (ImGui::Button("Capture GPU trace"))
+            GpuProfiler::CaptureTrace(static_cast<u32>(trace_frames), GpuProfiler::TRACE_PATH);
+    }
+
+    ImGui::Separator();
+    ImGui::Text("Models loading: %u", ModelLoader::GetPendingCount());
+    ImGui::Text("Shaders rebuilding: %u, reloaded: %u%s", ShaderManager::GetPendingCount(),
+                ShaderManager::GetReloadCount(), ShaderManager::IsParallelCompileSupported() ? " (parallel)" : "");
+
+    GeometryArena::Stats geometry_stats = GeometryArena::GetTotalStats();
+    ImGui::Text("Geometry: vertices %.1f / %.1f MB, indices %.1f / %.1f MB",
+                geometry_stats.vertex_bytes / (1024.0 * 1024.0), geometry_stats.vertex_capacity / (1024.0 * 1024.0),
+                geometry_stats.index_bytes / (1024.0 * 1024.0), geometry_stats.index_capacity / (1024.0 * 1024.0));
+    ImGui::Text("Geometry free ranges: %u", geometry_stats.free_ranges);
+
+    TextureRegistry::Stats texture_stats = TextureRegistry::GetStats();
+    ImGui::Separator();
+    ImGui::Text("Textures: %u (%.1f MB)", texture_stats.textures, texture_stats.resident_bytes / (1024.0 * 1024.0));
+    ImGui::Text("Texture cache: %u hits / %u misses", texture_stats.hits, texture_stats.misses);
+    ImGui::Text("Texture cache saved: %.1f MB", texture_stats.bytes_saved / (1024.0 * 1024.0));
+    ImGui::Text("Streaming: %u textures, %u levels (%.1f MB)", stream_stats.pending_textures,
+                stream_stats.pending_levels, stream_stats.pending_bytes / (1024.0 * 1024.0));
+    ImGui::Text("Uploaded last frame: %.1f KB", stream_stats.uploaded_bytes / 1024.0);
+
     ImGui::End();
 }
 
@@ -0,0 +1,63 @@
+#include "InstanceBuffer.h"
+
+#include <cstddef>
+
+static const u32 MODEL_COLUMNS = 4;
+static const u32 NORMAL_COLUMNS = 3;
+
+FencedRing InstanceBuffer::s_Ring;
+
+void InstanceBuffer::Init()
+{
+    s_Ring.Init("InstanceBuffer", sizeof(ObjectConstants), INITIAL_CAPACITY);
+}
+
+void InstanceBuffer::Shutdown()
+{
+    s_Ring.Shutdown();
+}
+
+void InstanceBuffer::BeginFrame()
+{
+    s_Ring.BeginFrame();
+}
+
+void InstanceBuffer::EndFrame()
+{
+    s_Ring.EndFrame();
+}
+
+u32 InstanceBuffer::Write(const ObjectConstants* instances, u32 count)
+{
+    return s_Ring.Write(instances, sizeof(ObjectConstants), count);
+}
+
+void InstanceBuffer::Bind(u32 first)
+{
+    // GL 3.3 has no base instance, so the attributes are pointed at the first instance instead
+    size_t base = static_cast<size_t>(s_Ring.GetOffset(first));
+    glBindBuffer(GL_ARRAY_BUFFER, s_Ring.GetBuffer());
+    for (u32 i = 0; i < MODEL_COLUMNS; i++) {
+        u32 location = INSTANCE_ATTRIBUTE_LOCATION + i;
+        size_t offset = base + offsetof(ObjectConstants, model) + i * sizeof(glm::vec4);
+        glEnableVertexAttribArray(location);
+        glVertexAttribPointer(location, 4, GL_FLOAT, GL_FALSE, sizeof(ObjectConstants), (void*)offset);
+        glVertexAttribDivisor(location, 1);
+    }
+    for (u32 i = 0; i < NORMAL_COLUMNS; i++) {
+        u32 location = INSTANCE_ATTRIBUTE_LOCATION + MODEL_COLUMNS + i;
+        size_t offset = base + offsetof(ObjectConstants, normal_matrix) + i * sizeof(glm::vec4);
+        glEnableVertexAttribArray(location);
+        glVertexAttribPointer(location, 3, GL_FLOAT, GL_FALSE, sizeof(ObjectConstants), (void*)offset);
+        glVertexAttribDivisor(location, 1);
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void InstanceBuffer::Unbind()
+{
+    for (u32 i = 0; i < MODEL_COLUMNS + NORMAL_COLUMNS; i++) {
+        glDisableVertexAttribArray(INSTANCE_ATTRIBUTE_LOCATION + i);
+        glVertexAttribDivisor(INSTANCE_ATTRIBUTE_LOCATION + i, 0);
+    }
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include "defines.h"
+
+#include "FencedRing.h"
+#include "UniformBuffers.h"
+
+#include <glad/glad.h>
+
+// First attribute location of the per-instance data in instanced shaders: the model matrix takes four locations
+// from here, the normal matrix the three after it. See `#ifdef INSTANCED` in normal_mapping_vs.glsl.
+const u32 INSTANCE_ATTRIBUTE_LOCATION = 5;
+
+// Per-instance transforms for instanced draws, stored as ObjectConstants and read as vertex attributes with a
+// divisor of 1.
+//
+// A FencedRing like the object blocks of UniformBuffers, with one segment per frame in flight. GL thread only.
+class InstanceBuffer
+{
+public:
+    static void Init();
+    static void Shutdown();
+
+    // Moves to the next segment. Once per frame, before the first Write.
+    static void BeginFrame();
+    static void EndFrame();
+
+    // Copies count instances into this frame's segment, returns the index of the first one.
+    // Instances stay valid until the end of the frame.
+    static u32 Write(const ObjectConstants* instances, u32 count);
+
+    // Points the instance attributes of the bound VAO at the instances from first on. Unbind turns them off again
+    // before the VAO is used for regular draws.
+    static void Bind(u32 first);
+    static void Unbind();
+
+private:
+    static const u32 INITIAL_CAPACITY = 4096; // instances per frame
+
+    static FencedRing s_Ring;
+};
@@ -0,0 +1,180 @@
+#include "LightManager.h"
+
+#include "Log.h"
+#include "Timer.h"
+
+#include <glad/glad.h>
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+
+// the lights circle their anchors this far, in world units
+static const f32 ANIMATION_RADIUS = 2.0f;
+static const f32 MIN_LIGHT_RADIUS = 3.0f;
+static const f32 MAX_LIGHT_RADIUS = 8.0f;
+
+enum LightBuffer
+{
+    LightData = 0,
+    LightClusters,
+    LightIndices
+};
+
+static const char* const SAMPLER_NAMES[] = {"lightData", "lightClusters", "lightIndices"};
+static const GLenum TEXEL_FORMATS[] = {GL_RGBA32F, GL_RG32UI, GL_R16UI};
+
+// around the Sponza atrium as Main places it
+const glm::vec3 LightManager::AREA_MIN(-50.0f, -5.0f, -85.0f);
+const glm::vec3 LightManager::AREA_MAX(50.0f, 25.0f, 85.0f);
+
+ThreadPool* LightManager::s_Pool = nullptr;
+PointLights LightManager::s_Anchors;
+PointLights LightManager::s_Lights;
+ClusterGrid LightManager::s_Grid;
+std::vector<glm::vec4> LightManager::s_LightData;
+u32 LightManager::s_Buffers[3] = {0, 0, 0};
+u32 LightManager::s_Textures[3] = {0, 0, 0};
+glm::vec2 LightManager::s_PixelScale(0.0f);
+u32 LightManager::s_Count = 0;
+LightManager::Stats LightManager::s_Stats = {0, 0, 0, 0, 0.0, 0.0};
+
+// replaces the buffer's data store, so the upload never waits for draws still reading the old one
+static void UploadBuffer(u32 buffer, const void* data, size_t size)
+{
+    glBindBuffer(GL_TEXTURE_BUFFER, buffer);
+    glBufferData(GL_TEXTURE_BUFFER, static_cast<GLsizeiptr>(std::max<size_t>(size, 16)), nullptr, GL_STREAM_DRAW);
+    if (size > 0)
+        glBufferSubData(GL_TEXTURE_BUFFER, 0, static_cast<GLsizeiptr>(size), data);
+}
+
+void LightManager::Init(u32 thread_count)
+{
+    s_Pool = new ThreadPool(thread_count);
+
+    glGenBuffers(3, s_Buffers);
+    glGenTextures(3, s_Textures);
+    for (u32 i = 0; i < 3; i++) {
+        UploadBuffer(s_Buffers[i], nullptr, 0);
+        glBindTexture(GL_TEXTURE_BUFFER, s_Textures[i]);
+        glTexBuffer(GL_TEXTURE_BUFFER, TEXEL_FORMATS[i], s_Buffers[i]);
+    }
+    glBindTexture(GL_TEXTURE_BUFFER, 0);
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+
+    SetCount(DEFAULT_COUNT);
+    LOG_INFO("LightManager: {0}x{1}x{2} clusters, binned on {3} threads ({4})", ClusterGrid::GRID_X,
+             ClusterGrid::GRID_Y, ClusterGrid::GRID_Z, s_Pool->GetThreadCount(), ClusterGrid::GetInstructionSet());
+}
+
+void LightManager::Shutdown()
+{
+    delete s_Pool;
+    s_Pool = nullptr;
+
+    glDeleteTextures(3, s_Textures);
+    glDeleteBuffers(3, s_Buffers);
+    for (u32 i = 0; i < 3; i++) {
+        s_Textures[i] = 0;
+        s_Buffers[i] = 0;
+    }
+}
+
+void LightManager::SetCount(u32 count)
+{
+    count = std::min(count, ClusterGrid::MAX_LIGHTS);
+    if (count == s_Count)
+        return;
+    s_Count = count;
+
+    // the same seed every time, so a light count always gives the same scene
+    std::mt19937 rng(1234);
+    std::uniform_real_distribution<f32> unit(0.0f, 1.0f);
+    s_Anchors.Clear();
+    for (u32 i = 0; i < count; i++) {
+        glm::vec3 position(AREA_MIN.x + (AREA_MAX.x - AREA_MIN.x) * unit(rng),
+                           AREA_MIN.y + (AREA_MAX.y - AREA_MIN.y) * unit(rng),
+                           AREA_MIN.z + (AREA_MAX.z - AREA_MIN.z) * unit(rng));
+        f32 radius = MIN_LIGHT_RADIUS + (MAX_LIGHT_RADIUS - MIN_LIGHT_RADIUS) * unit(rng);
+        glm::vec3 color(0.1f + 0.9f * unit(rng), 0.1f + 0.9f * unit(rng), 0.1f + 0.9f * unit(rng));
+        s_Anchors.Add(position, radius, color / std::max(color.x, std::max(color.y, color.z)));
+    }
+    s_Lights = s_Anchors;
+}
+
+u32 LightManager::GetCount()
+{
+    return s_Count;
+}
+
+void LightManager::Update(f64 time, const glm::mat4& view, f32 fov_y, f32 aspect, f32 near_plane, f32 far_plane,
+                          u32 width, u32 height)
+{
+    Timer timer;
+
+    // every light on its own phase, from the golden ratio so neighbours don't move in step
+    f32 t = static_cast<f32>(time);
+    for (u32 i = 0; i < s_Count; i++) {
+        f32 phase = i * 2.3999632f;
+        s_Lights.position_x[i] = s_Anchors.position_x[i] + ANIMATION_RADIUS * std::sin(0.7f * t + phase);
+        s_Lights.position_y[i] = s_Anchors.position_y[i] + ANIMATION_RADIUS * 0.5f * std::cos(1.3f * t + phase);
+        s_Lights.position_z[i] = s_Anchors.position_z[i] + ANIMATION_RADIUS * std::cos(0.7f * t + phase);
+    }
+
+    s_Grid.Configure(fov_y, aspect, near_plane, far_plane);
+    s_Grid.Bin(s_Lights, view, s_Pool);
+    s_PixelScale = glm::vec2(static_cast<f32>(ClusterGrid::GRID_X) / width,
+                             static_cast<f32>(ClusterGrid::GRID_Y) / height);
+    s_Stats.bin_ms = timer.ElapsedMillis();
+
+    timer.Reset();
+    s_LightData.resize(s_Count * 2);
+    for (u32 i = 0; i < s_Count; i++) {
+        s_LightData[i * 2] = glm::vec4(s_Lights.position_x[i], s_Lights.position_y[i], s_Lights.position_z[i],
+                                       s_Lights.radius[i]);
+        s_LightData[i * 2 + 1] = glm::vec4(s_Lights.color_r[i], s_Lights.color_g[i], s_Lights.color_b[i], 0.0f);
+    }
+    const std::vector<ClusterGrid::Cluster>& clusters = s_Grid.GetClusters();
+    const std::vector<u16>& indices = s_Grid.GetIndices();
+    UploadBuffer(s_Buffers[LightData], s_LightData.data(), s_LightData.size() * sizeof(glm::vec4));
+    UploadBuffer(s_Buffers[LightClusters], clusters.data(), clusters.size() * sizeof(ClusterGrid::Cluster));
+    UploadBuffer(s_Buffers[LightIndices], indices.data(), indices.size() * sizeof(u16));
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+    s_Stats.upload_ms = timer.ElapsedMillis();
+
+    s_Stats.lights = s_Count;
+    s_Stats.indices = static_cast<u32>(indices.size());
+    s_Stats.max_cluster_lights = s_Grid.GetMaxClusterLights();
+    s_Stats.lit_clusters = static_cast<u32>(std::count_if(
+        clusters.begin(), clusters.end(), [](const ClusterGrid::Cluster& cluster) { return cluster.count > 0; }));
+}
+
+void LightManager::WriteFrameConstants(FrameConstants& constants)
+{
+    constants.cluster_scale = glm::vec4(s_PixelScale.x, s_PixelScale.y, s_Grid.GetSliceScale(), s_Grid.GetSliceBias());
+    constants.cluster_grid = glm::vec4(static_cast<f32>(ClusterGrid::GRID_X), static_cast<f32>(ClusterGrid::GRID_Y),
+                                       static_cast<f32>(ClusterGrid::GRID_Z), static_cast<f32>(s_Count));
+}
+
+void LightManager::Bind()
+{
+    for (u32 i = 0; i < 3; i++) {
+        glActiveTexture(GL_TEXTURE0 + FIRST_TEXTURE_UNIT + i);
+        glBindTexture(GL_TEXTURE_BUFFER, s_Textures[i]);
+    }
+    glActiveTexture(GL_TEXTURE0);
+}
+
+void LightManager::AssignTextureUnits(Shader& shader)
+{
+    shader.Use();
+    for (u32 i = 0; i < 3; i++) {
+        if (shader.HasUniform(SAMPLER_NAMES[i]))
+            shader.SetInt(SAMPLER_NAMES[i], static_cast<i32>(FIRST_TEXTURE_UNIT + i));
+    }
+}
+
+LightManager::Stats LightManager::GetStats()
+{
+    return s_Stats;
+}
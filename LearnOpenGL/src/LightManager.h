@@ -0,0 +1,76 @@
+#pragma once
+
+#include "defines.h"
+
+#include "ClusterGrid.h"
+#include "Shader.h"
+#include "ThreadPool.h"
+#include "UniformBuffers.h"
+
+#include <glm/glm.hpp>
+
+#include <vector>
+
+// Dynamic point lights with clustered forward shading. Every frame the lights are animated, binned into a
+// ClusterGrid on worker threads and uploaded through three texture buffers, from which normal_mapping_fs.glsl
+// reads only the lights of its fragment's cluster:
+//   lightData     RGBA32F, two texels per light: position and radius, color
+//   lightClusters RG32UI, per cluster the first index and count in lightIndices
+//   lightIndices  R16UI, the lights of every cluster back to back
+// GL thread only, apart from the binning jobs Update waits for.
+class LightManager
+{
+public:
+    // texture units of the three buffers, after Mesh's material units
+    static const u32 FIRST_TEXTURE_UNIT = 12;
+    static const u32 DEFAULT_COUNT = 4;
+
+    struct Stats
+    {
+        u32 lights;
+        u32 indices;            // light references over all clusters
+        u32 lit_clusters;       // with at least one light
+        u32 max_cluster_lights; // in a single cluster
+        f64 bin_ms;             // animating and binning
+        f64 upload_ms;          // filling the texture buffers
+    };
+
+    // thread_count == 0 uses one binning thread per hardware thread
+    static void Init(u32 thread_count);
+    static void Shutdown();
+
+    // Regenerates count lights scattered over the scene, at most ClusterGrid::MAX_LIGHTS
+    static void SetCount(u32 count);
+    static u32 GetCount();
+
+    // Animates the lights to time, bins them for the camera and uploads the cluster lists. Once per frame,
+    // before the frame constants are written; width and height are the size of the target in pixels.
+    static void Update(f64 time, const glm::mat4& view, f32 fov_y, f32 aspect, f32 near_plane, f32 far_plane,
+                       u32 width, u32 height);
+
+    // the cluster grid parameters of `uniform Frame`
+    static void WriteFrameConstants(FrameConstants& constants);
+
+    // binds the three buffers to their texture units
+    static void Bind();
+
+    // points the shader's light samplers, if it has them, at their texture units
+    static void AssignTextureUnits(Shader& shader);
+
+    static Stats GetStats();
+
+private:
+    static const glm::vec3 AREA_MIN;
+    static const glm::vec3 AREA_MAX;
+
+    static ThreadPool* s_Pool;
+    static PointLights s_Anchors; // positions the animated lights circle around
+    static PointLights s_Lights;
+    static ClusterGrid s_Grid;
+    static std::vector<glm::vec4> s_LightData; // staging for lightData
+    static u32 s_Buffers[3];
+    static u32 s_Textures[3];
+    static glm::vec2 s_PixelScale; // clusters per pixel
+    static u32 s_Count;
+    static Stats s_Stats;
+};
@@ -6,15 +6,33 @@
 #include <glm/gtc/type_ptr.hpp>
 
 #include <cmath>
+#include <cstdlib>
 #include <iostream>
 
 #include "Camera.h"
+#include "DeferredRenderer.h"
+#include "GeometryArena.h"
+#include "GpuProfiler.h"
 #include "ImGui/ImGuiLayer.h"
 #include "IndexBuffer.h"
+#include "InstanceBuffer.h"
+#include "LightManager.h"
 #include "Log.h"
 #include "Model.h"
+#include "ModelLoader.h"
+#include "OcclusionCuller.h"
+#include "ProgramCache.h"
+#include "RenderQueue.h"
 #include "Shader.h"
+#include "ShaderManager.h"
+#include "ShadowCascades.h"
+#include "StressScene.h"
 #include "Texture2D.h"
+#include "TextureLoader.h"
+#include "TextureRegistry.h"
+#include "TextureStreamer.h"
+#include "Timer.h"
+#include "UniformBuffers.h"
 #include "VertexArray.h"
 #include "VertexBuffer.h"
 
@@ -35,6 +53,15 @@ static void GLFWErrorCallback(int error, const char* description)
 const float ASPECT_RATIO = 16.0f / 9.0f;
 const int SCR_WIDTH = 1280;
 const int SCR_HEIGHT = static_cast<int>(SCR_WIDTH / ASPECT_RATIO);
+const u32 TEXTURE_DECODE_THREADS = 0;               // 0 = one per hardware thread
+const u64 TEXTURE_UPLOAD_BUDGET = 8 * 1024 * 1024; // bytes of mip data uploaded per frame
+const u32 MODEL_IMPORT_THREADS = 2;
+const f64 MODEL_FINALIZE_BUDGET_MS = 2.0;           // GL time spent per frame creating the buffers of loaded models
+const VertexFormat MODEL_VERTEX_FORMAT = VertexFormat::Packed;
+const u32 LIGHT_BINNING_THREADS = 0; // 0 = one per hardware thread
+const f32 NEAR_PLANE = 0.1f;
+const f32 FAR_PLANE = 1000.0f;
+const f32 MATERIAL_SHININESS = 64.0f;
 
 // camera
 Camera camera(glm::vec3(0.0f, 5.0f, 5.0f));
@@ -52,6 +79,7 @@ int main()
 {
     // Initialize Logging
     Log::Init();
+    Timer startup_timer;
 
     // glfw: initialize and configure
     // ------------------------------
@@ -102,26 +130,86 @@ int main()
     // -----------------------------
     glEnable(GL_DEPTH_TEST);
 
+    // GPU time per scope; headless runs can ask for a trace of their first frames, e.g. LEARNOPENGL_GPU_TRACE=100
+    GpuProfiler::Init();
+    if (const char* trace_frames = std::getenv("LEARNOPENGL_GPU_TRACE"))
+        GpuProfiler::CaptureTrace(static_cast<u32>(std::atoi(trace_frames)), GpuProfiler::TRACE_PATH);
+
     // initialize ImGui
     // ----------------
     ImGuiLayer* imgui_layer = new ImGuiLayer();
     imgui_layer->OnAttach(window);
 
+    // uniform blocks shared by all programs, bound as each shader is built
+    UniformBuffers::Init();
+    InstanceBuffer::Init();
+
     // build and compile shader program
     // --------------------------------
     // Shader lighting_shader("LearnOpenGL/assets/shaders/lighting_vs.glsl",
     // "LearnOpenGL/assets/shaders/lighting_fs.glsl");
     // Shader shader("assets/shaders/model_loading_vs.glsl", "assets/shaders/model_loading_fs.glsl");
-    Shader light_cube_shader("assets/shaders/light_cube_vs.glsl", "assets/shaders/light_cube_fs.glsl");
-    Shader shader("assets/shaders/normal_mapping_vs.glsl", "assets/shaders/normal_mapping_fs.glsl");
+    // the manager rebuilds them in the background whenever their sources are saved
+    ShaderManager::Init();
+    Shader& light_cube_shader =
+        ShaderManager::Load("assets/shaders/light_cube_vs.glsl", "assets/shaders/light_cube_fs.glsl");
+    std::string model_defines = MODEL_VERTEX_FORMAT == VertexFormat::Packed ? "#define PACKED_VERTEX\n" : "";
+    // the forward and the instanced program share normal_mapping_fs, so both need the same constant state
+    auto assign_model_units = [](Shader& model_shader) {
+        Mesh::AssignTextureUnits(model_shader);
+        LightManager::AssignTextureUnits(model_shader);
+        ShadowCascades::AssignTextureUnits(model_shader);
+        model_shader.Use();
+        model_shader.SetFloat("material.shininess", MATERIAL_SHININESS);
+    };
+    Shader& shader = ShaderManager::Load("assets/shaders/normal_mapping_vs.glsl",
+                                         "assets/shaders/normal_mapping_fs.glsl", model_defines, assign_model_units);
+    Shader& instanced_shader =
+        ShaderManager::Load("assets/shaders/normal_mapping_vs.glsl", "assets/shaders/normal_mapping_fs.glsl",
+                            model_defines + "#define INSTANCED\n", assign_model_units);
+    // the deferred path: the same vertex shaders filling the G-buffer, and the full-screen lighting pass
+    Shader& gbuffer_shader = ShaderManager::Load("assets/shaders/normal_mapping_vs.glsl",
+                                                 "assets/shaders/gbuffer_fs.glsl", model_defines,
+                                                 Mesh::AssignTextureUnits);
+    Shader& instanced_gbuffer_shader =
+        ShaderManager::Load("assets/shaders/normal_mapping_vs.glsl", "assets/shaders/gbuffer_fs.glsl",
+                            model_defines + "#define INSTANCED\n", Mesh::AssignTextureUnits);
+    Shader& deferred_lighting_shader =
+        ShaderManager::Load("assets/shaders/deferred_lighting_vs.glsl", "assets/shaders/deferred_lighting_fs.glsl",
+                            "", [](Shader& lighting_shader) {
+                                DeferredRenderer::AssignTextureUnits(lighting_shader);
+                                LightManager::AssignTextureUnits(lighting_shader);
+                                ShadowCascades::AssignTextureUnits(lighting_shader);
+                            });
+    Shader& depth_shader =
+        ShaderManager::Load("assets/shaders/depth_only_vs.glsl", "assets/shaders/depth_only_fs.glsl", model_defines);
+    RenderQueue::SetDepthShader(MODEL_VERTEX_FORMAT, depth_shader);
+    Shader& shadow_caster_shader = ShaderManager::Load("assets/shaders/depth_only_vs.glsl",
+                                                       "assets/shaders/depth_only_fs.glsl",
+                                                       model_defines + "#define SHADOW_CASTER\n");
+    ShadowCascades::Init(shadow_caster_shader);
+    Shader& occlusion_box_shader =
+        ShaderManager::Load("assets/shaders/occlusion_box_vs.glsl", "assets/shaders/occlusion_box_fs.glsl");
+    OcclusionCuller::Init(occlusion_box_shader);
+
+    ProgramCache::Stats program_stats = ProgramCache::GetStats();
+    LOG_INFO("Shaders: {0} from cache in {1:.2f} ms, {2} compiled in {3:.2f} ms ({4} cached binaries rejected)",
+             program_stats.hits, program_stats.hit_ms, program_stats.misses, program_stats.miss_ms,
+             program_stats.rejected);
+
+    // start the texture decode threads
+    TextureLoader::Init(TEXTURE_DECODE_THREADS);
+    TextureStreamer::Init(TEXTURE_UPLOAD_BUDGET);
+    ModelLoader::Init(MODEL_IMPORT_THREADS);
+    LightManager::Init(LIGHT_BINNING_THREADS);
 
     // load models
     // Model backpack("assets/models/obj/backpack/backpack.obj");
     // Model our_model("assets/models/obj/rifle/MA5D_Assault_Rifle_v008.obj");
     // Model our_model("assets/models/obj/workshop/workshop.obj");
-    Model cyborg("assets/models/obj/cyborg/cyborg.obj");
+    std::shared_ptr<Model> cyborg = ModelLoader::Load("assets/models/obj/cyborg/cyborg.obj", MODEL_VERTEX_FORMAT);
     // Model our_model("assets/models/obj/castle/castle.obj");
-    Model sponza("assets/models/obj/sponza/sponza.obj");
+    std::shared_ptr<Model> sponza = ModelLoader::Load("assets/models/obj/sponza/sponza.obj", MODEL_VERTEX_FORMAT);
     // Model our_model("assets/models/gltf/sponza_atrium/Sponza.gltf");
     // Model our_model("assets/models/gltf/backpack/scene.gltf");
     // Model our_model("assets/models/gltf/bmw/scene.gltf");
@@ -228,8 +316,12 @@ int main()
 
     glBindFramebuffer(GL_FRAMEBUFFER, 0);
 
+    DeferredRenderer::Init(deferred_lighting_shader, tex_width, tex_height);
+
     // render loop
     // -----------
+    b8 first_frame = true;
+    b8 vsync = true;
     while (!glfwWindowShouldClose(window)) {
         // per-frame time logic
         float current_time = static_cast<float>(glfwGetTime());
@@ -238,6 +330,16 @@ int main()
 
         // input
         process_input(window);
+        GpuProfiler::BeginFrame();
+
+        // finalize loaded models, hand finished decodes to the streamer, upload this frame's share of mip levels
+        // and swap in rebuilt shaders
+        GpuProfiler::Begin("Uploads");
+        ModelLoader::Update(MODEL_FINALIZE_BUDGET_MS);
+        TextureLoader::Poll();
+        TextureStreamer::Update();
+        ShaderManager::Update();
+        GpuProfiler::End();
 
         // render
         // ------
@@ -309,13 +411,16 @@ int main()
         // material properties
         // lighting_shader.SetInt("material.diffuse", 0);
         // lighting_shader.SetInt("material.specular", 1);
-        shader.SetFloat("material.shininess", 64.0f);
+        // material.shininess is set on every model program when it's built, see assign_model_units
 
-        // view/projection transformations
-        glm::mat4 projection = glm::perspective(glm::radians(camera.m_Zoom), ASPECT_RATIO, 0.1f, 1000.0f);
+        // view/projection transformations and the light, uploaded once for every program
+        glm::mat4 projection = glm::perspective(glm::radians(camera.m_Zoom), ASPECT_RATIO, NEAR_PLANE, FAR_PLANE);
         glm::mat4 view = camera.GetViewMatrix();
-        shader.SetMat4("projection", projection);
-        shader.SetMat4("view", view);
+
+        // point lights binned into the clusters of this view, the model shaders read them from texture buffers
+        LightManager::Update(current_time, view, glm::radians(camera.m_Zoom), ASPECT_RATIO, NEAR_PLANE, FAR_PLANE,
+                             tex_width, tex_height);
+        LightManager::Bind();
 
         // world transformation
         glm::mat4 model = glm::mat4(1.0f);
@@ -325,27 +430,80 @@ int main()
             // glm::scale(model, glm::vec3(1.0f, 1.0f, 1.0f)); // it's a bit too big for our scene, so scale it down
             glm::scale(model, glm::vec3(0.05f, 0.05f, 0.05f)); // it's a bit too big for our scene, so scale it down
         model = glm::rotate(model, glm::radians(90.0f), glm::vec3(0.0f, 1.0f, 0.0));
-        shader.SetMat4("model", model);
-        shader.SetVec3("viewPos", camera.m_Position);
-        shader.SetVec3("lightPos", light_pos);
-        sponza.Draw(shader);
 
-        model = glm::mat4(1.0f);
-        model = glm::translate(model, glm::vec3(0.0f, 0.0f, -20.0f));
-        model = glm::scale(model, glm::vec3(2.0f, 2.0f, 2.0f));
-        shader.SetMat4("model", model);
-        cyborg.Draw(shader);
+        glm::mat4 cyborg_model = glm::mat4(1.0f);
+        cyborg_model = glm::translate(cyborg_model, glm::vec3(0.0f, 0.0f, -20.0f));
+        cyborg_model = glm::scale(cyborg_model, glm::vec3(2.0f, 2.0f, 2.0f));
+
+        // the sun's cascades follow the camera; Sponza is the static caster and bounds their depth range
+        BoundingBox caster_bounds = {glm::vec3(0.0f), glm::vec3(0.0f)};
+        sponza->GetBounds(model, caster_bounds);
+        ShadowCascades::Update(view, glm::radians(camera.m_Zoom), ASPECT_RATIO, NEAR_PLANE, caster_bounds);
+        ShadowCascades::Bind();
+
+        FrameConstants frame_constants;
+        frame_constants.view = view;
+        frame_constants.projection = projection;
+        frame_constants.view_projection = projection * view;
+        frame_constants.view_position = glm::vec4(camera.m_Position, 1.0f);
+        frame_constants.light_position = glm::vec4(light_pos, 1.0f);
+        LightManager::WriteFrameConstants(frame_constants);
+        ShadowCascades::WriteFrameConstants(frame_constants);
+        UniformBuffers::BeginFrame(frame_constants);
+        InstanceBuffer::BeginFrame();
+
+        // Sponza's depth comes from the caches, only the cyborg is drawn into the cascades every frame;
+        // the stress scene's copies cast no shadows
+        ShadowCascades::Render(
+            [&](Shader& caster_shader, const Frustum& cascade) { sponza->DrawDepth(caster_shader, model, cascade); },
+            [&](Shader& caster_shader, const Frustum& cascade) {
+                cyborg->DrawDepth(caster_shader, cyborg_model, cascade);
+            });
+        glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+        glViewport(0, 0, tex_width, tex_height);
+
+        // models queue their meshes inside the view frustum, the queue draws them sorted by shader, material and depth;
+        // levels of detail are picked by their error in pixels of the scene texture
+        Frustum frustum(projection * view);
+        LodSelection lod_selection;
+        lod_selection.view_position = camera.m_Position;
+        lod_selection.projection_scale = tex_height / (2.0f * std::tan(glm::radians(camera.m_Zoom) * 0.5f));
+        // the deferred path draws the same meshes into the G-buffer and lights it in one pass after the queue
+        b8 deferred = DeferredRenderer::GetPath() == ShadingPath::Deferred;
+        Shader& scene_shader = deferred ? gbuffer_shader : shader;
+        Shader& scene_instanced_shader = deferred ? instanced_gbuffer_shader : instanced_shader;
+        GpuProfiler::Begin("Scene");
+        if (deferred)
+            DeferredRenderer::BeginGeometry();
+
+        RenderQueue::Begin(camera.m_Position);
+        sponza->Submit(scene_shader, model, frustum, lod_selection);
+
+        cyborg->Submit(scene_shader, cyborg_model, frustum, lod_selection);
+
+        // copies of the cyborg, one by one or instanced, when the stress scene is on
+        StressScene::Render(*cyborg, scene_shader, scene_instanced_shader, frustum, lod_selection);
+        RenderQueue::Flush();
+        if (deferred)
+            DeferredRenderer::Resolve(framebuffer, projection * view, MATERIAL_SHININESS);
+        GpuProfiler::End();
 
         // render light source
+        GpuProfiler::Begin("Light cube");
         light_cube_shader.Use();
         model = glm::mat4(1.0f);
         model = glm::translate(model, light_pos);
         model = glm::scale(model, glm::vec3(0.2f));
-        light_cube_shader.SetMat4("model", model);
-        light_cube_shader.SetMat4("view", view);
-        light_cube_shader.SetMat4("projection", projection);
+        ObjectConstants light_object = UniformBuffers::MakeObject(model);
+        UniformBuffers::BindObject(UniformBuffers::WriteObjects(&light_object, 1));
         light_vao.Bind();
         glDrawArrays(GL_TRIANGLES, 0, 36);
+        GpuProfiler::End();
+
+        UniformBuffers::EndFrame();
+        InstanceBuffer::EndFrame();
+        DeferredRenderer::EndFrame();
+        StressScene::RecordFrame(delta_time * 1000.0);
 
         // bind back to the default framebuffer
         glBindFramebuffer(GL_FRAMEBUFFER, 0);
@@ -353,16 +511,31 @@ int main()
         glClear(GL_COLOR_BUFFER_BIT);
 
         // Start the Dear ImGui frame
+        GpuProfiler::Begin("ImGui");
         imgui_layer->Begin();
 
         imgui_layer->OnImGuiRender(reinterpret_cast<ImTextureID>(scene.GetTexID()), ImVec2(tex_width, tex_height));
 
         // Rendering
         imgui_layer->End();
+        GpuProfiler::End();
+        GpuProfiler::EndFrame();
+
+        // the stress scene compares frame times, which vsync would round up to the refresh interval
+        b8 want_vsync = StressScene::GetMode() == StressMode::Off;
+        if (want_vsync != vsync) {
+            glfwSwapInterval(want_vsync ? 1 : 0);
+            vsync = want_vsync;
+        }
 
         // glfw: swap buffers and poll IO events (keys pressed/released, mouse moved etc.)
         glfwSwapBuffers(window);
         glfwPollEvents();
+
+        if (first_frame) {
+            LOG_INFO("First frame after {0:.2f} ms", startup_timer.ElapsedMillis());
+            first_frame = false;
+        }
     }
 
     // optional: de-allocate all resources once they've outlived their purpose:
@@ -371,13 +544,26 @@ int main()
     // cube_vao.Destroy();
     // vbo.Destroy();
     // lighting_shader.Destroy();
-    light_cube_shader.Destroy();
-    shader.Destroy();
+    GpuProfiler::Shutdown();
+    DeferredRenderer::Shutdown();
+    ShadowCascades::Shutdown();
+    OcclusionCuller::Shutdown();
+    ShaderManager::Shutdown();
+    ModelLoader::Shutdown();
+    sponza->Destroy();
+    cyborg->Destroy();
+    GeometryArena::Shutdown();
+    InstanceBuffer::Shutdown();
+    LightManager::Shutdown();
+    UniformBuffers::Shutdown();
+    TextureRegistry::Shutdown();
+    TextureStreamer::Shutdown();
 
     glDeleteRenderbuffers(1, &rbo);
     glDeleteFramebuffers(1, &framebuffer);
 
     imgui_layer->OnDetach();
+    TextureLoader::Shutdown();
 
     // glfw: terminate, clearing all previously allocated GLFW resources.
     glfwTerminate();
@@ -0,0 +1,34 @@
+#pragma once
+
+#include "defines.h"
+
+#include <string>
+
+// Read-only memory mapping of a whole file.
+class MappedFile
+{
+public:
+    MappedFile();
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    MappedFile(MappedFile&& other) noexcept;
+    MappedFile& operator=(MappedFile&& other) noexcept;
+
+    b8 Open(const std::string& path);
+    void Close();
+
+    const u8* GetData() const;
+    u64 GetSize() const;
+    b8 IsOpen() const;
+
+private:
+    const u8* m_Data;
+    u64 m_Size;
+
+#if KPLATFORM_WINDOWS
+    void* m_File;
+    void* m_Mapping;
+#endif
+};
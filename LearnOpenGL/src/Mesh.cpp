@@ -1,67 +1,254 @@
 #include "Mesh.h"
+#include "GeometryArena.h"
 #include "Log.h"
+#include "RenderQueue.h"
+#include "VertexPacking.h"
 
-Mesh::Mesh(std::vector<Vertex> vertices, std::vector<u32> indices, std::vector<Texture2D> textures)
+#include <algorithm>
+#include <cstdint>
+
+// material sampler types, in the order of their texture unit blocks
+static const char* const TEXTURE_TYPES[] = {"texture_diffuse", "texture_specular", "texture_normal"};
+static const u32 TEXTURE_TYPE_COUNT = sizeof(TEXTURE_TYPES) / sizeof(TEXTURE_TYPES[0]);
+
+MeshUniforms MeshUniforms::Resolve(const Shader& shader)
+{
+    MeshUniforms uniforms;
+
+    // only shaders built for packed vertices have these
+    if (shader.HasUniform("positionCenter")) {
+        uniforms.position_center = shader.GetUniform<glm::vec3>("positionCenter");
+        uniforms.position_extent = shader.GetUniform<glm::vec3>("positionExtent");
+    }
+    return uniforms;
+}
+
+Mesh::Mesh(GeometryArena& arena, u32 first_vertex, u32 index_offset, const Vertex* vertices, u32 vertex_count,
+           const u32* indices, u32 index_count, const BoundingBox& box, const BoundingSphere& sphere,
+           std::vector<Texture2D> textures)
 {
-    this->vertices = vertices;
-    this->indices = indices;
     this->textures = textures;
+    this->first_vertex = first_vertex;
+    this->lods.push_back({index_offset, GL_UNSIGNED_INT, index_count, {}, 0.0f});
+    this->format = arena.GetFormat();
+    this->box = box;
+    this->sphere = sphere;
+    this->material_id = RenderQueue::GetMaterialId(this->textures);
+
+    // numbered per type in the order they come, as the samplers are named (texture_diffuse1, 2, ...)
+    u32 type_counts[TEXTURE_TYPE_COUNT] = {};
+    for (const Texture2D& texture : this->textures) {
+        std::string type = texture.GetType();
+        u32 unit = ~0u;
+        for (u32 t = 0; t < TEXTURE_TYPE_COUNT; t++) {
+            if (type == TEXTURE_TYPES[t]) {
+                unit = GetTextureUnit(t, type_counts[t]++);
+                break;
+            }
+        }
+        texture_units.push_back(unit);
+    }
 
-    SetupMesh();
+    VertexBounds bounds = VertexPacking::ComputeBounds(vertices, vertex_count);
+    position_center = bounds.center;
+    position_extent = bounds.extent;
+
+    if (format == VertexFormat::Packed)
+        SetupPackedMesh(arena, vertices, vertex_count, indices);
+    else
+        SetupMesh(arena, vertices, vertex_count, indices);
 }
 
-void Mesh::Draw(Shader& shader)
+void Mesh::AddLod(GeometryArena& arena, u32 index_offset, const u32* indices, u32 index_count, u32 vertex_count,
+                  f32 error)
 {
-    u32 diffuseNr = 1;
-    u32 specularNr = 1;
-    u32 normalNr = 1;
+    lods.push_back({index_offset, GL_UNSIGNED_INT, index_count, {}, error});
+    SetupIndices(arena, lods.back(), indices, vertex_count);
+}
+
+void Mesh::Draw(Shader& shader, const MeshUniforms& uniforms)
+{
+    BindMaterial();
+    DrawGeometry(shader, uniforms);
+
+    glActiveTexture(GL_TEXTURE0);
+}
 
-    for (u32 i = 0; i < textures.size(); i++)
-    {
-        textures[i].Bind(i);
-        std::string number;
-        std::string name = textures[i].GetType();
-        if (name == "texture_diffuse")
-        {
-            number = std::to_string(diffuseNr++);
+void Mesh::BindMaterial() const
+{
+    for (u32 i = 0; i < textures.size(); i++) {
+        if (texture_units[i] != ~0u)
+            textures[i].Bind(texture_units[i]);
+    }
+}
+
+void Mesh::DrawGeometry(const Shader& shader, const MeshUniforms& uniforms, u32 lod, u32 instance_count) const
+{
+    const Lod& level = lods[lod];
+    if (format == VertexFormat::Packed) {
+        shader.Set(uniforms.position_center, position_center);
+        shader.Set(uniforms.position_extent, position_extent);
+    }
+
+    u32 index_size = level.index_type == GL_UNSIGNED_SHORT ? sizeof(u16) : sizeof(u32);
+    for (const DrawRange& range : level.ranges) {
+        const void* offset = reinterpret_cast<const void*>(
+            static_cast<uintptr_t>(level.index_offset) + static_cast<uintptr_t>(range.first_index) * index_size);
+        i32 base_vertex = static_cast<i32>(first_vertex) + range.base_vertex;
+        if (instance_count == 1) {
+            glDrawElementsBaseVertex(GL_TRIANGLES, static_cast<i32>(range.index_count), level.index_type, offset,
+                                     base_vertex);
         }
-        else if (name == "texture_specular")
-        {
-            number = std::to_string(specularNr++);
+        else {
+            glDrawElementsInstancedBaseVertex(GL_TRIANGLES, static_cast<i32>(range.index_count), level.index_type,
+                                              offset, static_cast<i32>(instance_count), base_vertex);
         }
-        else if (name == "texture_normal")
-        {
-            number = std::to_string(normalNr++);
+    }
+}
+
+u32 Mesh::GetLodCount() const
+{
+    return static_cast<u32>(lods.size());
+}
+
+f32 Mesh::GetLodError(u32 lod) const
+{
+    return lods[lod].error;
+}
+
+u32 Mesh::GetIndexCount(u32 lod) const
+{
+    return lods[lod].index_count;
+}
+
+u32 Mesh::GetIndexSize(u32 lod) const
+{
+    return lods[lod].index_type == GL_UNSIGNED_SHORT ? sizeof(u16) : sizeof(u32);
+}
+
+u32 Mesh::GetIndexMemory() const
+{
+    u32 bytes = 0;
+    for (u32 lod = 0; lod < lods.size(); lod++)
+        bytes += lods[lod].index_count * GetIndexSize(lod);
+    return bytes;
+}
+
+u32 Mesh::GetMaterialId() const
+{
+    return material_id;
+}
+
+const BoundingBox& Mesh::GetBoundingBox() const
+{
+    return box;
+}
+
+const BoundingSphere& Mesh::GetBoundingSphere() const
+{
+    return sphere;
+}
+
+void Mesh::AssignTextureUnits(Shader& shader)
+{
+    shader.Use();
+    for (u32 t = 0; t < TEXTURE_TYPE_COUNT; t++) {
+        for (u32 number = 0; number < MESH_TEXTURES_PER_TYPE; number++) {
+            std::string name = std::string("material.") + TEXTURE_TYPES[t] + std::to_string(number + 1);
+            if (shader.HasUniform(name))
+                shader.SetInt(name, static_cast<i32>(GetTextureUnit(t, number)));
         }
+    }
+}
 
+u32 Mesh::GetIndexMemory(const u32* indices, u32 index_count, u32 vertex_count)
+{
+    std::vector<DrawRange> ranges;
+    u32 type = BuildDrawRanges(indices, index_count, vertex_count, ranges);
+    return index_count * (type == GL_UNSIGNED_SHORT ? sizeof(u16) : sizeof(u32));
+}
+
+void Mesh::SetupMesh(GeometryArena& arena, const Vertex* vertices, u32 vertex_count, const u32* indices)
+{
+    arena.UploadVertices(first_vertex, vertices, vertex_count);
+    SetupIndices(arena, lods[0], indices, vertex_count);
+}
 
-        shader.SetInt(("material." + name + number).c_str(), i);
-        // glBindTexture(GL_TEXTURE_2D, textures[i].id);
+void Mesh::SetupPackedMesh(GeometryArena& arena, const Vertex* vertices, u32 vertex_count, const u32* indices)
+{
+    VertexBounds bounds = {position_center, position_extent};
+    std::vector<PackedVertex> packed(vertex_count);
+    VertexPacking::Pack(vertices, vertex_count, bounds, packed.data());
+
+    arena.UploadVertices(first_vertex, packed.data(), vertex_count);
+    SetupIndices(arena, lods[0], indices, vertex_count);
+}
+
+void Mesh::SetupIndices(GeometryArena& arena, Lod& lod, const u32* indices, u32 vertex_count)
+{
+    lod.index_type = BuildDrawRanges(indices, lod.index_count, vertex_count, lod.ranges);
+    if (lod.index_type == GL_UNSIGNED_INT) {
+        arena.UploadIndices(lod.index_offset, indices, lod.index_count * sizeof(u32));
+        return;
     }
 
-    vao.Bind();
-    glDrawElements(GL_TRIANGLES, static_cast<int>(indices.size()), GL_UNSIGNED_INT, 0);
-    vao.Unbind();
+    std::vector<u16> narrowed(lod.index_count);
+    for (const DrawRange& range : lod.ranges) {
+        for (u32 i = range.first_index; i < range.first_index + range.index_count; i++)
+            narrowed[i] = static_cast<u16>(indices[i] - range.base_vertex);
+    }
+    arena.UploadIndices(lod.index_offset, narrowed.data(), lod.index_count * sizeof(u16));
+}
 
-    glActiveTexture(GL_TEXTURE0);
+u32 Mesh::GetTextureUnit(u32 type, u32 number)
+{
+    return number < MESH_TEXTURES_PER_TYPE ? type * MESH_TEXTURES_PER_TYPE + number : ~0u;
 }
 
-void Mesh::SetupMesh()
-{
-    vao.Bind();
-    vbo = VertexBuffer(vertices.data(), vertices.size() * sizeof(Vertex), GL_STATIC_DRAW);
-    vbo.Bind();
-    ebo = IndexBuffer(indices.data(), indices.size() * sizeof(u32), GL_STATIC_DRAW);
-    ebo.Bind();
-
-    // vertex positions
-    vao.LinkAttrib(0, 3, GL_FLOAT, sizeof(Vertex), (void*)0);
-    // vertex normals
-    vao.LinkAttrib(1, 3, GL_FLOAT, sizeof(Vertex), (void*)offsetof(Vertex, normal));
-    // vertex texture coordinates
-    vao.LinkAttrib(2, 2, GL_FLOAT, sizeof(Vertex), (void*)offsetof(Vertex, tex_coords));
-    // vertex tangent
-    vao.LinkAttrib(3, 3, GL_FLOAT, sizeof(Vertex), (void*)offsetof(Vertex, tangents));
-    // vertex bitangent
-    vao.LinkAttrib(4, 3, GL_FLOAT, sizeof(Vertex), (void*)offsetof(Vertex, bitangents));
+u32 Mesh::BuildDrawRanges(const u32* indices, u32 index_count, u32 vertex_count, std::vector<DrawRange>& ranges)
+{
+    const u32 MAX_16BIT_SPAN = 0xffff;
+    ranges.clear();
+
+    // small meshes fit 16 bits directly, larger ones are cut into triangle runs whose vertices span at most 64K;
+    // the first-use vertex order from the importer keeps those spans short
+    if (vertex_count <= MAX_16BIT_SPAN + 1) {
+        ranges.push_back({0, index_count, 0});
+        return GL_UNSIGNED_SHORT;
+    }
+
+    if (MESH_SPLIT_16BIT_INDICES && index_count % 3 == 0) {
+        b8 narrow = true;
+        u32 range_start = 0;
+        u32 range_min = ~0u;
+        u32 range_max = 0;
+        for (u32 i = 0; i < index_count; i += 3) {
+            u32 tri_min = std::min(indices[i], std::min(indices[i + 1], indices[i + 2]));
+            u32 tri_max = std::max(indices[i], std::max(indices[i + 1], indices[i + 2]));
+            if (tri_max - tri_min > MAX_16BIT_SPAN) {
+                narrow = false; // a single triangle no base vertex can cover
+                break;
+            }
+
+            if (std::max(range_max, tri_max) - std::min(range_min, tri_min) > MAX_16BIT_SPAN) {
+                ranges.push_back({range_start, i - range_start, static_cast<i32>(range_min)});
+                range_start = i;
+                range_min = tri_min;
+                range_max = tri_max;
+            }
+            else {
+                range_min = std::min(range_min, tri_min);
+                range_max = std::max(range_max, tri_max);
+            }
+        }
+
+        if (narrow) {
+            if (range_start < index_count)
+                ranges.push_back({range_start, index_count - range_start, static_cast<i32>(range_min)});
+            return GL_UNSIGNED_SHORT;
+        }
+    }
+
+    ranges.assign(1, {0, index_count, 0});
+    return GL_UNSIGNED_INT;
 }
@@ -10,11 +10,9 @@
 #include <string>
 #include <vector>
 
-#include "IndexBuffer.h"
+#include "Bounds.h"
 #include "Shader.h"
 #include "Texture2D.h"
-#include "VertexArray.h"
-#include "VertexBuffer.h"
 
 struct Vertex
 {
@@ -25,22 +23,127 @@ struct Vertex
     glm::vec3 bitangents;
 };
 
+// Meshes with more than 65536 vertices are drawn in several ranges, each with its own base vertex, so they can
+// still use 16-bit indices. When false they fall back to 32-bit indices.
+const b8 MESH_SPLIT_16BIT_INDICES = true;
+
+// Layout of the vertex buffer on the GPU. Packed uses PackedVertex (VertexPacking.h) and needs a shader built
+// with PACKED_VERTEX defined.
+enum class VertexFormat
+{
+    Float,
+    Packed
+};
+
+// Each texture type gets a fixed block of texture units, so the material samplers are assigned once per shader
+// (Mesh::AssignTextureUnits) and binding a material sets no uniforms. Textures past the block aren't bound.
+const u32 MESH_TEXTURES_PER_TYPE = 4;
+
+// Uniforms a mesh draw sets, resolved once per shader. The model matrix comes from the Object uniform block.
+struct MeshUniforms
+{
+    Uniform<glm::vec3> position_center;
+    Uniform<glm::vec3> position_extent;
+
+    static MeshUniforms Resolve(const Shader& shader);
+};
+
+// A simplified level of the mesh, as a range of the model's index array that reuses the mesh's vertices.
+// error is how far the level strays from the full mesh, in model units.
+struct MeshLod
+{
+    u32 first_index;
+    u32 index_count;
+    f32 error;
+};
+
+class GeometryArena;
+
 class Mesh
 {
 public:
-    std::vector<Vertex> vertices;
-    std::vector<u32> indices;
     std::vector<Texture2D> textures;
 
-    Mesh(std::vector<Vertex> vertices, std::vector<u32> indices, std::vector<Texture2D> textures);
+    // uploads the vertex/index data straight from the given arrays into the arena, starting at first_vertex and
+    // index_offset (bytes, GetIndexMemory of them reserved). No CPU-side copy is kept.
+    Mesh(GeometryArena& arena, u32 first_vertex, u32 index_offset, const Vertex* vertices, u32 vertex_count,
+         const u32* indices, u32 index_count, const BoundingBox& box, const BoundingSphere& sphere,
+         std::vector<Texture2D> textures);
 
-    void Draw(Shader& shader);
+    // uploads the indices of the next coarser level to index_offset (bytes, GetIndexMemory of them reserved)
+    void AddLod(GeometryArena& arena, u32 index_offset, const u32* indices, u32 index_count, u32 vertex_count,
+                f32 error);
+
+    // the mesh's arena must be bound and the shader's texture units assigned
+    void Draw(Shader& shader, const MeshUniforms& uniforms);
+
+    // Draw in two halves, so RenderQueue can skip the material when the previous draw used the same one
+    void BindMaterial() const;
+    // instance_count > 1 needs an instanced shader and InstanceBuffer::Bind
+    void DrawGeometry(const Shader& shader, const MeshUniforms& uniforms, u32 lod = 0, u32 instance_count = 1) const;
+
+    // level 0 is the full mesh, each further level coarser
+    u32 GetLodCount() const;
+    f32 GetLodError(u32 lod) const;
+
+    u32 GetIndexCount(u32 lod = 0) const;
+    // bytes per index of a level in the arena, 2 or 4
+    u32 GetIndexSize(u32 lod = 0) const;
+    // of every level
+    u32 GetIndexMemory() const;
+    u32 GetMaterialId() const;
+
+    // model space bounds, as imported
+    const BoundingBox& GetBoundingBox() const;
+    const BoundingSphere& GetBoundingSphere() const;
+
+    // points the shader's material samplers at the fixed texture units. Once per shader, after it's built.
+    static void AssignTextureUnits(Shader& shader);
+
+    // bytes the indices take in the arena once narrowed
+    static u32 GetIndexMemory(const u32* indices, u32 index_count, u32 vertex_count);
 
 private:
-    // render data
-    VertextArray vao;
-    VertexBuffer vbo;
-    IndexBuffer ebo;
+    // a run of indices that share one base vertex
+    struct DrawRange
+    {
+        u32 first_index;
+        u32 index_count;
+        i32 base_vertex;
+    };
+
+    // the indices of one level, as an offset into the arena
+    struct Lod
+    {
+        u32 index_offset;
+        u32 index_type;
+        u32 index_count;
+        std::vector<DrawRange> ranges;
+        f32 error;
+    };
+
+    // render data, as offsets into the arena
+    u32 first_vertex;
+    std::vector<Lod> lods;
+    VertexFormat format;
+    u32 material_id;
+    std::vector<u32> texture_units; // per texture, ~0u if it isn't bound
+
+    BoundingBox box;
+    BoundingSphere sphere;
+
+    // packed positions are stored relative to the mesh bounds
+    glm::vec3 position_center;
+    glm::vec3 position_extent;
+
+    void SetupMesh(GeometryArena& arena, const Vertex* vertices, u32 vertex_count, const u32* indices);
+    void SetupPackedMesh(GeometryArena& arena, const Vertex* vertices, u32 vertex_count, const u32* indices);
+    void SetupIndices(GeometryArena& arena, Lod& lod, const u32* indices, u32 vertex_count);
+
+    // fixed unit of the number-th (0-based) texture of a type (index into the type list), ~0u past the block
+    static u32 GetTextureUnit(u32 type, u32 number);
 
-    void SetupMesh();
+    // splits the indices into 16-bit ranges when possible, returns the index type to draw with
+    static u32 BuildDrawRanges(const u32* indices, u32 index_count, u32 vertex_count,
+                               std::vector<DrawRange>& ranges);
 };
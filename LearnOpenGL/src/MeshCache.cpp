@@ -0,0 +1,412 @@
+#include "MeshCache.h"
+
+#include "Hash.h"
+#include "Log.h"
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+namespace
+{
+
+const char* CACHE_DIRECTORY = "cache/meshes";
+
+struct MeshCacheHeader
+{
+    u32 magic;
+    u32 version;
+    u64 source_hash;
+    u32 import_flags;
+    u32 mesh_count;
+    u32 node_count;
+    u32 lod_count;
+    u32 texture_count;
+    u32 source_count;
+    u32 string_size;
+    u64 vertex_count;
+    u64 index_count;
+    u64 vertex_offset;
+    u64 index_offset;
+};
+
+struct MeshCacheRecord
+{
+    u32 first_vertex;
+    u32 vertex_count;
+    u32 first_index;
+    u32 index_count;
+    u32 first_lod;
+    u32 lod_count;
+    u32 first_texture;
+    u32 texture_count;
+    f32 box_center[3];
+    f32 box_extent[3];
+    f32 sphere[4]; // center, radius
+};
+
+struct MeshCacheNode
+{
+    u32 parent;
+    u32 subtree_end;
+    u32 first_mesh;
+    u32 mesh_count;
+    f32 local[16]; // column major
+};
+
+struct MeshCacheLod
+{
+    u32 first_index;
+    u32 index_count;
+    f32 error;
+};
+
+// offsets into the string blob
+struct MeshCacheTexture
+{
+    u32 type_offset;
+    u32 type_length;
+    u32 path_offset;
+    u32 path_length;
+};
+
+// a file the import read besides the model file, path in the string blob
+struct MeshCacheSource
+{
+    u64 hash;
+    u32 path_offset;
+    u32 path_length;
+};
+
+u64 AlignUp(u64 value, u64 alignment)
+{
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+
+// the indices of a mesh are relative to its first vertex
+b8 IndicesInRange(const u32* indices, u32 index_count, u32 vertex_count)
+{
+    for (u32 i = 0; i < index_count; i++) {
+        if (indices[i] >= vertex_count)
+            return false;
+    }
+    return true;
+}
+
+} // namespace
+
+b8 MeshCache::Load(const std::string& source_path, u32 import_flags, ModelData& data)
+{
+    std::string cache_path = GetCachePath(source_path);
+    MappedFile file;
+    if (!file.Open(cache_path))
+        return false;
+
+    if (file.GetSize() < sizeof(MeshCacheHeader))
+        return false;
+
+    const u8* base = file.GetData();
+    MeshCacheHeader header;
+    std::memcpy(&header, base, sizeof(header));
+
+    if (header.magic != MAGIC || header.version != VERSION || header.import_flags != import_flags) {
+        LOG_TRACE("MeshCache: {0} is from another version or import flags", cache_path);
+        return false;
+    }
+
+    if (header.source_hash != HashFile(source_path)) {
+        LOG_TRACE("MeshCache: {0} is stale", cache_path);
+        return false;
+    }
+
+    u64 records_offset = sizeof(MeshCacheHeader);
+    u64 nodes_offset = records_offset + header.mesh_count * sizeof(MeshCacheRecord);
+    u64 lods_offset = nodes_offset + header.node_count * sizeof(MeshCacheNode);
+    u64 textures_offset = lods_offset + header.lod_count * sizeof(MeshCacheLod);
+    u64 sources_offset = textures_offset + header.texture_count * sizeof(MeshCacheTexture);
+    u64 strings_offset = sources_offset + header.source_count * sizeof(MeshCacheSource);
+
+    // the counts and offsets from the file are compared against what is left of it, so no sum can wrap around
+    u64 file_size = file.GetSize();
+    if (strings_offset + header.string_size > file_size || header.vertex_offset < strings_offset + header.string_size ||
+        header.vertex_offset > file_size || header.vertex_offset % alignof(Vertex) != 0 ||
+        header.vertex_count > (file_size - header.vertex_offset) / sizeof(Vertex) ||
+        header.index_offset < header.vertex_offset + header.vertex_count * sizeof(Vertex) ||
+        header.index_offset > file_size || header.index_offset % alignof(u32) != 0 ||
+        header.index_count > (file_size - header.index_offset) / sizeof(u32)) {
+        LOG_ERROR("MeshCache: {0} is truncated", cache_path);
+        return false;
+    }
+
+    const MeshCacheRecord* records = reinterpret_cast<const MeshCacheRecord*>(base + records_offset);
+    const MeshCacheNode* nodes = reinterpret_cast<const MeshCacheNode*>(base + nodes_offset);
+    const MeshCacheLod* lods = reinterpret_cast<const MeshCacheLod*>(base + lods_offset);
+    const MeshCacheTexture* textures = reinterpret_cast<const MeshCacheTexture*>(base + textures_offset);
+    const MeshCacheSource* sources = reinterpret_cast<const MeshCacheSource*>(base + sources_offset);
+    const char* strings = reinterpret_cast<const char*>(base + strings_offset);
+    const u32* indices = reinterpret_cast<const u32*>(base + header.index_offset);
+
+    std::vector<std::string> source_files;
+    for (u32 i = 0; i < header.source_count; i++) {
+        if (sources[i].path_offset + static_cast<u64>(sources[i].path_length) > header.string_size) {
+            LOG_ERROR("MeshCache: {0} has broken source file references", cache_path);
+            return false;
+        }
+        source_files.emplace_back(strings + sources[i].path_offset, sources[i].path_length);
+        if (sources[i].hash != HashFile(source_files.back())) {
+            LOG_TRACE("MeshCache: {0} is stale, {1} changed", cache_path, source_files.back());
+            return false;
+        }
+    }
+
+    // checked up front, culling walks subtrees by these ranges and the hierarchy update indexes the parents; node 0
+    // is the root and every other parent comes before its children
+    for (u32 i = 0; i < header.node_count; i++) {
+        b8 root = nodes[i].parent == NodeData::NO_PARENT;
+        if ((i == 0) != root || (!root && nodes[i].parent >= i) || nodes[i].subtree_end <= i ||
+            nodes[i].subtree_end > header.node_count ||
+            nodes[i].first_mesh + static_cast<u64>(nodes[i].mesh_count) > header.mesh_count) {
+            LOG_ERROR("MeshCache: {0} has a broken node hierarchy", cache_path);
+            return false;
+        }
+    }
+
+    // the geometry and levels of detail are uploaded straight from these ranges, so every index must stay inside
+    // its mesh; the texture records point into the string blob
+    for (u32 i = 0; i < header.mesh_count; i++) {
+        const MeshCacheRecord& record = records[i];
+        if (record.first_vertex + static_cast<u64>(record.vertex_count) > header.vertex_count ||
+            record.first_index + static_cast<u64>(record.index_count) > header.index_count) {
+            LOG_ERROR("MeshCache: {0} has broken mesh ranges", cache_path);
+            return false;
+        }
+        if (!IndicesInRange(indices + record.first_index, record.index_count, record.vertex_count)) {
+            LOG_ERROR("MeshCache: {0} has indices out of range", cache_path);
+            return false;
+        }
+
+        b8 valid = record.first_lod + static_cast<u64>(record.lod_count) <= header.lod_count;
+        for (u32 j = 0; valid && j < record.lod_count; j++) {
+            const MeshCacheLod& lod = lods[record.first_lod + j];
+            valid = lod.first_index + static_cast<u64>(lod.index_count) <= header.index_count &&
+                    IndicesInRange(indices + lod.first_index, lod.index_count, record.vertex_count);
+        }
+        if (!valid) {
+            LOG_ERROR("MeshCache: {0} has broken levels of detail", cache_path);
+            return false;
+        }
+
+        valid = record.first_texture + static_cast<u64>(record.texture_count) <= header.texture_count;
+        for (u32 j = 0; valid && j < record.texture_count; j++) {
+            const MeshCacheTexture& texture = textures[record.first_texture + j];
+            valid = texture.type_offset + static_cast<u64>(texture.type_length) <= header.string_size &&
+                    texture.path_offset + static_cast<u64>(texture.path_length) <= header.string_size;
+        }
+        if (!valid) {
+            LOG_ERROR("MeshCache: {0} has broken texture references", cache_path);
+            return false;
+        }
+    }
+
+    data.meshes.clear();
+    data.meshes.reserve(header.mesh_count);
+    for (u32 i = 0; i < header.mesh_count; i++) {
+        const MeshCacheRecord& record = records[i];
+        MeshData mesh;
+        mesh.first_vertex = record.first_vertex;
+        mesh.vertex_count = record.vertex_count;
+        mesh.first_index = record.first_index;
+        mesh.index_count = record.index_count;
+        mesh.box.center = glm::vec3(record.box_center[0], record.box_center[1], record.box_center[2]);
+        mesh.box.extent = glm::vec3(record.box_extent[0], record.box_extent[1], record.box_extent[2]);
+        mesh.sphere.center = glm::vec3(record.sphere[0], record.sphere[1], record.sphere[2]);
+        mesh.sphere.radius = record.sphere[3];
+
+        for (u32 j = 0; j < record.lod_count; j++) {
+            const MeshCacheLod& lod = lods[record.first_lod + j];
+            mesh.lods.push_back({lod.first_index, lod.index_count, lod.error});
+        }
+
+        for (u32 j = 0; j < record.texture_count; j++) {
+            const MeshCacheTexture& texture = textures[record.first_texture + j];
+            mesh.textures.push_back({std::string(strings + texture.type_offset, texture.type_length),
+                                     std::string(strings + texture.path_offset, texture.path_length)});
+        }
+
+        data.meshes.push_back(std::move(mesh));
+    }
+
+    data.nodes.clear();
+    data.nodes.reserve(header.node_count);
+    for (u32 i = 0; i < header.node_count; i++) {
+        const MeshCacheNode& record = nodes[i];
+        NodeData node;
+        node.parent = record.parent;
+        node.subtree_end = record.subtree_end;
+        node.first_mesh = record.first_mesh;
+        node.mesh_count = record.mesh_count;
+        for (u32 column = 0; column < 4; column++) {
+            const f32* c = record.local + column * 4;
+            node.local[column] = glm::vec4(c[0], c[1], c[2], c[3]);
+        }
+        data.nodes.push_back(node);
+    }
+
+    data.directory = source_path.substr(0, source_path.find_last_of('/'));
+    data.source_files = std::move(source_files);
+    data.vertices = reinterpret_cast<const Vertex*>(base + header.vertex_offset);
+    data.indices = indices;
+    data.vertex_count = header.vertex_count;
+    data.index_count = header.index_count;
+    data.vertex_storage.clear();
+    data.index_storage.clear();
+    data.mapping = std::move(file);
+
+    return true;
+}
+
+b8 MeshCache::Store(const std::string& source_path, u32 import_flags, const ModelData& data)
+{
+    std::vector<MeshCacheRecord> records;
+    std::vector<MeshCacheNode> nodes;
+    std::vector<MeshCacheLod> lods;
+    std::vector<MeshCacheTexture> textures;
+    std::vector<MeshCacheSource> sources;
+    std::string strings;
+
+    auto add_string = [&strings](const std::string& str, u32& offset, u32& length) {
+        offset = static_cast<u32>(strings.size());
+        length = static_cast<u32>(str.size());
+        strings += str;
+    };
+
+    for (const MeshData& mesh : data.meshes) {
+        MeshCacheRecord record;
+        record.first_vertex = mesh.first_vertex;
+        record.vertex_count = mesh.vertex_count;
+        record.first_index = mesh.first_index;
+        record.index_count = mesh.index_count;
+        record.first_lod = static_cast<u32>(lods.size());
+        record.lod_count = static_cast<u32>(mesh.lods.size());
+        record.first_texture = static_cast<u32>(textures.size());
+        record.texture_count = static_cast<u32>(mesh.textures.size());
+        for (u32 i = 0; i < 3; i++) {
+            record.box_center[i] = mesh.box.center[i];
+            record.box_extent[i] = mesh.box.extent[i];
+            record.sphere[i] = mesh.sphere.center[i];
+        }
+        record.sphere[3] = mesh.sphere.radius;
+        records.push_back(record);
+
+        for (const MeshLod& lod : mesh.lods)
+            lods.push_back({lod.first_index, lod.index_count, lod.error});
+
+        for (const TextureRef& ref : mesh.textures) {
+            MeshCacheTexture texture;
+            add_string(ref.type, texture.type_offset, texture.type_length);
+            add_string(ref.path, texture.path_offset, texture.path_length);
+            textures.push_back(texture);
+        }
+    }
+
+    for (const std::string& file : data.source_files) {
+        MeshCacheSource source;
+        source.hash = HashFile(file);
+        add_string(file, source.path_offset, source.path_length);
+        sources.push_back(source);
+    }
+
+    for (const NodeData& node : data.nodes) {
+        MeshCacheNode record;
+        record.parent = node.parent;
+        record.subtree_end = node.subtree_end;
+        record.first_mesh = node.first_mesh;
+        record.mesh_count = node.mesh_count;
+        for (u32 column = 0; column < 4; column++) {
+            for (u32 row = 0; row < 4; row++)
+                record.local[column * 4 + row] = node.local[column][row];
+        }
+        nodes.push_back(record);
+    }
+
+    MeshCacheHeader header = {};
+    header.magic = MAGIC;
+    header.version = VERSION;
+    header.source_hash = HashFile(source_path);
+    header.import_flags = import_flags;
+    header.mesh_count = static_cast<u32>(records.size());
+    header.node_count = static_cast<u32>(nodes.size());
+    header.lod_count = static_cast<u32>(lods.size());
+    header.texture_count = static_cast<u32>(textures.size());
+    header.source_count = static_cast<u32>(sources.size());
+    header.string_size = static_cast<u32>(strings.size());
+    header.vertex_count = data.vertex_count;
+    header.index_count = data.index_count;
+
+    u64 strings_end = sizeof(MeshCacheHeader) + records.size() * sizeof(MeshCacheRecord) +
+                      nodes.size() * sizeof(MeshCacheNode) + lods.size() * sizeof(MeshCacheLod) +
+                      textures.size() * sizeof(MeshCacheTexture) + sources.size() * sizeof(MeshCacheSource) +
+                      strings.size();
+    header.vertex_offset = AlignUp(strings_end, 16);
+    header.index_offset = AlignUp(header.vertex_offset + data.vertex_count * sizeof(Vertex), 16);
+
+    std::string cache_path = GetCachePath(source_path);
+    std::error_code ec;
+    std::filesystem::create_directories(CACHE_DIRECTORY, ec);
+
+    // write to a temporary file first so a crash never leaves a half-written cache behind
+    std::string temp_path = cache_path + ".tmp";
+    std::ofstream out(temp_path, std::ios::binary | std::ios::trunc);
+    if (!out) {
+        LOG_ERROR("MeshCache: Failed to open {0} for writing", temp_path);
+        return false;
+    }
+
+    const char padding[16] = {};
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char*>(records.data()), records.size() * sizeof(MeshCacheRecord));
+    out.write(reinterpret_cast<const char*>(nodes.data()), nodes.size() * sizeof(MeshCacheNode));
+    out.write(reinterpret_cast<const char*>(lods.data()), lods.size() * sizeof(MeshCacheLod));
+    out.write(reinterpret_cast<const char*>(textures.data()), textures.size() * sizeof(MeshCacheTexture));
+    out.write(reinterpret_cast<const char*>(sources.data()), sources.size() * sizeof(MeshCacheSource));
+    out.write(strings.data(), strings.size());
+    out.write(padding, header.vertex_offset - strings_end);
+    out.write(reinterpret_cast<const char*>(data.vertices), data.vertex_count * sizeof(Vertex));
+    out.write(padding, header.index_offset - (header.vertex_offset + data.vertex_count * sizeof(Vertex)));
+    out.write(reinterpret_cast<const char*>(data.indices), data.index_count * sizeof(u32));
+    out.close();
+
+    if (!out) {
+        LOG_ERROR("MeshCache: Failed to write {0}", temp_path);
+        std::filesystem::remove(temp_path, ec);
+        return false;
+    }
+
+    std::filesystem::rename(temp_path, cache_path, ec);
+    if (ec) {
+        LOG_ERROR("MeshCache: Failed to move {0} into place: {1}", cache_path, ec.message());
+        return false;
+    }
+
+    LOG_TRACE("MeshCache: Wrote {0}", cache_path);
+    return true;
+}
+
+std::string MeshCache::GetCachePath(const std::string& source_path)
+{
+    std::string name = source_path;
+    for (char& c : name) {
+        if (c == '/' || c == '\\' || c == ':')
+            c = '_';
+    }
+    return std::string(CACHE_DIRECTORY) + "/" + name + ".mesh";
+}
+
+u64 MeshCache::HashFile(const std::string& path)
+{
+    MappedFile file;
+    if (!file.Open(path))
+        return 0;
+
+    return HashBytes(file.GetData(), file.GetSize());
+}
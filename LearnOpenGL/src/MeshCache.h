@@ -0,0 +1,34 @@
+#pragma once
+
+#include "defines.h"
+
+#include "ModelData.h"
+
+#include <string>
+
+// Versioned on-disk cache of imported models.
+//
+// A cache file stores the final vertex/index arrays, the node hierarchy, and the levels of detail and material
+// texture references of every mesh, keyed by a hash of the source file and the Assimp import flags. The other
+// files the import read, such as an OBJ's .mtl or a glTF's buffers, are listed with their hashes and checked too.
+// Loading maps the file and points the ModelData straight at the mapped arrays, so the geometry can be uploaded
+// without an intermediate copy.
+//
+// Layout: MeshCacheHeader | MeshCacheRecord[mesh_count] | MeshCacheNode[node_count] | MeshCacheLod[lod_count] |
+//         MeshCacheTexture[texture_count] | MeshCacheSource[source_count] | string blob | Vertex[vertex_count] |
+//         u32[index_count]
+class MeshCache
+{
+public:
+    static const u32 MAGIC = 0x48534d4c; // "LMSH"
+    static const u32 VERSION = 6;
+
+    // Loads the cache entry for source_path. Fails if there is none or if it is stale.
+    static b8 Load(const std::string& source_path, u32 import_flags, ModelData& data);
+
+    // Writes the cache entry for source_path.
+    static b8 Store(const std::string& source_path, u32 import_flags, const ModelData& data);
+
+    static std::string GetCachePath(const std::string& source_path);
+    static u64 HashFile(const std::string& path);
+};
@@ -0,0 +1,338 @@
+#include "MeshOptimizer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+// Forsyth's scoring constants, tuned for a 32-entry LRU cache
+static const u32 FORSYTH_CACHE_SIZE = 32;
+static const f32 CACHE_DECAY_POWER = 1.5f;
+static const f32 LAST_TRIANGLE_SCORE = 0.75f;
+static const f32 VALENCE_BOOST_SCALE = 2.0f;
+static const f32 VALENCE_BOOST_POWER = 0.5f;
+
+static f32 VertexScore(i32 cache_position, u32 valence)
+{
+    // no triangles left to draw, the vertex never needs to stay in the cache
+    if (valence == 0)
+        return -1.0f;
+
+    f32 score = 0.0f;
+    if (cache_position >= 0) {
+        // the vertices of the last triangle get a fixed score so it is not simply drawn again
+        if (cache_position < 3) {
+            score = LAST_TRIANGLE_SCORE;
+        }
+        else {
+            f32 scale = 1.0f / (FORSYTH_CACHE_SIZE - 3);
+            score = std::pow(1.0f - (cache_position - 3) * scale, CACHE_DECAY_POWER);
+        }
+    }
+
+    // favour vertices with few triangles left, so they get finished and drop out
+    score += VALENCE_BOOST_SCALE * std::pow(static_cast<f32>(valence), -VALENCE_BOOST_POWER);
+    return score;
+}
+
+// FIFO cache simulation: a vertex is cached if fewer than cache_size misses happened since it was loaded
+class FifoCache
+{
+public:
+    FifoCache(u32 vertex_count, u32 cache_size)
+        : m_Timestamps(vertex_count, 0), m_CacheSize(cache_size), m_Time(cache_size + 1)
+    {
+    }
+
+    // returns true on a miss
+    b8 Access(u32 vertex)
+    {
+        if (m_Time - m_Timestamps[vertex] > m_CacheSize) {
+            m_Timestamps[vertex] = m_Time++;
+            return true;
+        }
+        return false;
+    }
+
+    void Clear()
+    {
+        m_Time += m_CacheSize + 1;
+    }
+
+private:
+    std::vector<u32> m_Timestamps;
+    u32 m_CacheSize;
+    u32 m_Time;
+};
+
+void MeshOptimizer::OptimizeVertexCache(u32* indices, u32 index_count, u32 vertex_count)
+{
+    u32 triangle_count = index_count / 3;
+    if (triangle_count == 0 || index_count % 3 != 0)
+        return;
+
+    // triangles adjacent to each vertex, as offsets into one shared array
+    std::vector<u32> valence(vertex_count, 0);
+    for (u32 i = 0; i < index_count; i++)
+        valence[indices[i]]++;
+
+    std::vector<u32> adjacency_offset(vertex_count + 1, 0);
+    for (u32 v = 0; v < vertex_count; v++)
+        adjacency_offset[v + 1] = adjacency_offset[v] + valence[v];
+
+    std::vector<u32> adjacency(index_count);
+    std::vector<u32> fill(adjacency_offset.begin(), adjacency_offset.end() - 1);
+    for (u32 t = 0; t < triangle_count; t++) {
+        for (u32 k = 0; k < 3; k++)
+            adjacency[fill[indices[t * 3 + k]]++] = t;
+    }
+
+    std::vector<i32> cache_position(vertex_count, -1);
+    std::vector<f32> vertex_score(vertex_count);
+    for (u32 v = 0; v < vertex_count; v++)
+        vertex_score[v] = VertexScore(-1, valence[v]);
+
+    std::vector<f32> triangle_score(triangle_count);
+    std::vector<b8> emitted(triangle_count, false);
+    for (u32 t = 0; t < triangle_count; t++) {
+        triangle_score[t] = vertex_score[indices[t * 3 + 0]] + vertex_score[indices[t * 3 + 1]] +
+                            vertex_score[indices[t * 3 + 2]];
+    }
+
+    std::vector<u32> output;
+    output.reserve(index_count);
+
+    // LRU cache, with room for the three vertices pushed in by each triangle
+    std::vector<u32> cache;
+    std::vector<u32> next_cache;
+    cache.reserve(FORSYTH_CACHE_SIZE + 3);
+    next_cache.reserve(FORSYTH_CACHE_SIZE + 3);
+
+    u32 restart_cursor = 0;
+    i32 best = 0;
+    for (u32 t = 1; t < triangle_count; t++) {
+        if (triangle_score[t] > triangle_score[best])
+            best = t;
+    }
+
+    while (best >= 0) {
+        const u32* triangle = &indices[best * 3];
+        emitted[best] = true;
+
+        for (u32 k = 0; k < 3; k++) {
+            u32 v = triangle[k];
+            output.push_back(v);
+
+            // drop the triangle from the vertex's remaining list
+            u32 begin = adjacency_offset[v];
+            u32 end = begin + valence[v];
+            for (u32 i = begin; i < end; i++) {
+                if (adjacency[i] == static_cast<u32>(best)) {
+                    std::swap(adjacency[i], adjacency[end - 1]);
+                    break;
+                }
+            }
+            valence[v]--;
+        }
+
+        // move the triangle's vertices to the front of the cache
+        next_cache.clear();
+        next_cache.insert(next_cache.end(), triangle, triangle + 3);
+        for (u32 v : cache) {
+            if (v != triangle[0] && v != triangle[1] && v != triangle[2])
+                next_cache.push_back(v);
+        }
+
+        // rescore everything that was or is in the cache, and pick the best triangle touching it
+        best = -1;
+        f32 best_score = -1.0f;
+        for (u32 i = 0; i < next_cache.size(); i++) {
+            u32 v = next_cache[i];
+            cache_position[v] = i < FORSYTH_CACHE_SIZE ? static_cast<i32>(i) : -1;
+            f32 score = VertexScore(cache_position[v], valence[v]);
+            f32 delta = score - vertex_score[v];
+            vertex_score[v] = score;
+
+            u32 begin = adjacency_offset[v];
+            u32 end = begin + valence[v];
+            for (u32 j = begin; j < end; j++) {
+                u32 t = adjacency[j];
+                triangle_score[t] += delta;
+                if (triangle_score[t] > best_score) {
+                    best_score = triangle_score[t];
+                    best = static_cast<i32>(t);
+                }
+            }
+        }
+
+        if (next_cache.size() > FORSYTH_CACHE_SIZE)
+            next_cache.resize(FORSYTH_CACHE_SIZE);
+        cache.swap(next_cache);
+
+        // dead end: nothing in the cache has triangles left, continue with the next unemitted triangle
+        if (best < 0) {
+            while (restart_cursor < triangle_count && emitted[restart_cursor])
+                restart_cursor++;
+            if (restart_cursor < triangle_count)
+                best = static_cast<i32>(restart_cursor);
+        }
+    }
+
+    std::copy(output.begin(), output.end(), indices);
+}
+
+void MeshOptimizer::OptimizeOverdraw(u32* indices, u32 index_count, const Vertex* vertices, u32 vertex_count,
+                                     f32 threshold)
+{
+    u32 triangle_count = index_count / 3;
+    if (triangle_count == 0 || index_count % 3 != 0)
+        return;
+
+    // hard boundaries: triangles that miss the cache on all three vertices start a new cluster
+    std::vector<u32> hard_clusters;
+    {
+        FifoCache cache(vertex_count, STATS_CACHE_SIZE);
+        for (u32 t = 0; t < triangle_count; t++) {
+            u32 misses = cache.Access(indices[t * 3 + 0]) + cache.Access(indices[t * 3 + 1]) +
+                         cache.Access(indices[t * 3 + 2]);
+            if (t == 0 || misses == 3)
+                hard_clusters.push_back(t);
+        }
+    }
+    hard_clusters.push_back(triangle_count);
+
+    // soft boundaries: split clusters further wherever the ACMR so far stays within threshold of the cluster's own
+    std::vector<u32> clusters;
+    {
+        FifoCache cache(vertex_count, STATS_CACHE_SIZE);
+        for (u32 c = 0; c + 1 < hard_clusters.size(); c++) {
+            u32 begin = hard_clusters[c];
+            u32 end = hard_clusters[c + 1];
+
+            cache.Clear();
+            u32 cluster_misses = 0;
+            for (u32 t = begin; t < end; t++) {
+                cluster_misses += cache.Access(indices[t * 3 + 0]) + cache.Access(indices[t * 3 + 1]) +
+                                  cache.Access(indices[t * 3 + 2]);
+            }
+            f32 cluster_threshold = threshold * cluster_misses / (end - begin);
+
+            clusters.push_back(begin);
+            cache.Clear();
+            u32 misses = 0;
+            u32 start = begin;
+            for (u32 t = begin; t < end; t++) {
+                misses += cache.Access(indices[t * 3 + 0]) + cache.Access(indices[t * 3 + 1]) +
+                          cache.Access(indices[t * 3 + 2]);
+                if (t + 1 < end && static_cast<f32>(misses) / (t + 1 - start) <= cluster_threshold) {
+                    clusters.push_back(t + 1);
+                    cache.Clear();
+                    misses = 0;
+                    start = t + 1;
+                }
+            }
+        }
+    }
+    clusters.push_back(triangle_count);
+
+    // mesh centroid, weighted by triangle area
+    glm::vec3 mesh_center(0.0f);
+    f32 mesh_area = 0.0f;
+    for (u32 t = 0; t < triangle_count; t++) {
+        const glm::vec3& p0 = vertices[indices[t * 3 + 0]].position;
+        const glm::vec3& p1 = vertices[indices[t * 3 + 1]].position;
+        const glm::vec3& p2 = vertices[indices[t * 3 + 2]].position;
+        f32 area = glm::length(glm::cross(p1 - p0, p2 - p0));
+        mesh_center += (p0 + p1 + p2) * (area / 3.0f);
+        mesh_area += area;
+    }
+    mesh_center = mesh_area > 0.0f ? mesh_center / mesh_area : glm::vec3(0.0f);
+
+    // clusters far out along their own normal are likely to occlude the rest, draw those first
+    struct Cluster
+    {
+        u32 begin;
+        u32 end;
+        f32 sort_key;
+    };
+
+    std::vector<Cluster> sorted;
+    sorted.reserve(clusters.size() - 1);
+    for (u32 c = 0; c + 1 < clusters.size(); c++) {
+        glm::vec3 center(0.0f);
+        glm::vec3 normal(0.0f);
+        f32 cluster_area = 0.0f;
+        for (u32 t = clusters[c]; t < clusters[c + 1]; t++) {
+            const glm::vec3& p0 = vertices[indices[t * 3 + 0]].position;
+            const glm::vec3& p1 = vertices[indices[t * 3 + 1]].position;
+            const glm::vec3& p2 = vertices[indices[t * 3 + 2]].position;
+            glm::vec3 face_normal = glm::cross(p1 - p0, p2 - p0); // length is twice the area
+            f32 area = glm::length(face_normal);
+            center += (p0 + p1 + p2) * (area / 3.0f);
+            normal += face_normal;
+            cluster_area += area;
+        }
+
+        f32 sort_key = 0.0f;
+        f32 normal_length = glm::length(normal);
+        if (cluster_area > 0.0f && normal_length > 0.0f)
+            sort_key = glm::dot(center / cluster_area - mesh_center, normal / normal_length);
+        sorted.push_back({clusters[c], clusters[c + 1], sort_key});
+    }
+
+    std::stable_sort(sorted.begin(), sorted.end(),
+                     [](const Cluster& a, const Cluster& b) { return a.sort_key > b.sort_key; });
+
+    std::vector<u32> output;
+    output.reserve(index_count);
+    for (const Cluster& cluster : sorted)
+        output.insert(output.end(), indices + cluster.begin * 3, indices + cluster.end * 3);
+
+    std::copy(output.begin(), output.end(), indices);
+}
+
+void MeshOptimizer::OptimizeVertexFetch(Vertex* vertices, u32 vertex_count, u32* indices, u32 index_count)
+{
+    const u32 UNUSED = ~0u;
+    std::vector<u32> remap(vertex_count, UNUSED);
+
+    u32 next = 0;
+    for (u32 i = 0; i < index_count; i++) {
+        u32& target = remap[indices[i]];
+        if (target == UNUSED)
+            target = next++;
+        indices[i] = target;
+    }
+    for (u32 v = 0; v < vertex_count; v++) {
+        if (remap[v] == UNUSED)
+            remap[v] = next++;
+    }
+
+    std::vector<Vertex> reordered(vertex_count);
+    for (u32 v = 0; v < vertex_count; v++)
+        reordered[remap[v]] = vertices[v];
+    std::copy(reordered.begin(), reordered.end(), vertices);
+}
+
+void MeshOptimizer::Optimize(Vertex* vertices, u32 vertex_count, u32* indices, u32 index_count)
+{
+    OptimizeVertexCache(indices, index_count, vertex_count);
+    OptimizeOverdraw(indices, index_count, vertices, vertex_count);
+    OptimizeVertexFetch(vertices, vertex_count, indices, index_count);
+}
+
+MeshOptimizer::CacheStats MeshOptimizer::AnalyzeVertexCache(const u32* indices, u32 index_count, u32 vertex_count,
+                                                            u32 cache_size)
+{
+    CacheStats stats = {0, index_count / 3, 0};
+
+    FifoCache cache(vertex_count, cache_size);
+    std::vector<b8> referenced(vertex_count, false);
+    for (u32 i = 0; i < index_count; i++) {
+        stats.transformed += cache.Access(indices[i]);
+        if (!referenced[indices[i]]) {
+            referenced[indices[i]] = true;
+            stats.vertices++;
+        }
+    }
+    return stats;
+}
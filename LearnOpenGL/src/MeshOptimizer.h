@@ -0,0 +1,39 @@
+#pragma once
+
+#include "defines.h"
+
+#include "Mesh.h"
+
+// Import-time reordering of indexed triangle lists. Indices are local to the given vertex array.
+// Pure CPU code, run by ModelImporter before the mesh cache is written.
+class MeshOptimizer
+{
+public:
+    // Simulated FIFO post-transform cache used for the reported statistics
+    static const u32 STATS_CACHE_SIZE = 16;
+
+    struct CacheStats
+    {
+        u64 transformed; // vertex shader invocations
+        u64 triangles;
+        u64 vertices;    // distinct vertices referenced
+    };
+
+    // Reorders triangles for post-transform cache locality (Forsyth's linear-speed vertex cache optimization).
+    static void OptimizeVertexCache(u32* indices, u32 index_count, u32 vertex_count);
+
+    // Splits the cache-optimized triangle order into clusters and sorts them so outward-facing clusters are drawn
+    // first (Sander et al., "Fast Triangle Reordering for Vertex Locality and Reduced Overdraw"). threshold bounds
+    // how much ACMR may grow by splitting clusters further.
+    static void OptimizeOverdraw(u32* indices, u32 index_count, const Vertex* vertices, u32 vertex_count,
+                                 f32 threshold = 1.05f);
+
+    // Renumbers vertices in the order the indices first use them. Unreferenced vertices move to the end.
+    static void OptimizeVertexFetch(Vertex* vertices, u32 vertex_count, u32* indices, u32 index_count);
+
+    // Runs the three passes above in order
+    static void Optimize(Vertex* vertices, u32 vertex_count, u32* indices, u32 index_count);
+
+    static CacheStats AnalyzeVertexCache(const u32* indices, u32 index_count, u32 vertex_count,
+                                         u32 cache_size = STATS_CACHE_SIZE);
+};
@@ -0,0 +1,355 @@
+#include "MeshSimplifier.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <unordered_map>
+#include <vector>
+
+// open border edges get a plane perpendicular to their triangle, weighted so the outline is kept
+static const f64 BORDER_WEIGHT = 10.0;
+// collapses that turn a triangle's normal by more than ~78 degrees are rejected
+static const f32 MIN_NORMAL_DOT = 0.2f;
+
+enum class VertexKind : u8
+{
+    Manifold, // collapses onto any neighbour
+    Border,   // on an open border, collapses along it only
+    Locked    // seams and non-manifold vertices stay
+};
+
+// sum of squared distances to a set of planes, weighted: Q(p) = p'Ap + 2b'p + c
+struct Quadric
+{
+    f64 a00, a11, a22, a01, a02, a12;
+    f64 b0, b1, b2;
+    f64 c;
+    f64 weight;
+
+    void AddPlane(const glm::vec3& normal, f32 distance, f64 plane_weight)
+    {
+        f64 x = normal.x, y = normal.y, z = normal.z, d = distance;
+        a00 += plane_weight * x * x;
+        a11 += plane_weight * y * y;
+        a22 += plane_weight * z * z;
+        a01 += plane_weight * x * y;
+        a02 += plane_weight * x * z;
+        a12 += plane_weight * y * z;
+        b0 += plane_weight * x * d;
+        b1 += plane_weight * y * d;
+        b2 += plane_weight * z * d;
+        c += plane_weight * d * d;
+        weight += plane_weight;
+    }
+
+    void Add(const Quadric& q)
+    {
+        a00 += q.a00;
+        a11 += q.a11;
+        a22 += q.a22;
+        a01 += q.a01;
+        a02 += q.a02;
+        a12 += q.a12;
+        b0 += q.b0;
+        b1 += q.b1;
+        b2 += q.b2;
+        c += q.c;
+        weight += q.weight;
+    }
+
+    // weighted mean squared distance of p to the planes
+    f64 Evaluate(const glm::vec3& p) const
+    {
+        f64 x = p.x, y = p.y, z = p.z;
+        f64 result = a00 * x * x + a11 * y * y + a22 * z * z + 2.0 * (a01 * x * y + a02 * x * z + a12 * y * z) +
+                     2.0 * (b0 * x + b1 * y + b2 * z) + c;
+        return weight > 0.0 ? std::max(result, 0.0) / weight : 0.0;
+    }
+};
+
+struct Collapse
+{
+    u32 from;
+    u32 to;
+    f32 error; // squared distance
+};
+
+static u64 EdgeKey(u32 a, u32 b)
+{
+    return (static_cast<u64>(a) << 32) | b;
+}
+
+// canonical vertex per position, so seams can be told apart from borders
+static void BuildPositionRemap(const Vertex* vertices, u32 vertex_count, std::vector<u32>& remap,
+                               std::vector<u32>& wedges)
+{
+    std::unordered_map<u64, u32> first_seen;
+    first_seen.reserve(vertex_count);
+    remap.resize(vertex_count);
+    wedges.assign(vertex_count, 0);
+
+    for (u32 v = 0; v < vertex_count; v++) {
+        u32 bits[3];
+        std::memcpy(bits, &vertices[v].position, sizeof(bits));
+        u64 hash = (static_cast<u64>(bits[0]) * 73856093u) ^ (static_cast<u64>(bits[1]) * 19349663u) ^
+                   (static_cast<u64>(bits[2]) * 83492791u) ^ (static_cast<u64>(bits[2]) << 32);
+
+        // probe past hash collisions between different positions
+        u32 canonical = v;
+        while (true) {
+            auto it = first_seen.find(hash);
+            if (it == first_seen.end()) {
+                first_seen.emplace(hash, v);
+                break;
+            }
+            if (vertices[it->second].position == vertices[v].position) {
+                canonical = it->second;
+                break;
+            }
+            hash = hash * 6364136223846793005ull + 1442695040888963407ull;
+        }
+        remap[v] = canonical;
+        wedges[canonical]++;
+    }
+}
+
+// half-edges between positions, counted; one without its opposite is an open border
+static void BuildPositionEdges(const u32* indices, u32 index_count, const std::vector<u32>& remap,
+                               std::unordered_map<u64, u32>& position_edges)
+{
+    position_edges.clear();
+    position_edges.reserve(index_count);
+    for (u32 i = 0; i < index_count; i += 3) {
+        for (u32 e = 0; e < 3; e++) {
+            u32 a = remap[indices[i + e]];
+            u32 b = remap[indices[i + (e + 1) % 3]];
+            position_edges[EdgeKey(a, b)]++;
+        }
+    }
+}
+
+static void ClassifyVertices(const std::vector<u32>& remap, const std::vector<u32>& wedges,
+                             const std::unordered_map<u64, u32>& position_edges, std::vector<VertexKind>& kinds)
+{
+    u32 vertex_count = static_cast<u32>(remap.size());
+    kinds.assign(vertex_count, VertexKind::Manifold);
+    for (const auto& [key, count] : position_edges) {
+        u32 a = static_cast<u32>(key >> 32);
+        u32 b = static_cast<u32>(key & 0xffffffff);
+        if (count > 1) {
+            kinds[a] = VertexKind::Locked;
+            kinds[b] = VertexKind::Locked;
+        }
+        else if (position_edges.find(EdgeKey(b, a)) == position_edges.end()) {
+            if (kinds[a] == VertexKind::Manifold)
+                kinds[a] = VertexKind::Border;
+            if (kinds[b] == VertexKind::Manifold)
+                kinds[b] = VertexKind::Border;
+        }
+    }
+
+    for (u32 v = 0; v < vertex_count; v++) {
+        u32 canonical = remap[v];
+        if (wedges[canonical] > 1)
+            kinds[v] = VertexKind::Locked;
+        else
+            kinds[v] = kinds[canonical];
+    }
+}
+
+static void ComputeQuadrics(const u32* indices, u32 index_count, const Vertex* vertices,
+                            const std::vector<u32>& remap, const std::unordered_map<u64, u32>& position_edges,
+                            std::vector<Quadric>& quadrics)
+{
+    quadrics.assign(remap.size(), Quadric{});
+
+    for (u32 i = 0; i < index_count; i += 3) {
+        const glm::vec3& p0 = vertices[indices[i]].position;
+        const glm::vec3& p1 = vertices[indices[i + 1]].position;
+        const glm::vec3& p2 = vertices[indices[i + 2]].position;
+
+        glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+        f32 length = glm::length(normal);
+        if (length == 0.0f)
+            continue;
+        normal /= length;
+
+        // area weighted, so large triangles keep their shape
+        Quadric plane = {};
+        plane.AddPlane(normal, -glm::dot(normal, p0), length * 0.5);
+        for (u32 e = 0; e < 3; e++)
+            quadrics[indices[i + e]].Add(plane);
+
+        for (u32 e = 0; e < 3; e++) {
+            u32 a = indices[i + e];
+            u32 b = indices[i + (e + 1) % 3];
+            if (position_edges.find(EdgeKey(remap[b], remap[a])) != position_edges.end())
+                continue;
+
+            const glm::vec3& pa = vertices[a].position;
+            const glm::vec3& pb = vertices[b].position;
+            glm::vec3 edge = pb - pa;
+            glm::vec3 perpendicular = glm::cross(edge, normal);
+            f32 perpendicular_length = glm::length(perpendicular);
+            if (perpendicular_length == 0.0f)
+                continue;
+            perpendicular /= perpendicular_length;
+
+            Quadric border = {};
+            border.AddPlane(perpendicular, -glm::dot(perpendicular, pa), glm::dot(edge, edge) * BORDER_WEIGHT);
+            quadrics[a].Add(border);
+            quadrics[b].Add(border);
+        }
+    }
+}
+
+// true if moving from onto to flips or folds none of from's other triangles
+static b8 KeepsOrientation(u32 from, u32 to, const Vertex* vertices, const u32* indices,
+                           const std::vector<u32>& adjacency_offsets, const std::vector<u32>& adjacency)
+{
+    const glm::vec3& target = vertices[to].position;
+    for (u32 k = adjacency_offsets[from]; k < adjacency_offsets[from + 1]; k++) {
+        const u32* triangle = indices + adjacency[k];
+        if (triangle[0] == to || triangle[1] == to || triangle[2] == to)
+            continue; // collapses away
+
+        glm::vec3 p[3];
+        glm::vec3 q[3];
+        for (u32 e = 0; e < 3; e++) {
+            p[e] = vertices[triangle[e]].position;
+            q[e] = triangle[e] == from ? target : p[e];
+        }
+
+        glm::vec3 before = glm::cross(p[1] - p[0], p[2] - p[0]);
+        glm::vec3 after = glm::cross(q[1] - q[0], q[2] - q[0]);
+        f32 scale = glm::length(before) * glm::length(after);
+        if (scale == 0.0f || glm::dot(before, after) < MIN_NORMAL_DOT * scale)
+            return false;
+    }
+    return true;
+}
+
+u32 MeshSimplifier::Simplify(u32* destination, const u32* indices, u32 index_count, const Vertex* vertices,
+                             u32 vertex_count, u32 target_index_count, f32& error)
+{
+    error = 0.0f;
+    std::memcpy(destination, indices, index_count * sizeof(u32));
+    if (index_count <= target_index_count || vertex_count == 0)
+        return index_count;
+
+    std::vector<u32> remap;
+    std::vector<u32> wedges;
+    std::vector<VertexKind> kinds;
+    std::unordered_map<u64, u32> position_edges;
+    std::vector<Quadric> quadrics;
+    BuildPositionRemap(vertices, vertex_count, remap, wedges);
+    BuildPositionEdges(indices, index_count, remap, position_edges);
+    ClassifyVertices(remap, wedges, position_edges, kinds);
+    ComputeQuadrics(indices, index_count, vertices, remap, position_edges, quadrics);
+
+    std::vector<u32> adjacency_offsets(vertex_count + 1);
+    std::vector<u32> adjacency;
+    std::vector<Collapse> collapses;
+    std::vector<u32> collapse_target(vertex_count);
+    std::vector<u8> locked(vertex_count);
+    f32 max_error = 0.0f;
+
+    // Passes of independent collapses: the cheapest ones first, each vertex touched at most once per pass, then
+    // the triangles are rewritten. No priority queue to keep up to date.
+    for (u32 pass = 0; index_count > target_index_count; pass++) {
+        // collapses create new edges, the open ones are looked up in the current triangles
+        if (pass > 0)
+            BuildPositionEdges(destination, index_count, remap, position_edges);
+
+        // triangles around each vertex, by the offset of their first index
+        std::fill(adjacency_offsets.begin(), adjacency_offsets.end(), 0);
+        for (u32 i = 0; i < index_count; i++)
+            adjacency_offsets[destination[i] + 1]++;
+        for (u32 v = 0; v < vertex_count; v++)
+            adjacency_offsets[v + 1] += adjacency_offsets[v];
+        adjacency.resize(index_count);
+        std::vector<u32> fill(adjacency_offsets.begin(), adjacency_offsets.end() - 1);
+        for (u32 i = 0; i < index_count; i++)
+            adjacency[fill[destination[i]]++] = i - i % 3;
+
+        collapses.clear();
+        for (u32 i = 0; i < index_count; i += 3) {
+            for (u32 e = 0; e < 3; e++) {
+                u32 a = destination[i + e];
+                u32 b = destination[i + (e + 1) % 3];
+                b8 open = position_edges.find(EdgeKey(remap[b], remap[a])) == position_edges.end();
+
+                // the cheaper direction of the two allowed ones
+                Collapse best = {0, 0, -1.0f};
+                for (u32 direction = 0; direction < 2; direction++) {
+                    u32 from = direction == 0 ? a : b;
+                    u32 to = direction == 0 ? b : a;
+                    if (kinds[from] == VertexKind::Locked)
+                        continue;
+                    if (kinds[from] == VertexKind::Border && (!open || kinds[to] == VertexKind::Manifold))
+                        continue;
+
+                    Quadric q = quadrics[from];
+                    q.Add(quadrics[to]);
+                    f32 cost = static_cast<f32>(q.Evaluate(vertices[to].position));
+                    if (best.error < 0.0f || cost < best.error)
+                        best = {from, to, cost};
+                }
+                if (best.error >= 0.0f)
+                    collapses.push_back(best);
+            }
+        }
+        if (collapses.empty())
+            break;
+
+        std::sort(collapses.begin(), collapses.end(),
+                  [](const Collapse& x, const Collapse& y) { return x.error < y.error; });
+
+        // a collapse removes two triangles of a closed surface, one on a border
+        u32 goal = std::max((index_count - target_index_count) / 3 / 2, 1u);
+        for (u32 v = 0; v < vertex_count; v++)
+            collapse_target[v] = v;
+        std::fill(locked.begin(), locked.end(), 0);
+
+        u32 collapsed = 0;
+        for (const Collapse& collapse : collapses) {
+            if (collapsed >= goal)
+                break;
+            if (locked[collapse.from] || locked[collapse.to])
+                continue;
+            if (!KeepsOrientation(collapse.from, collapse.to, vertices, destination, adjacency_offsets, adjacency))
+                continue;
+
+            collapse_target[collapse.from] = collapse.to;
+            quadrics[collapse.to].Add(quadrics[collapse.from]);
+            max_error = std::max(max_error, collapse.error);
+            collapsed++;
+
+            // the triangles around the collapse changed, their vertices wait for the next pass
+            for (u32 k = adjacency_offsets[collapse.from]; k < adjacency_offsets[collapse.from + 1]; k++) {
+                for (u32 e = 0; e < 3; e++)
+                    locked[destination[adjacency[k] + e]] = 1;
+            }
+            locked[collapse.to] = 1;
+        }
+        if (collapsed == 0)
+            break;
+
+        // rewrite the triangles, dropping the ones that collapsed to a line
+        u32 write = 0;
+        for (u32 i = 0; i < index_count; i += 3) {
+            u32 a = collapse_target[destination[i]];
+            u32 b = collapse_target[destination[i + 1]];
+            u32 c = collapse_target[destination[i + 2]];
+            if (a == b || b == c || a == c)
+                continue;
+            destination[write++] = a;
+            destination[write++] = b;
+            destination[write++] = c;
+        }
+        index_count = write;
+    }
+
+    error = std::sqrt(max_error);
+    return index_count;
+}
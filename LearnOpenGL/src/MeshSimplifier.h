@@ -0,0 +1,21 @@
+#pragma once
+
+#include "defines.h"
+
+#include "Mesh.h"
+
+// Import-time simplification of indexed triangle lists by edge collapse, ordered by quadric error (Garland &
+// Heckbert, "Surface Simplification Using Quadric Error Metrics"). Pure CPU code, run by ModelImporter.
+//
+// Vertices are collapsed onto one of their neighbours and never moved, so every level of detail indexes the
+// original vertex array. Vertices on UV or normal seams (several vertices at one position) stay where they are,
+// and vertices on open borders only slide along the border, so neither tears apart.
+class MeshSimplifier
+{
+public:
+    // Writes at most index_count indices to destination, stopping at target_index_count or once nothing can be
+    // collapsed anymore, and returns how many were written. error receives the largest distance a collapse moved
+    // the surface, in the units of the vertex positions.
+    static u32 Simplify(u32* destination, const u32* indices, u32 index_count, const Vertex* vertices,
+                        u32 vertex_count, u32 target_index_count, f32& error);
+};
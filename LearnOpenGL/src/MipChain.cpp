@@ -0,0 +1,71 @@
+#include "MipChain.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+void MipChain::Build(u32 width, u32 height, const u8* rgba, b8 normal_map, std::vector<TextureLevel>& levels,
+                     std::vector<u8>& data)
+{
+    levels.clear();
+    data.clear();
+
+    u64 size = static_cast<u64>(width) * height * 4;
+    levels.push_back({width, height, 0, size});
+    data.assign(rgba, rgba + size);
+
+    std::vector<u8> next;
+    while (width > 1 || height > 1) {
+        const TextureLevel& last = levels.back();
+        Downsample(width, height, data.data() + last.offset, normal_map, next);
+
+        width = std::max(width / 2, 1u);
+        height = std::max(height / 2, 1u);
+        levels.push_back({width, height, data.size(), next.size()});
+        data.insert(data.end(), next.begin(), next.end());
+    }
+}
+
+void MipChain::Downsample(u32 width, u32 height, const u8* rgba, b8 normal_map, std::vector<u8>& out)
+{
+    u32 out_width = std::max(width / 2, 1u);
+    u32 out_height = std::max(height / 2, 1u);
+    out.resize(static_cast<u64>(out_width) * out_height * 4);
+
+    for (u32 y = 0; y < out_height; y++) {
+        u32 y0 = std::min(y * 2, height - 1);
+        u32 y1 = std::min(y * 2 + 1, height - 1);
+        for (u32 x = 0; x < out_width; x++) {
+            u32 x0 = std::min(x * 2, width - 1);
+            u32 x1 = std::min(x * 2 + 1, width - 1);
+            const u8* p[4] = {rgba + (static_cast<u64>(y0) * width + x0) * 4,
+                              rgba + (static_cast<u64>(y0) * width + x1) * 4,
+                              rgba + (static_cast<u64>(y1) * width + x0) * 4,
+                              rgba + (static_cast<u64>(y1) * width + x1) * 4};
+            u8* dst = out.data() + (static_cast<u64>(y) * out_width + x) * 4;
+
+            if (normal_map) {
+                f32 n[3] = {0.0f, 0.0f, 0.0f};
+                for (u32 i = 0; i < 4; i++) {
+                    for (u32 c = 0; c < 3; c++)
+                        n[c] += p[i][c] / 127.5f - 1.0f;
+                }
+                f32 len = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+                if (len < 1e-6f) {
+                    n[0] = 0.0f;
+                    n[1] = 0.0f;
+                    n[2] = 1.0f;
+                    len = 1.0f;
+                }
+                for (u32 c = 0; c < 3; c++)
+                    dst[c] = static_cast<u8>(std::lround((n[c] / len + 1.0f) * 127.5f));
+                dst[3] = static_cast<u8>((p[0][3] + p[1][3] + p[2][3] + p[3][3] + 2) / 4);
+            }
+            else {
+                for (u32 c = 0; c < 4; c++)
+                    dst[c] = static_cast<u8>((p[0][c] + p[1][c] + p[2][c] + p[3][c] + 2) / 4);
+            }
+        }
+    }
+}
+
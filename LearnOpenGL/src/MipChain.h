@@ -0,0 +1,20 @@
+#pragma once
+
+#include "defines.h"
+
+#include "Texture2D.h"
+
+#include <vector>
+
+// CPU mip generation for 8-bit RGBA images.
+class MipChain
+{
+public:
+    // Builds the full chain down to 1x1. Level 0 is a copy of rgba, levels are stored back to back in data.
+    static void Build(u32 width, u32 height, const u8* rgba, b8 normal_map, std::vector<TextureLevel>& levels,
+                      std::vector<u8>& data);
+
+    // Box-filters an image down to half its size (rounded down, at least 1).
+    // Normal maps are renormalized after filtering.
+    static void Downsample(u32 width, u32 height, const u8* rgba, b8 normal_map, std::vector<u8>& out);
+};
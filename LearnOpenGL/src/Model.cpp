@@ -1,193 +1,519 @@
 #include "Model.h"
 
+#include "InstanceBuffer.h"
 #include "Log.h"
-
-Model::Model(const char* path)
+#include "MeshCache.h"
+#include "ModelImporter.h"
+#include "RenderQueue.h"
+#include "TextureLoader.h"
+#include "TextureRegistry.h"
+#include "Timer.h"
+
+#include <algorithm>
+
+CullBatch Model::s_CullBatch;
+std::vector<u8> Model::s_CullResults;
+std::vector<Model::CullCandidate> Model::s_Candidates;
+std::vector<glm::mat4> Model::s_Transforms;
+std::vector<ObjectConstants> Model::s_Instances;
+b8 Model::s_LodEnabled = true;
+f32 Model::s_LodThreshold = 1.0f;
+
+// meshes the camera is inside of are measured from this distance instead
+static const f32 MIN_LOD_DISTANCE = 0.01f;
+
+Model::Model(const char* path, VertexFormat format)
 {
+    vertex_format = format;
     LoadModel(path);
 }
 
 void Model::Draw(Shader& shader)
 {
+    if (!ready)
+        return;
+
+    // one VAO for the whole model, each mesh is a range inside the arena
+    MeshUniforms uniforms = MeshUniforms::Resolve(shader);
+    arena->Bind();
     for (auto& mesh : meshes) {
-        mesh.Draw(shader);
+        mesh.Draw(shader, uniforms);
     }
+    arena->Unbind();
 }
 
-void Model::LoadModel(std::string path)
+void Model::Submit(Shader& shader, const glm::mat4& transform, const Frustum& frustum, const LodSelection& selection,
+                   u32 instance)
 {
-    LOG_INFO("Assimp: Loading Model: {0}", path.c_str());
-    Assimp::Importer importer;
-    u32 flags = aiProcess_Triangulate | aiProcess_FlipUVs | aiProcess_GenSmoothNormals | aiProcess_CalcTangentSpace;
-    const aiScene* scene = importer.ReadFile(path, flags);
-
-    if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode) {
-        LOG_ERROR("Assimp: {0}", importer.GetErrorString());
+    if (!ready)
         return;
+
+    UpdateHierarchy();
+    std::vector<u32>& lods = mesh_lods[instance];
+    if (lods.size() != meshes.size())
+        lods.assign(meshes.size(), 0);
+
+    s_CullBatch.Clear();
+    s_Candidates.clear();
+    s_Transforms.clear();
+    u32 visible = 0;
+    u32 subtrees_culled = 0;
+
+    for (u32 i = 0; i < nodes.size();) {
+        const Node& node = nodes[i];
+        if (!node.has_bounds) {
+            i = node.subtree_end;
+            continue;
+        }
+
+        Frustum::Containment containment = frustum.Classify(node.bounds.Transform(transform));
+        if (containment == Frustum::Containment::Outside) {
+            subtrees_culled++;
+            i = node.subtree_end;
+            continue;
+        }
+
+        if (containment == Frustum::Containment::Inside) {
+            for (; i < node.subtree_end; i++) {
+                glm::mat4 node_transform = transform * nodes[i].world;
+                for (u32 m = nodes[i].first_mesh; m < nodes[i].first_mesh + nodes[i].mesh_count; m++) {
+                    RenderQueue::Submit(RenderPass::Opaque, shader, *arena, meshes[m], node_transform,
+                                        SelectLod(m, node_transform, selection, lods[m]), instance);
+                }
+                visible += nodes[i].mesh_count;
+            }
+            continue;
+        }
+
+        // straddling a plane: the node's own meshes are tested one by one, its children get their own turn
+        if (node.mesh_count > 0) {
+            u32 transform_index = static_cast<u32>(s_Transforms.size());
+            s_Transforms.push_back(transform * node.world);
+            for (u32 m = node.first_mesh; m < node.first_mesh + node.mesh_count; m++) {
+                s_CullBatch.Add(meshes[m].GetBoundingBox().Transform(s_Transforms.back()));
+                s_Candidates.push_back({m, transform_index});
+            }
+        }
+        i++;
     }
 
-    // retrieve the directory path of the filepath
-    directory = path.substr(0, path.find_last_of('/'));
+    visible += frustum.Cull(s_CullBatch, s_CullResults);
+    RenderQueue::RecordCulling(static_cast<u32>(meshes.size()), visible, subtrees_culled);
 
-    // process ASSIMP's root node recursively
-    ProcessNode(scene->mRootNode, scene);
+    for (u32 i = 0; i < s_Candidates.size(); i++) {
+        if (s_CullResults[i]) {
+            const CullCandidate& candidate = s_Candidates[i];
+            const glm::mat4& mesh_transform = s_Transforms[candidate.transform];
+            RenderQueue::Submit(RenderPass::Opaque, shader, *arena, meshes[candidate.mesh], mesh_transform,
+                                SelectLod(candidate.mesh, mesh_transform, selection, lods[candidate.mesh]),
+                                instance);
+        }
+    }
 }
 
-void Model::ProcessNode(aiNode* node, const aiScene* scene)
+u32 Model::DrawInstanced(Shader& shader, const std::vector<glm::mat4>& transforms, const Frustum& frustum)
 {
-    // process all the node's mashes (if any)
-    for (u32 i = 0; i < node->mNumMeshes; i++) {
-        aiMesh* mesh = scene->mMeshes[node->mMeshes[i]];
-        meshes.push_back(ProcessMesh(mesh, scene));
+    if (!ready || transforms.empty())
+        return 0;
+
+    UpdateHierarchy();
+    const Node& root = nodes[0];
+    if (!root.has_bounds)
+        return 0;
+
+    // the whole model's box per copy, in one batch
+    s_CullBatch.Clear();
+    for (const glm::mat4& transform : transforms)
+        s_CullBatch.Add(root.bounds.Transform(transform));
+    u32 visible = frustum.Cull(s_CullBatch, s_CullResults);
+    if (visible == 0)
+        return 0;
+
+    s_Transforms.clear();
+    for (u32 i = 0; i < transforms.size(); i++) {
+        if (s_CullResults[i])
+            s_Transforms.push_back(transforms[i]);
     }
 
-    // then do the same for each of its children
-    for (u32 i = 0; i < node->mNumChildren; i++) {
-        ProcessNode(node->mChildren[i], scene);
+    MeshUniforms uniforms = MeshUniforms::Resolve(shader);
+    shader.Use();
+    arena->Bind();
+
+    // every node's meshes get their own run of instances, with the node transform folded in
+    for (const Node& node : nodes) {
+        if (node.mesh_count == 0)
+            continue;
+
+        s_Instances.clear();
+        for (const glm::mat4& transform : s_Transforms)
+            s_Instances.push_back(UniformBuffers::MakeObject(transform * node.world));
+        InstanceBuffer::Bind(InstanceBuffer::Write(s_Instances.data(), visible));
+
+        for (u32 m = node.first_mesh; m < node.first_mesh + node.mesh_count; m++) {
+            meshes[m].BindMaterial();
+            meshes[m].DrawGeometry(shader, uniforms, 0, visible);
+        }
     }
+
+    InstanceBuffer::Unbind();
+    arena->Unbind();
+    glActiveTexture(GL_TEXTURE0);
+    return visible;
 }
 
-Mesh Model::ProcessMesh(aiMesh* mesh, const aiScene* scene)
+u32 Model::DrawDepth(Shader& shader, const glm::mat4& transform, const Frustum& frustum)
 {
-    std::vector<Vertex> vertices;
-    std::vector<u32> indices;
-    std::vector<Texture2D> textures;
-
-    for (u32 i = 0; i < mesh->mNumVertices; i++) {
-        Vertex vertex;
-
-        // process vertex positions, normals and texture coordinates
-        // positions
-        glm::vec3 vector;
-        vector.x = mesh->mVertices[i].x;
-        vector.y = mesh->mVertices[i].y;
-        vector.z = mesh->mVertices[i].z;
-        vertex.position = vector;
-
-        // normals
-        if (mesh->HasNormals()) {
-            vector.x = mesh->mNormals[i].x;
-            vector.y = mesh->mNormals[i].y;
-            vector.z = mesh->mNormals[i].z;
-            vertex.normal = vector;
+    if (!ready)
+        return 0;
+
+    UpdateHierarchy();
+    s_CullBatch.Clear();
+    s_Candidates.clear();
+    s_Instances.clear();
+    for (u32 i = 0; i < nodes.size();) {
+        const Node& node = nodes[i];
+        if (!node.has_bounds || !frustum.IsVisible(node.bounds.Transform(transform))) {
+            i = node.subtree_end;
+            continue;
         }
 
-        // texture coordinates
-        if (mesh->mTextureCoords[0]) {
-            glm::vec2 vec;
-            vec.x = mesh->mTextureCoords[0][i].x;
-            vec.y = mesh->mTextureCoords[0][i].y;
-            vertex.tex_coords = vec;
-
-            vector.x = mesh->mTangents[i].x;
-            vector.y = mesh->mTangents[i].y;
-            vector.z = mesh->mTangents[i].z;
-            vertex.tangents = vector;
-
-            vector.x = mesh->mBitangents[i].x;
-            vector.y = mesh->mBitangents[i].y;
-            vector.z = mesh->mBitangents[i].z;
-            vertex.bitangents = vector;
+        if (node.mesh_count > 0) {
+            u32 object = static_cast<u32>(s_Instances.size());
+            glm::mat4 node_transform = transform * node.world;
+            s_Instances.push_back(UniformBuffers::MakeObject(node_transform));
+            for (u32 m = node.first_mesh; m < node.first_mesh + node.mesh_count; m++) {
+                s_CullBatch.Add(meshes[m].GetBoundingBox().Transform(node_transform));
+                s_Candidates.push_back({m, object});
+            }
         }
-        else {
-            vertex.tex_coords = glm::vec2(0.0f, 0.0f);
+        i++;
+    }
+
+    u32 visible = frustum.Cull(s_CullBatch, s_CullResults);
+    if (visible == 0)
+        return 0;
+
+    // one object block per node, all written at once
+    u32 first_slot = UniformBuffers::WriteObjects(s_Instances.data(), static_cast<u32>(s_Instances.size()));
+    MeshUniforms uniforms = MeshUniforms::Resolve(shader);
+    shader.Use();
+    arena->BindPositions();
+    u32 bound_object = ~0u;
+    for (u32 i = 0; i < s_Candidates.size(); i++) {
+        if (!s_CullResults[i])
+            continue;
+        const CullCandidate& candidate = s_Candidates[i];
+        if (candidate.transform != bound_object) {
+            bound_object = candidate.transform;
+            UniformBuffers::BindObject(first_slot + bound_object);
         }
+        meshes[candidate.mesh].DrawGeometry(shader, uniforms);
+    }
+    arena->Unbind();
+    return visible;
+}
+
+b8 Model::GetBounds(const glm::mat4& transform, BoundingBox& bounds)
+{
+    if (!ready)
+        return false;
+
+    UpdateHierarchy();
+    if (!nodes[0].has_bounds)
+        return false;
+    bounds = nodes[0].bounds.Transform(transform);
+    return true;
+}
+
+void Model::SetLodEnabled(b8 enabled)
+{
+    s_LodEnabled = enabled;
+}
+
+b8 Model::IsLodEnabled()
+{
+    return s_LodEnabled;
+}
+
+void Model::SetLodThreshold(f32 pixels)
+{
+    s_LodThreshold = pixels;
+}
+
+f32 Model::GetLodThreshold()
+{
+    return s_LodThreshold;
+}
+
+u32 Model::GetNodeCount() const
+{
+    return static_cast<u32>(nodes.size());
+}
+
+void Model::SetLocalTransform(u32 node, const glm::mat4& local)
+{
+    nodes[node].local = local;
+    nodes[node].dirty = true;
+    hierarchy_dirty = true;
+}
+
+const glm::mat4& Model::GetLocalTransform(u32 node) const
+{
+    return nodes[node].local;
+}
 
-        vertices.push_back(vertex);
+void Model::Destroy()
+{
+    if (arena) {
+        arena->Free(vertex_block, index_block);
+        arena = nullptr;
     }
 
-    // process indices
-    for (u32 i = 0; i < mesh->mNumFaces; i++) {
-        aiFace face = mesh->mFaces[i];
-        for (u32 j = 0; j < face.mNumIndices; j++) {
-            indices.push_back(face.mIndices[j]);
-        }
+    meshes.clear();
+    nodes.clear();
+    mesh_lods.clear();
+    textures_loaded.clear();
+    ready = false;
+}
+
+void Model::LoadModel(std::string path)
+{
+    Timer timer;
+    ModelData data;
+
+    b8 cached = false;
+    if (!ReadModelData(path, data, cached))
+        return;
+    f64 import_ms = timer.ElapsedMillis();
+
+    directory = data.directory;
+    if (!SetupMeshes(data)) {
+        LOG_ERROR("Model: Failed to allocate the geometry of {0}", path);
+        return;
     }
+    ready = true;
 
-    // process material
-    if (mesh->mMaterialIndex >= 0) {
-        aiMaterial* material = scene->mMaterials[mesh->mMaterialIndex];
+    LOG_INFO("Model: {0} loaded in {1:.2f} ms ({2} {3:.2f} ms, upload {4:.2f} ms)", path, timer.ElapsedMillis(),
+             cached ? "cache" : "import", import_ms, timer.ElapsedMillis() - import_ms);
 
-        std::vector<Texture2D> diffuse_maps = LoadMaterialTextures(material, aiTextureType_DIFFUSE, "texture_diffuse");
-        textures.insert(textures.end(), diffuse_maps.begin(), diffuse_maps.end());
+    LogIndexMemory(path);
 
-        std::vector<Texture2D> specular_maps =
-            LoadMaterialTextures(material, aiTextureType_SPECULAR, "texture_specular");
-        textures.insert(textures.end(), specular_maps.begin(), specular_maps.end());
+    TextureRegistry::Stats stats = TextureRegistry::GetStats();
+    LOG_INFO("TextureRegistry: {0} textures, {1} hits, {2} misses, {3:.2f} MB resident, {4:.2f} MB saved",
+             stats.textures, stats.hits, stats.misses, stats.resident_bytes / (1024.0 * 1024.0),
+             stats.bytes_saved / (1024.0 * 1024.0));
+}
 
-        std::vector<Texture2D> normal_maps = LoadMaterialTextures(material, aiTextureType_HEIGHT, "texture_normal");
-        textures.insert(textures.end(), normal_maps.begin(), normal_maps.end());
+b8 Model::ReadModelData(const std::string& path, ModelData& data, b8& cached)
+{
+    // warm start: map the cached geometry, cold start: import through Assimp and refresh the cache
+    cached = MeshCache::Load(path, MODEL_IMPORT_FLAGS, data);
+    if (!cached) {
+        if (!ModelImporter::Import(path, MODEL_IMPORT_FLAGS, data))
+            return false;
+        MeshCache::Store(path, MODEL_IMPORT_FLAGS, data);
     }
+    return true;
+}
+
+b8 Model::SetupMeshes(const ModelData& data)
+{
+    std::vector<std::vector<u32>> index_offsets;
+    if (!AllocateGeometry(data, index_offsets))
+        return false;
+
+    // collect every texture up front so the decode threads work while the geometry is uploaded
+    std::vector<std::vector<Texture2D>> mesh_textures;
+    mesh_textures.reserve(data.meshes.size());
+    for (const MeshData& mesh : data.meshes) {
+        mesh_textures.push_back(LoadMaterialTextures(mesh.textures));
+    }
+
+    meshes.reserve(data.meshes.size());
+    for (u32 i = 0; i < data.meshes.size(); i++)
+        AddMesh(data, i, index_offsets[i], mesh_textures[i]);
 
-    return Mesh(vertices, indices, textures);
+    SetupNodes(data);
+
+    // upload every texture the model references once the decode threads are done with them
+    TextureLoader::Flush();
+    return true;
 }
 
-std::vector<Texture2D> Model::LoadMaterialTextures(aiMaterial* mat, aiTextureType type, std::string type_name)
+void Model::SetupNodes(const ModelData& data)
 {
-    std::vector<Texture2D> textures;
+    nodes.clear();
+    nodes.reserve(std::max<size_t>(data.nodes.size(), 1));
+    for (const NodeData& node : data.nodes) {
+        nodes.push_back({node.parent, node.subtree_end, node.first_mesh, node.mesh_count, node.local,
+                         glm::mat4(1.0f), {glm::vec3(0.0f), glm::vec3(0.0f)}, false, true});
+    }
 
-    for (u32 i = 0; i < mat->GetTextureCount(type); i++) {
-        aiString str;
-        mat->GetTexture(type, i, &str);
-
-        // check if texture was loaded before and if so, continue to next iteration: skip loading a new texture
-        bool skip = false;
-        for (u32 j = 0; j < textures_loaded.size(); j++) {
-            if (std::strcmp(textures_loaded[j].GetPath().data(), str.C_Str()) == 0) {
-                textures.push_back(textures_loaded[j]);
-                skip = true;
-                break;
-            }
-        }
-        if (!skip) {
-            Texture2D texture;
-            texture = TextureFromFile(str.C_Str(), this->directory);
-            texture.SetType(type_name);
-            texture.SetPath(str.C_Str());
-            textures.push_back(texture);
-            textures_loaded.push_back(texture);
-        }
+    // a single root holding every mesh
+    if (nodes.empty()) {
+        nodes.push_back({NodeData::NO_PARENT, 1, 0, static_cast<u32>(meshes.size()), glm::mat4(1.0f),
+                         glm::mat4(1.0f), {glm::vec3(0.0f), glm::vec3(0.0f)}, false, true});
     }
-    return textures;
+
+    hierarchy_dirty = true;
+    UpdateHierarchy();
 }
 
-Texture2D Model::TextureFromFile(const char* path, const std::string& directory)
+void Model::UpdateHierarchy()
 {
-    std::string filename = std::string(path);
-    filename = directory + '/' + filename;
-    LOG_TRACE("Texture: {0}", filename);
+    if (!hierarchy_dirty)
+        return;
 
-    Texture2D texture;
+    // parents come first, so a moved parent has passed its flag on before its children are reached
+    for (Node& node : nodes) {
+        if (node.parent != NodeData::NO_PARENT && nodes[node.parent].dirty)
+            node.dirty = true;
+        if (node.dirty)
+            node.world = node.parent == NodeData::NO_PARENT ? node.local : nodes[node.parent].world * node.local;
+    }
 
-    stbi_set_flip_vertically_on_load(false);
-    i32 width, height, nrComponents;
-    u8* data = stbi_load(filename.c_str(), &width, &height, &nrComponents, 0);
-    if (data) {
-        u32 format;
-        if (nrComponents == 1) {
-            format = GL_RED;
-            texture.SetInternalFormat(format);
-            texture.SetImageFormat(format);
-        }
-        else if (nrComponents == 3) {
-            format = GL_RGB;
-            texture.SetInternalFormat(format);
-            texture.SetImageFormat(format);
-        }
-        else if (nrComponents == 4) {
-            format = GL_RGBA;
-            texture.SetInternalFormat(format);
-            texture.SetImageFormat(format);
+    // and children come after, so walking backwards rebuilds the bounds bottom-up
+    for (u32 i = static_cast<u32>(nodes.size()); i-- > 0;) {
+        Node& node = nodes[i];
+        if (!node.dirty)
+            continue;
+
+        node.has_bounds = false;
+        auto merge = [&node](const BoundingBox& box) {
+            node.bounds = node.has_bounds ? BoundingBox::Merge(node.bounds, box) : box;
+            node.has_bounds = true;
+        };
+        for (u32 m = node.first_mesh; m < node.first_mesh + node.mesh_count; m++)
+            merge(meshes[m].GetBoundingBox().Transform(node.world));
+        for (u32 child = i + 1; child < node.subtree_end; child = nodes[child].subtree_end) {
+            if (nodes[child].has_bounds)
+                merge(nodes[child].bounds);
         }
 
-        texture.Generate(width, height, data, true);
+        if (node.parent != NodeData::NO_PARENT)
+            nodes[node.parent].dirty = true;
+        node.dirty = false;
+    }
+
+    hierarchy_dirty = false;
+}
+
+b8 Model::AllocateGeometry(const ModelData& data, std::vector<std::vector<u32>>& index_offsets)
+{
+    // mesh index blocks stay 4-byte aligned so 16 and 32-bit meshes can follow each other
+    u64 index_bytes = 0;
+    auto reserve = [&index_bytes](const u32* indices, u32 index_count, u32 vertex_count) {
+        u32 offset = static_cast<u32>(index_bytes);
+        u32 size = Mesh::GetIndexMemory(indices, index_count, vertex_count);
+        index_bytes += (size + GeometryArena::INDEX_ALIGNMENT - 1) / GeometryArena::INDEX_ALIGNMENT *
+                       GeometryArena::INDEX_ALIGNMENT;
+        return offset;
+    };
+
+    index_offsets.clear();
+    index_offsets.reserve(data.meshes.size());
+    for (const MeshData& mesh : data.meshes) {
+        std::vector<u32> offsets;
+        offsets.push_back(reserve(data.indices + mesh.first_index, mesh.index_count, mesh.vertex_count));
+        for (const MeshLod& lod : mesh.lods)
+            offsets.push_back(reserve(data.indices + lod.first_index, lod.index_count, mesh.vertex_count));
+        index_offsets.push_back(std::move(offsets));
+    }
+
+    if (index_bytes > GeometryArena::MAX_BUFFER_SIZE) {
+        LOG_ERROR("Model: {0} index bytes are more than the geometry arena holds", index_bytes);
+        return false;
+    }
+
+    arena = &GeometryArena::Get(vertex_format);
+    if (!arena->AllocateVertices(static_cast<u32>(data.vertex_count), vertex_block) ||
+        !arena->AllocateIndices(static_cast<u32>(index_bytes), index_block)) {
+        arena->Free(vertex_block, index_block);
+        vertex_block = {0, 0};
+        index_block = {0, 0};
+        arena = nullptr;
+        return false;
+    }
+
+    for (std::vector<u32>& offsets : index_offsets) {
+        for (u32& offset : offsets)
+            offset += index_block.offset;
+    }
+    return true;
+}
+
+void Model::AddMesh(const ModelData& data, u32 index, const std::vector<u32>& index_offsets,
+                    std::vector<Texture2D> textures)
+{
+    const MeshData& mesh = data.meshes[index];
+    meshes.push_back(Mesh(*arena, vertex_block.offset + mesh.first_vertex, index_offsets[0],
+                          data.vertices + mesh.first_vertex, mesh.vertex_count, data.indices + mesh.first_index,
+                          mesh.index_count, mesh.box, mesh.sphere, textures));
+
+    for (u32 i = 0; i < mesh.lods.size(); i++) {
+        const MeshLod& lod = mesh.lods[i];
+        meshes.back().AddLod(*arena, index_offsets[i + 1], data.indices + lod.first_index, lod.index_count,
+                             mesh.vertex_count, lod.error);
+    }
+}
+
+u32 Model::SelectLod(u32 mesh, const glm::mat4& transform, const LodSelection& selection, u32& lod)
+{
+    u32 lod_count = meshes[mesh].GetLodCount();
+    if (!s_LodEnabled || lod_count == 1) {
+        lod = 0;
+        return lod;
+    }
+
+    // the errors are in the mesh's own units, scaled along with its bounding sphere
+    const BoundingSphere& sphere = meshes[mesh].GetBoundingSphere();
+    BoundingSphere world = sphere.Transform(transform);
+    f32 scale = sphere.radius > 0.0f ? world.radius / sphere.radius : 1.0f;
+    f32 distance = std::max(glm::length(world.center - selection.view_position) - world.radius, MIN_LOD_DISTANCE);
+    f32 pixels_per_unit = selection.projection_scale * scale / distance;
+
+    // starting from last frame's level; errors grow with every level
+    f32 finer = s_LodThreshold * (1.0f + LOD_HYSTERESIS);
+    f32 coarser = s_LodThreshold * (1.0f - LOD_HYSTERESIS);
+    lod = std::min(lod, lod_count - 1);
+    while (lod > 0 && meshes[mesh].GetLodError(lod) * pixels_per_unit > finer)
+        lod--;
+    while (lod + 1 < lod_count && meshes[mesh].GetLodError(lod + 1) * pixels_per_unit < coarser)
+        lod++;
+    return lod;
+}
+
+std::vector<Texture2D> Model::LoadMaterialTextures(const std::vector<TextureRef>& refs)
+{
+    std::vector<Texture2D> textures;
 
-        stbi_image_free(data);
+    for (const TextureRef& ref : refs) {
+        // shared across models: the file is decoded and uploaded only the first time it is requested
+        TextureHandle handle = TextureRegistry::Acquire(directory + '/' + ref.path);
+        Texture2D texture = handle.Get();
+        texture.SetType(ref.type);
+        texture.SetPath(ref.path);
+        textures.push_back(texture);
+        textures_loaded.push_back(std::move(handle));
     }
-    else {
-        LOG_ERROR("Texture: Failed to load {0}", path);
-        stbi_image_free(data);
+    return textures;
+}
+
+void Model::LogIndexMemory(const std::string& path) const
+{
+    u64 index_bytes = 0;
+    u64 wide_bytes = 0;
+    u64 lod_bytes = 0;
+    for (const Mesh& mesh : meshes) {
+        index_bytes += mesh.GetIndexMemory();
+        for (u32 lod = 0; lod < mesh.GetLodCount(); lod++) {
+            wide_bytes += static_cast<u64>(mesh.GetIndexCount(lod)) * sizeof(u32);
+            if (lod > 0)
+                lod_bytes += static_cast<u64>(mesh.GetIndexCount(lod)) * mesh.GetIndexSize(lod);
+        }
     }
 
-    return texture;
+    LOG_INFO("Model: {0} indices {1:.2f} MB ({2:.2f} MB of them coarser levels), {3:.2f} MB saved by 16-bit indices",
+             path, index_bytes / (1024.0 * 1024.0), lod_bytes / (1024.0 * 1024.0),
+             (wide_bytes - index_bytes) / (1024.0 * 1024.0));
 }
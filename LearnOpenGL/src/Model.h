@@ -2,34 +2,145 @@
 
 #include "defines.h"
 
+#include "Frustum.h"
+#include "GeometryArena.h"
 #include "Mesh.h"
-
-#include <assimp/Importer.hpp>
-#include <assimp/postprocess.h>
-#include <assimp/scene.h>
+#include "ModelData.h"
+#include "TextureRegistry.h"
+#include "UniformBuffers.h"
 
 #include <glm/glm.hpp>
-#include <stb_image.h>
 
 #include <string>
+#include <unordered_map>
 #include <vector>
 
+// The view Model::Submit measures the screen-space error of each mesh's levels of detail against
+struct LodSelection
+{
+    glm::vec3 view_position;
+    f32 projection_scale; // pixels per world unit at distance 1, viewport height / (2 tan(fov_y / 2))
+};
+
 class Model
 {
 public:
-    std::vector<Texture2D> textures_loaded;
+    std::vector<TextureHandle> textures_loaded;
     std::vector<Mesh> meshes;
     std::string directory;
 
     Model() {}
-    Model(const char* path);
+    Model(const char* path, VertexFormat format = VertexFormat::Float);
+
+    // Models loaded through ModelLoader draw nothing until their last mesh has been uploaded
+    b8 IsReady() const { return ready; }
 
+    // draws every mesh with the object block bound by the caller, node transforms are not applied
     void Draw(Shader& shader);
 
+    // Queues a draw packet on the RenderQueue for every mesh whose bounds intersect the frustum. The node hierarchy
+    // is walked top-down: subtrees outside the frustum are skipped whole and subtrees inside it are not tested.
+    // Each mesh is drawn at the level of detail selection picks for it. Copies of the model submitted in the same
+    // frame need their own instance id, stable across frames, for occlusion culling and the level of detail
+    // hysteresis to tell them apart.
+    void Submit(Shader& shader, const glm::mat4& transform, const Frustum& frustum, const LodSelection& selection,
+                u32 instance = 0);
+
+    // Draws a copy of the model for every transform whose bounds intersect the frustum, as one instanced draw per
+    // mesh at full detail. The visible copies are compacted into the InstanceBuffer, so shader must be built with
+    // INSTANCED. Draws right away rather than through the RenderQueue; returns the number of copies drawn.
+    u32 DrawInstanced(Shader& shader, const std::vector<glm::mat4>& transforms, const Frustum& frustum);
+
+    // Draws the depth of every mesh whose bounds intersect the frustum at full detail, over the arena's position
+    // stream; shader is a depth-only program built for the model's vertex format. Subtrees outside the frustum are
+    // skipped whole, the meshes of the others are tested in one batch. Draws right away; returns the meshes drawn.
+    u32 DrawDepth(Shader& shader, const glm::mat4& transform, const Frustum& frustum);
+
+    // world-space bounds of the whole model, false until it is ready
+    b8 GetBounds(const glm::mat4& transform, BoundingBox& bounds);
+
+    // Levels of detail: each mesh is drawn at its coarsest level whose error covers fewer than threshold pixels.
+    // A mesh only changes level once its error is LOD_HYSTERESIS past the threshold, so it doesn't flicker
+    // between two levels at the switching distance. The last level is kept per Submit instance, so copies of the
+    // model don't overwrite each other's.
+    static constexpr f32 LOD_HYSTERESIS = 0.25f;
+    static void SetLodEnabled(b8 enabled);
+    static b8 IsLodEnabled();
+    static void SetLodThreshold(f32 pixels);
+    static f32 GetLodThreshold();
+
+    // Node transforms, relative to the parent node. World transforms and bounds follow on the next Submit.
+    u32 GetNodeCount() const;
+    void SetLocalTransform(u32 node, const glm::mat4& local);
+    const glm::mat4& GetLocalTransform(u32 node) const;
+
+    // Returns the model's geometry to its arena and releases its textures
+    void Destroy();
+
 private:
+    friend class ModelLoader;
+
+    // NodeData plus the model-space transform and the bounds of everything in the node's subtree
+    struct Node
+    {
+        u32 parent;
+        u32 subtree_end;
+        u32 first_mesh;
+        u32 mesh_count;
+        glm::mat4 local;
+        glm::mat4 world; // model space
+        BoundingBox bounds;
+        b8 has_bounds; // false for subtrees without meshes
+        b8 dirty;
+    };
+
+    // a mesh left for the per-mesh test, with the index of its transform in s_Transforms (s_Instances in DrawDepth)
+    struct CullCandidate
+    {
+        u32 mesh;
+        u32 transform;
+    };
+
+    b8 ready = false;
+    VertexFormat vertex_format = VertexFormat::Float;
+
+    // every mesh lives inside these two blocks
+    GeometryArena* arena = nullptr;
+    GeometryArena::Block vertex_block = {0, 0};
+    GeometryArena::Block index_block = {0, 0};
+
+    std::vector<Node> nodes; // depth-first, see NodeData
+    b8 hierarchy_dirty = false;
+
+    // level of detail each mesh was last drawn at, by Submit instance
+    std::unordered_map<u32, std::vector<u32>> mesh_lods;
+
     void LoadModel(std::string path);
-    void ProcessNode(aiNode* node, const aiScene* scene);
-    Mesh ProcessMesh(aiMesh* mesh, const aiScene* scene);
-    std::vector<Texture2D> LoadMaterialTextures(aiMaterial* mat, aiTextureType type, std::string type_name);
-    Texture2D TextureFromFile(const char* path, const std::string& directory);
+    // false if the geometry arena can't hold the model
+    b8 SetupMeshes(const ModelData& data);
+    void SetupNodes(const ModelData& data);
+    // recomputes the world transforms of dirty nodes and their descendants, then the bounds up to the root
+    void UpdateHierarchy();
+    // index_offsets[mesh][lod] is where the indices of that level go in the arena
+    b8 AllocateGeometry(const ModelData& data, std::vector<std::vector<u32>>& index_offsets);
+    // uploads data.meshes[index] and its levels of detail
+    void AddMesh(const ModelData& data, u32 index, const std::vector<u32>& index_offsets,
+                 std::vector<Texture2D> textures);
+    // starts from and updates lod, the level the mesh was last drawn at
+    u32 SelectLod(u32 mesh, const glm::mat4& transform, const LodSelection& selection, u32& lod);
+    std::vector<Texture2D> LoadMaterialTextures(const std::vector<TextureRef>& refs);
+    void LogIndexMemory(const std::string& path) const;
+
+    // world-space mesh bounds and their visibility, reused by every Submit
+    static CullBatch s_CullBatch;
+    static std::vector<u8> s_CullResults;
+    static std::vector<CullCandidate> s_Candidates;
+    static std::vector<glm::mat4> s_Transforms;
+    static std::vector<ObjectConstants> s_Instances;
+
+    static b8 s_LodEnabled;
+    static f32 s_LodThreshold;
+
+    // Fills data from the mesh cache, or imports the file and refreshes the cache. Safe to call off the GL thread.
+    static b8 ReadModelData(const std::string& path, ModelData& data, b8& cached);
 };
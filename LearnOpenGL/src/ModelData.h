@@ -0,0 +1,65 @@
+#pragma once
+
+#include "defines.h"
+
+#include "Bounds.h"
+#include "MappedFile.h"
+#include "Mesh.h"
+
+#include <string>
+#include <vector>
+
+// Material texture reference: uniform type name ("texture_diffuse", ...) and path relative to the model directory.
+struct TextureRef
+{
+    std::string type;
+    std::string path;
+};
+
+// A single mesh as a range into the model's shared vertex/index arrays.
+// Indices are relative to the mesh's first vertex.
+struct MeshData
+{
+    u32 first_vertex;
+    u32 vertex_count;
+    u32 first_index;
+    u32 index_count;
+    BoundingBox box;       // model space
+    BoundingSphere sphere; // model space
+    std::vector<TextureRef> textures;
+    std::vector<MeshLod> lods; // coarser levels after the full mesh, indices relative to first_vertex too
+};
+
+// A node of the model's transform hierarchy. Nodes are stored depth-first, so a node's subtree is the range
+// [index, subtree_end) and every parent comes before its children. The node's meshes are a contiguous range too.
+struct NodeData
+{
+    u32 parent; // NO_PARENT for the root
+    u32 subtree_end;
+    u32 first_mesh;
+    u32 mesh_count;
+    glm::mat4 local; // relative to the parent
+
+    static const u32 NO_PARENT = ~0u;
+};
+
+// CPU-side result of loading a model, either imported through Assimp or read from the mesh cache.
+struct ModelData
+{
+    std::string directory;
+    // files the import read besides the model itself, such as .mtl libraries and glTF buffers
+    std::vector<std::string> source_files;
+    std::vector<MeshData> meshes;
+    std::vector<NodeData> nodes;
+
+    // all meshes' vertices and indices, back to back
+    const Vertex* vertices = nullptr;
+    const u32* indices = nullptr;
+    u64 vertex_count = 0;
+    u64 index_count = 0;
+
+    // backing storage: heap memory after an import, or the mapped cache file
+    std::vector<Vertex> vertex_storage;
+    std::vector<u32> index_storage;
+    MappedFile mapping;
+};
@@ -0,0 +1,271 @@
+#include "ModelImporter.h"
+
+#include "Log.h"
+#include "Timer.h"
+
+#include <assimp/DefaultIOSystem.h>
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+
+// Assimp's file access, noting every file it manages to open so the mesh cache can watch them too
+class RecordingIOSystem : public Assimp::DefaultIOSystem
+{
+public:
+    std::vector<std::string> files;
+
+    Assimp::IOStream* Open(const char* file, const char* mode = "rb") override
+    {
+        Assimp::IOStream* stream = DefaultIOSystem::Open(file, mode);
+        if (stream && std::find(files.begin(), files.end(), file) == files.end())
+            files.push_back(file);
+        return stream;
+    }
+};
+
+} // namespace
+
+b8 ModelImporter::Import(const std::string& path, u32 flags, ModelData& data)
+{
+    LOG_INFO("Assimp: Loading Model: {0}", path.c_str());
+    Assimp::Importer importer;
+    // owned by the importer
+    RecordingIOSystem* io = new RecordingIOSystem();
+    importer.SetIOHandler(io);
+    const aiScene* scene = importer.ReadFile(path, flags);
+
+    if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode) {
+        LOG_ERROR("Assimp: {0}", importer.GetErrorString());
+        return false;
+    }
+
+    // retrieve the directory path of the filepath
+    data.directory = path.substr(0, path.find_last_of('/'));
+
+    data.source_files.clear();
+    for (const std::string& file : io->files) {
+        if (file != path)
+            data.source_files.push_back(file);
+    }
+
+    // process ASSIMP's root node recursively
+    OptimizeStats stats = {};
+    LodStats lod_stats = {};
+    ProcessNode(scene->mRootNode, NodeData::NO_PARENT, scene, data, stats, lod_stats);
+
+    if (stats.before.triangles > 0) {
+        LOG_INFO("MeshOptimizer: ACMR {0:.3f} -> {1:.3f}, ATVR {2:.3f} -> {3:.3f} ({4} triangles, {5:.2f} ms)",
+                 static_cast<f64>(stats.before.transformed) / stats.before.triangles,
+                 static_cast<f64>(stats.after.transformed) / stats.after.triangles,
+                 static_cast<f64>(stats.before.transformed) / stats.before.vertices,
+                 static_cast<f64>(stats.after.transformed) / stats.after.vertices, stats.after.triangles,
+                 stats.milliseconds);
+    }
+
+    if (lod_stats.meshes > 0) {
+        LOG_INFO("MeshSimplifier: {0} levels for {1} meshes, {2} -> {3} triangles at the coarsest ({4:.2f} ms)",
+                 lod_stats.levels, lod_stats.meshes, lod_stats.triangles, lod_stats.coarse_triangles,
+                 lod_stats.milliseconds);
+    }
+
+    data.vertices = data.vertex_storage.data();
+    data.indices = data.index_storage.data();
+    data.vertex_count = data.vertex_storage.size();
+    data.index_count = data.index_storage.size();
+
+    return true;
+}
+
+void ModelImporter::ProcessNode(aiNode* node, u32 parent, const aiScene* scene, ModelData& data,
+                                OptimizeStats& stats, LodStats& lod_stats)
+{
+    u32 index = static_cast<u32>(data.nodes.size());
+    NodeData node_data;
+    node_data.parent = parent;
+    node_data.first_mesh = static_cast<u32>(data.meshes.size());
+    node_data.mesh_count = node->mNumMeshes;
+
+    // Assimp matrices are row major, glm takes columns
+    const aiMatrix4x4& m = node->mTransformation;
+    node_data.local = glm::mat4(glm::vec4(m.a1, m.b1, m.c1, m.d1), glm::vec4(m.a2, m.b2, m.c2, m.d2),
+                                glm::vec4(m.a3, m.b3, m.c3, m.d3), glm::vec4(m.a4, m.b4, m.c4, m.d4));
+    data.nodes.push_back(node_data);
+
+    // process all the node's mashes (if any)
+    for (u32 i = 0; i < node->mNumMeshes; i++) {
+        aiMesh* mesh = scene->mMeshes[node->mMeshes[i]];
+        ProcessMesh(mesh, scene, data, stats, lod_stats);
+    }
+
+    // then do the same for each of its children
+    for (u32 i = 0; i < node->mNumChildren; i++) {
+        ProcessNode(node->mChildren[i], index, scene, data, stats, lod_stats);
+    }
+    data.nodes[index].subtree_end = static_cast<u32>(data.nodes.size());
+}
+
+void ModelImporter::ProcessMesh(aiMesh* mesh, const aiScene* scene, ModelData& data, OptimizeStats& stats,
+                                LodStats& lod_stats)
+{
+    MeshData mesh_data;
+    mesh_data.first_vertex = static_cast<u32>(data.vertex_storage.size());
+    mesh_data.vertex_count = mesh->mNumVertices;
+    mesh_data.first_index = static_cast<u32>(data.index_storage.size());
+
+    data.vertex_storage.reserve(data.vertex_storage.size() + mesh->mNumVertices);
+    for (u32 i = 0; i < mesh->mNumVertices; i++) {
+        Vertex vertex = {};
+
+        // positions
+        vertex.position = glm::vec3(mesh->mVertices[i].x, mesh->mVertices[i].y, mesh->mVertices[i].z);
+
+        // normals
+        if (mesh->HasNormals()) {
+            vertex.normal = glm::vec3(mesh->mNormals[i].x, mesh->mNormals[i].y, mesh->mNormals[i].z);
+        }
+
+        // texture coordinates
+        if (mesh->mTextureCoords[0]) {
+            vertex.tex_coords = glm::vec2(mesh->mTextureCoords[0][i].x, mesh->mTextureCoords[0][i].y);
+            vertex.tangents = glm::vec3(mesh->mTangents[i].x, mesh->mTangents[i].y, mesh->mTangents[i].z);
+            vertex.bitangents = glm::vec3(mesh->mBitangents[i].x, mesh->mBitangents[i].y, mesh->mBitangents[i].z);
+        }
+        else {
+            vertex.tex_coords = glm::vec2(0.0f, 0.0f);
+        }
+
+        data.vertex_storage.push_back(vertex);
+    }
+
+    // process indices
+    for (u32 i = 0; i < mesh->mNumFaces; i++) {
+        const aiFace& face = mesh->mFaces[i];
+        for (u32 j = 0; j < face.mNumIndices; j++) {
+            data.index_storage.push_back(face.mIndices[j]);
+        }
+    }
+    mesh_data.index_count = static_cast<u32>(data.index_storage.size()) - mesh_data.first_index;
+    ComputeBounds(data.vertex_storage.data() + mesh_data.first_vertex, mesh_data.vertex_count, mesh_data);
+
+    // point and line primitives would be scrambled by the triangle reordering
+    if (mesh->mPrimitiveTypes == aiPrimitiveType_TRIANGLE) {
+        OptimizeMesh(mesh_data, data, stats);
+        GenerateLods(mesh_data, data, lod_stats);
+    }
+
+    // process material
+    if (mesh->mMaterialIndex >= 0) {
+        aiMaterial* material = scene->mMaterials[mesh->mMaterialIndex];
+        CollectMaterialTextures(material, aiTextureType_DIFFUSE, "texture_diffuse", mesh_data.textures);
+        CollectMaterialTextures(material, aiTextureType_SPECULAR, "texture_specular", mesh_data.textures);
+        CollectMaterialTextures(material, aiTextureType_HEIGHT, "texture_normal", mesh_data.textures);
+    }
+
+    data.meshes.push_back(std::move(mesh_data));
+}
+
+void ModelImporter::ComputeBounds(const Vertex* vertices, u32 count, MeshData& mesh)
+{
+    if (count == 0) {
+        mesh.box = {glm::vec3(0.0f), glm::vec3(0.0f)};
+        mesh.sphere = {glm::vec3(0.0f), 0.0f};
+        return;
+    }
+
+    glm::vec3 min = vertices[0].position;
+    glm::vec3 max = vertices[0].position;
+    for (u32 i = 1; i < count; i++) {
+        min = glm::min(min, vertices[i].position);
+        max = glm::max(max, vertices[i].position);
+    }
+    mesh.box = BoundingBox::FromMinMax(min, max);
+
+    // around the box center, which is tighter than the box's own circumsphere
+    f32 radius_squared = 0.0f;
+    for (u32 i = 0; i < count; i++) {
+        glm::vec3 offset = vertices[i].position - mesh.box.center;
+        radius_squared = std::max(radius_squared, glm::dot(offset, offset));
+    }
+    mesh.sphere = {mesh.box.center, std::sqrt(radius_squared)};
+}
+
+void ModelImporter::OptimizeMesh(const MeshData& mesh, ModelData& data, OptimizeStats& stats)
+{
+    Timer timer;
+    Vertex* vertices = data.vertex_storage.data() + mesh.first_vertex;
+    u32* indices = data.index_storage.data() + mesh.first_index;
+
+    MeshOptimizer::CacheStats before = MeshOptimizer::AnalyzeVertexCache(indices, mesh.index_count, mesh.vertex_count);
+    MeshOptimizer::Optimize(vertices, mesh.vertex_count, indices, mesh.index_count);
+    MeshOptimizer::CacheStats after = MeshOptimizer::AnalyzeVertexCache(indices, mesh.index_count, mesh.vertex_count);
+
+    stats.before.transformed += before.transformed;
+    stats.before.triangles += before.triangles;
+    stats.before.vertices += before.vertices;
+    stats.after.transformed += after.transformed;
+    stats.after.triangles += after.triangles;
+    stats.after.vertices += after.vertices;
+    stats.milliseconds += timer.ElapsedMillis();
+}
+
+void ModelImporter::GenerateLods(MeshData& mesh, ModelData& data, LodStats& stats)
+{
+    // fractions of the full mesh's triangles
+    const f32 LOD_RATIOS[] = {0.5f, 0.25f, 0.125f};
+    // below this many triangles a mesh costs less to draw than to switch levels for
+    const u32 MIN_LOD_TRIANGLES = 64;
+    // a level that kept more of the previous one than this is not worth its memory, e.g. when seams lock it
+    const f32 MAX_LOD_KEPT = 0.8f;
+
+    if (mesh.index_count < MIN_LOD_TRIANGLES * 2 * 3)
+        return;
+
+    Timer timer;
+    const Vertex* vertices = data.vertex_storage.data() + mesh.first_vertex;
+    std::vector<u32> previous(data.index_storage.begin() + mesh.first_index,
+                              data.index_storage.begin() + mesh.first_index + mesh.index_count);
+    std::vector<u32> lod(mesh.index_count);
+    f32 error_sum = 0.0f;
+
+    for (f32 ratio : LOD_RATIOS) {
+        u32 target = static_cast<u32>(mesh.index_count * ratio) / 3 * 3;
+        if (target < MIN_LOD_TRIANGLES * 3)
+            break;
+
+        f32 error = 0.0f;
+        u32 count = MeshSimplifier::Simplify(lod.data(), previous.data(), static_cast<u32>(previous.size()),
+                                             vertices, mesh.vertex_count, target, error);
+        if (count == 0 || count > previous.size() * MAX_LOD_KEPT)
+            break;
+
+        // the collapses leave triangles in their old order with holes in between
+        MeshOptimizer::OptimizeVertexCache(lod.data(), count, mesh.vertex_count);
+
+        // each level's error is measured against the one before, so the sum bounds it against the full mesh
+        error_sum += error;
+        mesh.lods.push_back({static_cast<u32>(data.index_storage.size()), count, error_sum});
+        data.index_storage.insert(data.index_storage.end(), lod.begin(), lod.begin() + count);
+        previous.assign(lod.begin(), lod.begin() + count);
+    }
+
+    if (!mesh.lods.empty()) {
+        stats.meshes++;
+        stats.levels += static_cast<u32>(mesh.lods.size());
+        stats.triangles += mesh.index_count / 3;
+        stats.coarse_triangles += mesh.lods.back().index_count / 3;
+    }
+    stats.milliseconds += timer.ElapsedMillis();
+}
+
+void ModelImporter::CollectMaterialTextures(aiMaterial* mat, aiTextureType type, const std::string& type_name,
+                                            std::vector<TextureRef>& textures)
+{
+    for (u32 i = 0; i < mat->GetTextureCount(type); i++) {
+        aiString str;
+        mat->GetTexture(type, i, &str);
+        textures.push_back({type_name, str.C_Str()});
+    }
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include "defines.h"
+
+#include "MeshOptimizer.h"
+#include "MeshSimplifier.h"
+#include "ModelData.h"
+
+#include <assimp/Importer.hpp>
+#include <assimp/postprocess.h>
+#include <assimp/scene.h>
+
+#include <string>
+
+const u32 MODEL_IMPORT_FLAGS =
+    aiProcess_Triangulate | aiProcess_FlipUVs | aiProcess_GenSmoothNormals | aiProcess_CalcTangentSpace;
+
+// Imports a model file through Assimp into CPU-side mesh data. Does not touch OpenGL.
+class ModelImporter
+{
+public:
+    static b8 Import(const std::string& path, u32 flags, ModelData& data);
+
+private:
+    // post-transform cache statistics summed over every optimized mesh
+    struct OptimizeStats
+    {
+        MeshOptimizer::CacheStats before;
+        MeshOptimizer::CacheStats after;
+        f64 milliseconds;
+    };
+
+    struct LodStats
+    {
+        u32 meshes; // with at least one coarser level
+        u32 levels;
+        u64 triangles;        // of those meshes
+        u64 coarse_triangles; // of their coarsest levels
+        f64 milliseconds;
+    };
+
+    // appends the node and then its subtree depth-first, meshes in the same order
+    static void ProcessNode(aiNode* node, u32 parent, const aiScene* scene, ModelData& data, OptimizeStats& stats,
+                            LodStats& lod_stats);
+    static void ProcessMesh(aiMesh* mesh, const aiScene* scene, ModelData& data, OptimizeStats& stats,
+                            LodStats& lod_stats);
+    // model-space box and sphere of the mesh's vertices
+    static void ComputeBounds(const Vertex* vertices, u32 count, MeshData& mesh);
+    static void OptimizeMesh(const MeshData& mesh, ModelData& data, OptimizeStats& stats);
+    // appends the mesh's coarser levels to the index storage, each simplified from the one before
+    static void GenerateLods(MeshData& mesh, ModelData& data, LodStats& stats);
+    static void CollectMaterialTextures(aiMaterial* mat, aiTextureType type, const std::string& type_name,
+                                        std::vector<TextureRef>& textures);
+};
@@ -0,0 +1,144 @@
+#include "ModelLoader.h"
+
+#include "Log.h"
+
+ThreadPool* ModelLoader::s_Pool = nullptr;
+std::mutex ModelLoader::s_Mutex;
+std::deque<ModelLoader::Job> ModelLoader::s_CompletedQueue;
+std::deque<ModelLoader::Job> ModelLoader::s_Finalizing;
+u32 ModelLoader::s_Pending = 0;
+
+void ModelLoader::Init(u32 thread_count)
+{
+    s_Pool = new ThreadPool(thread_count);
+    LOG_INFO("ModelLoader: {0} import threads", s_Pool->GetThreadCount());
+}
+
+void ModelLoader::Shutdown()
+{
+    // let running imports finish, then drop everything that was never finalized
+    s_Pool->Wait();
+    delete s_Pool;
+    s_Pool = nullptr;
+
+    s_CompletedQueue.clear();
+    for (Job& job : s_Finalizing)
+        job.model->Destroy();
+    s_Finalizing.clear();
+    s_Pending = 0;
+}
+
+std::shared_ptr<Model> ModelLoader::Load(const std::string& path, VertexFormat format)
+{
+    auto model = std::make_shared<Model>();
+    model->vertex_format = format;
+    Timer timer;
+
+    {
+        std::lock_guard<std::mutex> lock(s_Mutex);
+        s_Pending++;
+    }
+
+    s_Pool->Submit([model, path, timer]() { Import(model, path, timer); });
+    return model;
+}
+
+void ModelLoader::Update(f64 budget_ms)
+{
+    {
+        std::lock_guard<std::mutex> lock(s_Mutex);
+        while (!s_CompletedQueue.empty()) {
+            s_Finalizing.push_back(std::move(s_CompletedQueue.front()));
+            s_CompletedQueue.pop_front();
+        }
+    }
+
+    // always take at least one step so a tight budget still makes progress
+    Timer timer;
+    while (!s_Finalizing.empty()) {
+        if (Step(s_Finalizing.front())) {
+            s_Finalizing.pop_front();
+            std::lock_guard<std::mutex> lock(s_Mutex);
+            s_Pending--;
+        }
+
+        if (timer.ElapsedMillis() >= budget_ms)
+            break;
+    }
+}
+
+u32 ModelLoader::GetPendingCount()
+{
+    std::lock_guard<std::mutex> lock(s_Mutex);
+    return s_Pending;
+}
+
+void ModelLoader::Import(std::shared_ptr<Model> model, const std::string& path, const Timer& timer)
+{
+    Job job;
+    job.model = std::move(model);
+    job.path = path;
+    job.timer = timer;
+    job.cached = false;
+    job.loaded = Model::ReadModelData(path, job.data, job.cached);
+    job.import_ms = timer.ElapsedMillis();
+    job.next_mesh = 0;
+
+    std::lock_guard<std::mutex> lock(s_Mutex);
+    s_CompletedQueue.push_back(std::move(job));
+}
+
+b8 ModelLoader::Step(Job& job)
+{
+    Model& model = *job.model;
+
+    if (!job.loaded) {
+        LOG_ERROR("ModelLoader: Failed to load {0}", job.path);
+        return true;
+    }
+
+    // nobody holds the model anymore, don't spend GL time on it
+    if (job.model.use_count() == 1) {
+        model.Destroy();
+        return true;
+    }
+
+    // request the textures of one mesh per step, so the decode threads get to work before any buffer is created
+    if (job.mesh_textures.size() < job.data.meshes.size()) {
+        if (job.mesh_textures.empty()) {
+            model.directory = job.data.directory;
+            model.meshes.reserve(job.data.meshes.size());
+            job.mesh_textures.reserve(job.data.meshes.size());
+        }
+        job.mesh_textures.push_back(model.LoadMaterialTextures(job.data.meshes[job.mesh_textures.size()].textures));
+        return false;
+    }
+
+    // then reserve the model's blocks in the arena
+    if (!model.arena) {
+        if (!model.AllocateGeometry(job.data, job.index_offsets)) {
+            // the model stays empty and never turns ready; Destroy releases the textures requested above
+            LOG_ERROR("ModelLoader: Failed to allocate the geometry of {0}", job.path);
+            job.mesh_textures.clear();
+            model.Destroy();
+            return true;
+        }
+        return false;
+    }
+
+    // and upload the geometry, one mesh per step
+    if (job.next_mesh < job.data.meshes.size()) {
+        model.AddMesh(job.data, job.next_mesh, job.index_offsets[job.next_mesh], job.mesh_textures[job.next_mesh]);
+        job.next_mesh++;
+        return false;
+    }
+
+    // textures keep streaming in through TextureLoader::Poll, the model can be drawn already
+    model.SetupNodes(job.data);
+    model.ready = true;
+    LOG_INFO("Model: {0} ready in {1:.2f} ms ({2} {3:.2f} ms, {4} meshes finalized over the following frames)",
+             job.path, job.timer.ElapsedMillis(), job.cached ? "cache" : "import", job.import_ms,
+             job.data.meshes.size());
+    model.LogIndexMemory(job.path);
+    return true;
+}
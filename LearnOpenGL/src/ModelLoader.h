@@ -0,0 +1,59 @@
+#pragma once
+
+#include "defines.h"
+
+#include "Model.h"
+#include "ModelData.h"
+#include "ThreadPool.h"
+#include "Timer.h"
+
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Loads models without blocking the render loop.
+// The mesh cache read or Assimp import runs on a pool of worker threads. The GL side (texture requests and one
+// vertex/index buffer per mesh) is finalized a few meshes at a time by Update, at the start of each frame.
+class ModelLoader
+{
+public:
+    // thread_count == 0 uses one import thread per hardware thread
+    static void Init(u32 thread_count = 0);
+    static void Shutdown();
+
+    // Returns right away. The model draws nothing until IsReady() turns true.
+    static std::shared_ptr<Model> Load(const std::string& path, VertexFormat format = VertexFormat::Float);
+
+    // Finalizes loaded models on the GL thread until budget_ms is spent. Call once per frame.
+    static void Update(f64 budget_ms);
+
+    static u32 GetPendingCount();
+
+private:
+    struct Job
+    {
+        std::shared_ptr<Model> model;
+        std::string path;
+        ModelData data;
+        b8 loaded;
+        b8 cached;
+        f64 import_ms;
+        Timer timer; // started at Load
+        std::vector<std::vector<Texture2D>> mesh_textures;
+        std::vector<std::vector<u32>> index_offsets; // per mesh and level of detail
+        u32 next_mesh;
+    };
+
+    static void Import(std::shared_ptr<Model> model, const std::string& path, const Timer& timer);
+
+    // Runs one small piece of GL work for job. Returns true once the job is finished.
+    static b8 Step(Job& job);
+
+    static ThreadPool* s_Pool;
+    static std::mutex s_Mutex;
+    static std::deque<Job> s_CompletedQueue; // guarded by s_Mutex
+    static std::deque<Job> s_Finalizing;     // GL thread only
+    static u32 s_Pending;                    // guarded by s_Mutex
+};
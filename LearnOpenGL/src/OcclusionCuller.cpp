@@ -0,0 +1,282 @@
+#include "OcclusionCuller.h"
+
+#include "GpuProfiler.h"
+#include "Log.h"
+
+// the box is grown a little so it never z-fights with the surfaces it wraps
+static const f32 BOX_MARGIN = 0.01f;
+// boxes this close to the camera would be clipped by the near plane and report nothing visible
+static const f32 NEAR_MARGIN = 0.25f;
+
+// the GpuProfiler scope of each timer phase
+static const char* const PHASE_NAMES[] = {"Pre-pass", "Draws", "Occlusion boxes", "Retested draws"};
+
+std::unordered_map<OcclusionCuller::Key, OcclusionCuller::Entry, OcclusionCuller::KeyHash> OcclusionCuller::s_Entries;
+GpuTimer OcclusionCuller::s_Timers[PhaseCount];
+OcclusionCuller::FrameIndices OcclusionCuller::s_Indices[GpuTimer::FRAMES_IN_FLIGHT] = {};
+OcclusionMode OcclusionCuller::s_Mode = OcclusionMode::Off;
+u32 OcclusionCuller::s_Frame = 0;
+glm::vec3 OcclusionCuller::s_ViewPosition(0.0f);
+OcclusionCuller::Stats OcclusionCuller::s_Stats = {0, 0, 0, 0.0, 0.0, 0.0, 0.0};
+OcclusionCuller::Stats OcclusionCuller::s_Current = {0, 0, 0, 0.0, 0.0, 0.0, 0.0};
+Shader* OcclusionCuller::s_BoxShader = nullptr;
+u32 OcclusionCuller::s_BoxVAO = 0;
+u32 OcclusionCuller::s_BoxVBO = 0;
+u32 OcclusionCuller::s_BoxEBO = 0;
+
+void OcclusionCuller::Init(Shader& box_shader)
+{
+    s_BoxShader = &box_shader;
+
+    // unit cube, scaled to each box in the vertex shader
+    const f32 corners[] = {-1.0f, -1.0f, -1.0f, 1.0f, -1.0f, -1.0f, 1.0f, 1.0f, -1.0f, -1.0f, 1.0f, -1.0f,
+                           -1.0f, -1.0f, 1.0f,  1.0f, -1.0f, 1.0f,  1.0f, 1.0f, 1.0f,  -1.0f, 1.0f, 1.0f};
+    const u8 indices[] = {0, 2, 1, 0, 3, 2, 4, 5, 6, 4, 6, 7, 0, 1, 5, 0, 5, 4,
+                          3, 6, 2, 3, 7, 6, 0, 4, 7, 0, 7, 3, 1, 2, 6, 1, 6, 5};
+
+    glGenVertexArrays(1, &s_BoxVAO);
+    glBindVertexArray(s_BoxVAO);
+
+    glGenBuffers(1, &s_BoxVBO);
+    glBindBuffer(GL_ARRAY_BUFFER, s_BoxVBO);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(corners), corners, GL_STATIC_DRAW);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(f32), (void*)0);
+
+    glGenBuffers(1, &s_BoxEBO);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, s_BoxEBO);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
+
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    for (GpuTimer& timer : s_Timers)
+        timer.Init();
+}
+
+void OcclusionCuller::Shutdown()
+{
+    for (auto& [key, entry] : s_Entries)
+        glDeleteQueries(1, &entry.query);
+    s_Entries.clear();
+
+    for (GpuTimer& timer : s_Timers)
+        timer.Shutdown();
+    for (FrameIndices& indices : s_Indices)
+        indices = {};
+
+    glDeleteVertexArrays(1, &s_BoxVAO);
+    glDeleteBuffers(1, &s_BoxVBO);
+    glDeleteBuffers(1, &s_BoxEBO);
+    s_BoxVAO = 0;
+    s_BoxVBO = 0;
+    s_BoxEBO = 0;
+    s_BoxShader = nullptr;
+}
+
+void OcclusionCuller::SetMode(OcclusionMode mode)
+{
+    s_Mode = mode;
+}
+
+OcclusionMode OcclusionCuller::GetMode()
+{
+    return s_Mode;
+}
+
+void OcclusionCuller::BeginFrame(const glm::vec3& view_position)
+{
+    s_ViewPosition = view_position;
+
+    // the GPU times are only replaced once a newer measurement has arrived
+    s_Current = {0, 0, 0, s_Stats.prepass_ms, s_Stats.draw_ms, s_Stats.query_ms, s_Stats.saved_ms};
+    FrameIndices& indices = s_Indices[s_Frame % GpuTimer::FRAMES_IN_FLIGHT];
+    ReadTimers(indices);
+
+    for (auto it = s_Entries.begin(); it != s_Entries.end();) {
+        Entry& entry = it->second;
+
+        if (entry.pending) {
+            u32 available = 0;
+            glGetQueryObjectuiv(entry.query, GL_QUERY_RESULT_AVAILABLE, &available);
+            if (available) {
+                u32 samples = 0;
+                glGetQueryObjectuiv(entry.query, GL_QUERY_RESULT, &samples);
+                entry.visible = samples != 0;
+                entry.pending = false;
+
+                // the GPU skipped the draw guarded by this query
+                if (entry.conditional && !entry.visible) {
+                    s_Current.culled_draws++;
+                    indices.culled += entry.index_count;
+                }
+            }
+        }
+
+        if (!entry.pending && s_Frame - entry.last_used > UNUSED_FRAMES) {
+            glDeleteQueries(1, &entry.query);
+            it = s_Entries.erase(it);
+            continue;
+        }
+        ++it;
+    }
+}
+
+void OcclusionCuller::EndFrame()
+{
+    s_Stats = s_Current;
+    s_Frame++;
+}
+
+OcclusionCuller::Decision OcclusionCuller::Classify(const Key& key, const BoundingBox& world_box, u32 index_count)
+{
+    Entry& entry = GetEntry(key);
+    entry.last_used = s_Frame;
+    entry.index_count = index_count;
+
+    glm::vec3 offset = glm::abs(s_ViewPosition - world_box.center) - world_box.extent;
+    if (offset.x < NEAR_MARGIN && offset.y < NEAR_MARGIN && offset.z < NEAR_MARGIN) {
+        entry.visible = true;
+        return Decision::Draw;
+    }
+
+    if (!entry.visible) {
+        s_Current.deferred_draws++;
+        return Decision::Test;
+    }
+
+    if (!entry.pending && (s_Frame + entry.retest_offset) % VISIBLE_RETEST_FRAMES == 0)
+        return Decision::DrawAndQuery;
+    return Decision::Draw;
+}
+
+void OcclusionCuller::BeginDrawQuery(const Key& key)
+{
+    Entry& entry = GetEntry(key);
+    BeginQuery(entry);
+    entry.conditional = false;
+}
+
+void OcclusionCuller::EndDrawQuery()
+{
+    glEndQuery(GL_ANY_SAMPLES_PASSED);
+}
+
+void OcclusionCuller::QueryBoxes(const std::vector<Key>& keys, const std::vector<BoundingBox>& boxes)
+{
+    if (keys.empty())
+        return;
+
+    BeginTimer(Boxes);
+    s_BoxShader->Use();
+    Uniform<glm::vec3> center = s_BoxShader->GetUniform<glm::vec3>("boxCenter");
+    Uniform<glm::vec3> extent = s_BoxShader->GetUniform<glm::vec3>("boxExtent");
+
+    glBindVertexArray(s_BoxVAO);
+    glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+    glDepthMask(GL_FALSE);
+
+    for (u32 i = 0; i < keys.size(); i++) {
+        // an older query is still in flight, its result decides the next frame
+        Entry& entry = GetEntry(keys[i]);
+        if (entry.pending)
+            continue;
+
+        s_BoxShader->Set(center, boxes[i].center);
+        s_BoxShader->Set(extent, boxes[i].extent + glm::vec3(BOX_MARGIN));
+        BeginQuery(entry);
+        entry.conditional = s_Mode == OcclusionMode::Conditional;
+        glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_BYTE, (void*)0);
+        glEndQuery(GL_ANY_SAMPLES_PASSED);
+    }
+
+    glDepthMask(GL_TRUE);
+    glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+    glBindVertexArray(0);
+    EndTimer();
+}
+
+void OcclusionCuller::BeginConditional(const Key& key)
+{
+    // NO_WAIT: if the result isn't there yet the GPU draws anyway instead of stalling
+    glBeginConditionalRender(GetEntry(key).query, GL_QUERY_NO_WAIT);
+}
+
+void OcclusionCuller::EndConditional()
+{
+    glEndConditionalRender();
+}
+
+void OcclusionCuller::BeginTimer(TimerPhase phase)
+{
+    GpuProfiler::Begin(PHASE_NAMES[phase]);
+    s_Timers[phase].Begin(s_Frame);
+}
+
+void OcclusionCuller::EndTimer()
+{
+    GpuTimer::End();
+    GpuProfiler::End();
+}
+
+void OcclusionCuller::RecordDrawn(u64 indices)
+{
+    s_Indices[s_Frame % GpuTimer::FRAMES_IN_FLIGHT].drawn += indices;
+}
+
+void OcclusionCuller::RecordSkipped(u64 indices)
+{
+    s_Current.culled_draws++;
+    s_Indices[s_Frame % GpuTimer::FRAMES_IN_FLIGHT].culled += indices;
+}
+
+OcclusionCuller::Stats OcclusionCuller::GetStats()
+{
+    return s_Stats;
+}
+
+OcclusionCuller::Entry& OcclusionCuller::GetEntry(const Key& key)
+{
+    auto it = s_Entries.find(key);
+    if (it != s_Entries.end())
+        return it->second;
+
+    // assumed visible until a query says otherwise
+    Entry entry = {};
+    glGenQueries(1, &entry.query);
+    entry.last_used = s_Frame;
+    entry.retest_offset = static_cast<u32>(s_Entries.size()) % VISIBLE_RETEST_FRAMES;
+    entry.visible = true;
+    return s_Entries.emplace(key, entry).first->second;
+}
+
+void OcclusionCuller::BeginQuery(Entry& entry)
+{
+    glBeginQuery(GL_ANY_SAMPLES_PASSED, entry.query);
+    entry.pending = true;
+    s_Current.queries++;
+}
+
+void OcclusionCuller::ReadTimers(FrameIndices& indices)
+{
+    // issued FRAMES_IN_FLIGHT frames ago; the phases are used together, so if one was dropped they all are
+    b8 available = true;
+    f64 ms[PhaseCount] = {};
+    GpuTimer::Sample draws = GpuTimer::Sample::None;
+    for (u32 phase = 0; phase < PhaseCount; phase++) {
+        GpuTimer::Sample sample = s_Timers[phase].Read(s_Frame, ms[phase]);
+        if (sample == GpuTimer::Sample::Dropped)
+            available = false;
+        if (phase == Draws)
+            draws = sample;
+    }
+
+    if (available && draws == GpuTimer::Sample::Ready) {
+        s_Current.prepass_ms = ms[Prepass];
+        s_Current.draw_ms = ms[Draws] + ms[DeferredDraws];
+        s_Current.query_ms = ms[Boxes];
+        s_Current.saved_ms = indices.drawn > 0 ? s_Current.draw_ms * indices.culled / indices.drawn : 0.0;
+    }
+
+    indices = {};
+}
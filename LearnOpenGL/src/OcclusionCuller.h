@@ -0,0 +1,153 @@
+#pragma once
+
+#include "defines.h"
+
+#include "Bounds.h"
+#include "GpuTimer.h"
+#include "Mesh.h"
+#include "Shader.h"
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <unordered_map>
+#include <vector>
+
+enum class OcclusionMode
+{
+    Off = 0,
+    PreviousFrame, // draws hidden last frame are skipped and only their bounding box is queried
+    Conditional    // draws hidden last frame are queried first and drawn under glBeginConditionalRender
+};
+
+// Hardware occlusion culling for the RenderQueue, with GL_ANY_SAMPLES_PASSED queries per submitted mesh.
+//
+// A query belongs to a mesh and the instance id it was submitted with, so copies of one mesh drawn at different
+// transforms each get their own query and visibility. Callers give every copy a stable instance id.
+//
+// Results are only read once the driver reports them available, so the CPU never waits on the GPU: every decision
+// is based on the latest result that has arrived, usually the previous frame's. Draws that were visible are
+// assumed to stay visible and are requeried only every VISIBLE_RETEST_FRAMES frames, by wrapping the draw itself
+// in the query. Draws that were hidden get a cheap bounding box query every frame, issued after everything else so
+// the visible geometry has filled the depth buffer.
+class OcclusionCuller
+{
+public:
+    enum class Decision
+    {
+        Draw,         // visible, nothing to query
+        DrawAndQuery, // visible, query the draw itself
+        Test          // hidden last time, query the box after the other draws
+    };
+
+    // one submission of a mesh, the mesh and the caller's id for the copy
+    struct Key
+    {
+        const Mesh* mesh;
+        u32 instance;
+
+        bool operator==(const Key& other) const { return mesh == other.mesh && instance == other.instance; }
+    };
+
+    struct Stats
+    {
+        u32 queries;        // issued last frame, draws and boxes
+        u32 culled_draws;   // skipped, or discarded by conditional rendering according to the results
+        u32 deferred_draws; // hidden last frame and tested again
+        f64 prepass_ms;     // GPU time of the RenderQueue's depth pre-pass, 0 without one
+        f64 draw_ms;        // GPU time of the mesh draws
+        f64 query_ms;       // GPU time of the box queries
+        f64 saved_ms;       // estimated from the draw time per index and the culled indices
+    };
+
+    enum TimerPhase
+    {
+        Prepass = 0,   // the depth-only draws before everything else
+        Draws,         // the draws issued unconditionally
+        Boxes,         // the bounding box queries
+        DeferredDraws, // the draws tested again after the boxes
+        PhaseCount
+    };
+
+    static const u32 VISIBLE_RETEST_FRAMES = 8;
+    static const u32 UNUSED_FRAMES = 120; // queries of submissions not drawn for this long are released
+
+    static void Init(Shader& box_shader);
+    static void Shutdown();
+
+    static void SetMode(OcclusionMode mode);
+    static OcclusionMode GetMode();
+
+    // Collects the query results that have arrived, without waiting for the others. Once per frame before Classify.
+    static void BeginFrame(const glm::vec3& view_position);
+    static void EndFrame();
+
+    // index_count is what the draw will issue, at the level of detail it was submitted with
+    static Decision Classify(const Key& key, const BoundingBox& world_box, u32 index_count);
+
+    // around a draw classified as DrawAndQuery
+    static void BeginDrawQuery(const Key& key);
+    static void EndDrawQuery();
+
+    // Draws the box of every key classified as Test with color and depth writes off. Changes the program and VAO.
+    static void QueryBoxes(const std::vector<Key>& keys, const std::vector<BoundingBox>& boxes);
+
+    // around a deferred draw in Conditional mode, skipped by the GPU if its box had no samples pass
+    static void BeginConditional(const Key& key);
+    static void EndConditional();
+
+    // GPU timers, one phase at a time
+    static void BeginTimer(TimerPhase phase);
+    static void EndTimer();
+
+    // indices issued and skipped this frame, for the saved time estimate
+    static void RecordDrawn(u64 indices);
+    static void RecordSkipped(u64 indices);
+
+    static Stats GetStats();
+
+private:
+    struct Entry
+    {
+        u32 query;
+        u32 index_count;
+        u32 last_used;
+        u32 retest_offset; // spreads the visible retests over the interval
+        b8 visible;
+        b8 pending;
+        b8 conditional; // the pending query guards a conditional draw
+    };
+
+    struct KeyHash
+    {
+        size_t operator()(const Key& key) const
+        {
+            return std::hash<const Mesh*>()(key.mesh) ^ (static_cast<size_t>(key.instance) * 0x9E3779B97F4A7C15ull);
+        }
+    };
+
+    // indices issued and skipped in a frame, kept until its timers are read back
+    struct FrameIndices
+    {
+        u64 drawn;
+        u64 culled;
+    };
+
+    static Entry& GetEntry(const Key& key);
+    static void BeginQuery(Entry& entry);
+    static void ReadTimers(FrameIndices& indices);
+
+    static std::unordered_map<Key, Entry, KeyHash> s_Entries;
+    static GpuTimer s_Timers[PhaseCount];
+    static FrameIndices s_Indices[GpuTimer::FRAMES_IN_FLIGHT];
+    static OcclusionMode s_Mode;
+    static u32 s_Frame;
+    static glm::vec3 s_ViewPosition;
+    static Stats s_Stats;
+    static Stats s_Current;
+
+    static Shader* s_BoxShader;
+    static u32 s_BoxVAO;
+    static u32 s_BoxVBO;
+    static u32 s_BoxEBO;
+};
@@ -0,0 +1,177 @@
+#include "ProgramCache.h"
+
+#include "Hash.h"
+#include "Log.h"
+#include "MappedFile.h"
+
+#include <glad/glad.h>
+
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <vector>
+
+namespace
+{
+
+const char* CACHE_DIRECTORY = "cache/shaders";
+
+struct ProgramCacheHeader
+{
+    u32 magic;
+    u32 version;
+    u64 key;
+    u32 binary_format;
+    u32 binary_size;
+};
+
+std::string GetGLString(u32 name)
+{
+    const char* str = reinterpret_cast<const char*>(glGetString(name));
+    return str ? str : "";
+}
+
+} // namespace
+
+ProgramCache::Stats ProgramCache::s_Stats = {0, 0, 0, 0.0, 0.0};
+
+b8 ProgramCache::IsSupported()
+{
+    // core in 4.1, and glad only loads the entry points when the context has them
+    if (!glProgramBinary || !glGetProgramBinary)
+        return false;
+
+    i32 formats = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+    return formats > 0;
+}
+
+u64 ProgramCache::MakeKey(const std::string& vertex_src, const std::string& fragment_src)
+{
+    u64 hash = HashBytes(&VERSION, sizeof(VERSION));
+    hash = HashString(vertex_src, hash);
+    hash = HashString(fragment_src, hash);
+
+    // binaries are only valid for the exact driver that produced them
+    hash = HashString(GetGLString(GL_VENDOR), hash);
+    hash = HashString(GetGLString(GL_RENDERER), hash);
+    hash = HashString(GetGLString(GL_VERSION), hash);
+    return hash;
+}
+
+b8 ProgramCache::Load(u64 key, u32 program)
+{
+    if (!IsSupported())
+        return false;
+
+    std::string cache_path = GetCachePath(key);
+    MappedFile file;
+    if (!file.Open(cache_path))
+        return false;
+
+    ProgramCacheHeader header;
+    if (file.GetSize() < sizeof(header))
+        return false;
+    std::memcpy(&header, file.GetData(), sizeof(header));
+
+    if (header.magic != MAGIC || header.version != VERSION || header.key != key ||
+        sizeof(header) + static_cast<u64>(header.binary_size) > file.GetSize()) {
+        LOG_TRACE("ProgramCache: {0} is from another version or truncated", cache_path);
+        return false;
+    }
+
+    glProgramBinary(program, header.binary_format, file.GetData() + sizeof(header),
+                    static_cast<i32>(header.binary_size));
+
+    i32 success = 0;
+    glGetProgramiv(program, GL_LINK_STATUS, &success);
+    if (!success) {
+        // the driver may refuse binaries for reasons the key can't see, never try this one again
+        LOG_WARN("ProgramCache: Driver rejected {0}, compiling from source", cache_path);
+        s_Stats.rejected++;
+        file.Close();
+        std::error_code ec;
+        std::filesystem::remove(cache_path, ec);
+        return false;
+    }
+
+    return true;
+}
+
+b8 ProgramCache::Store(u64 key, u32 program)
+{
+    if (!IsSupported())
+        return false;
+
+    i32 length = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0)
+        return false;
+
+    std::vector<u8> binary(length);
+    u32 format = 0;
+    glGetProgramBinary(program, length, &length, &format, binary.data());
+
+    ProgramCacheHeader header = {};
+    header.magic = MAGIC;
+    header.version = VERSION;
+    header.key = key;
+    header.binary_format = format;
+    header.binary_size = static_cast<u32>(length);
+
+    std::string cache_path = GetCachePath(key);
+    std::error_code ec;
+    std::filesystem::create_directories(CACHE_DIRECTORY, ec);
+
+    // write to a temporary file first so a crash never leaves a half-written cache behind
+    std::string temp_path = cache_path + ".tmp";
+    std::ofstream out(temp_path, std::ios::binary | std::ios::trunc);
+    if (!out) {
+        LOG_ERROR("ProgramCache: Failed to open {0} for writing", temp_path);
+        return false;
+    }
+
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char*>(binary.data()), header.binary_size);
+    out.close();
+
+    if (!out) {
+        LOG_ERROR("ProgramCache: Failed to write {0}", temp_path);
+        std::filesystem::remove(temp_path, ec);
+        return false;
+    }
+
+    std::filesystem::rename(temp_path, cache_path, ec);
+    if (ec) {
+        LOG_ERROR("ProgramCache: Failed to move {0} into place: {1}", cache_path, ec.message());
+        return false;
+    }
+
+    LOG_TRACE("ProgramCache: Wrote {0} ({1} bytes)", cache_path, header.binary_size);
+    return true;
+}
+
+void ProgramCache::RecordBuild(b8 hit, f64 ms)
+{
+    if (hit) {
+        s_Stats.hits++;
+        s_Stats.hit_ms += ms;
+    }
+    else {
+        s_Stats.misses++;
+        s_Stats.miss_ms += ms;
+    }
+}
+
+ProgramCache::Stats ProgramCache::GetStats()
+{
+    return s_Stats;
+}
+
+std::string ProgramCache::GetCachePath(u64 key)
+{
+    char name[32];
+    std::snprintf(name, sizeof(name), "%016llx", static_cast<unsigned long long>(key));
+    return std::string(CACHE_DIRECTORY) + "/" + name + ".bin";
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include "defines.h"
+
+#include <string>
+
+// On-disk cache of linked shader programs (glGetProgramBinary / glProgramBinary).
+//
+// Entries are keyed by a hash of the final stage sources (defines already inserted) and the driver's vendor,
+// renderer and version strings, so a driver update or an edited shader simply misses. A binary the driver
+// rejects is deleted and the caller compiles from source as usual.
+//
+// Layout: ProgramCacheHeader | binary
+class ProgramCache
+{
+public:
+    static const u32 MAGIC = 0x47525050; // "PPRG"
+    static constexpr u32 VERSION = 1;
+
+    struct Stats
+    {
+        u32 hits;
+        u32 misses;   // includes rejected binaries
+        u32 rejected; // found on disk but refused by the driver
+        f64 hit_ms;   // total time building programs that hit
+        f64 miss_ms;  // total time building programs that were compiled
+    };
+
+    // false if the driver exposes no binary formats, then Load always misses and Store does nothing
+    static b8 IsSupported();
+
+    static u64 MakeKey(const std::string& vertex_src, const std::string& fragment_src);
+
+    // Loads the cached binary into program (a fresh glCreateProgram). False if there is none or it was rejected.
+    static b8 Load(u64 key, u32 program);
+
+    // Writes program's binary; it must have been linked with GL_PROGRAM_BINARY_RETRIEVABLE_HINT set
+    static b8 Store(u64 key, u32 program);
+
+    static void RecordBuild(b8 hit, f64 ms);
+    static Stats GetStats();
+
+    static std::string GetCachePath(u64 key);
+
+private:
+    static Stats s_Stats;
+};
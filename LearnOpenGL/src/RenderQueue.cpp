@@ -0,0 +1,385 @@
+#include "RenderQueue.h"
+
+#include "Hash.h"
+#include "OcclusionCuller.h"
+#include "Timer.h"
+#include "UniformBuffers.h"
+
+#include <algorithm>
+#include <cstring>
+
+std::vector<RenderQueue::Packet> RenderQueue::s_Packets;
+std::vector<RenderQueue::SortEntry> RenderQueue::s_Order;
+std::vector<RenderQueue::SortEntry> RenderQueue::s_Scratch;
+std::unordered_map<u64, u32> RenderQueue::s_Materials;
+std::unordered_map<const Shader*, std::pair<u32, MeshUniforms>> RenderQueue::s_Uniforms;
+std::vector<ObjectConstants> RenderQueue::s_Objects;
+std::vector<u32> RenderQueue::s_ObjectSlots;
+std::vector<OcclusionCuller::Decision> RenderQueue::s_Decisions;
+std::vector<u32> RenderQueue::s_Deferred;
+std::vector<OcclusionCuller::Key> RenderQueue::s_DeferredKeys;
+std::vector<BoundingBox> RenderQueue::s_DeferredBoxes;
+glm::vec3 RenderQueue::s_ViewPosition(0.0f);
+Shader* RenderQueue::s_DepthShaders[2] = {nullptr, nullptr};
+b8 RenderQueue::s_Sorting = true;
+b8 RenderQueue::s_DepthPrepass = false;
+RenderQueue::Stats RenderQueue::s_Stats = {0, 0, 0, 0, 0.0, 0, 0, 0, 0, 0, {0.0, 0.0}};
+
+void RenderQueue::Begin(const glm::vec3& view_position)
+{
+    s_ViewPosition = view_position;
+    s_Packets.clear();
+    s_Stats.meshes_tested = 0;
+    s_Stats.meshes_visible = 0;
+    s_Stats.subtrees_culled = 0;
+}
+
+void RenderQueue::Submit(RenderPass pass, Shader& shader, GeometryArena& arena, const Mesh& mesh,
+                         const glm::mat4& transform, u32 lod, u32 instance)
+{
+    glm::vec3 center = glm::vec3(transform * glm::vec4(mesh.GetBoundingBox().center, 1.0f));
+    f32 depth = glm::length(center - s_ViewPosition);
+
+    u64 key = MakeKey(pass, shader, arena, mesh, depth);
+    s_Packets.push_back({key, &shader, &arena, &mesh, transform, lod, instance});
+}
+
+void RenderQueue::RecordCulling(u32 tested, u32 visible, u32 subtrees_culled)
+{
+    s_Stats.meshes_tested += tested;
+    s_Stats.meshes_visible += visible;
+    s_Stats.subtrees_culled += subtrees_culled;
+}
+
+void RenderQueue::Flush()
+{
+    Timer timer;
+
+    s_Order.resize(s_Packets.size());
+    for (u32 i = 0; i < s_Packets.size(); i++)
+        s_Order[i] = {s_Packets[i].key, i};
+
+    s_Stats.packets = static_cast<u32>(s_Packets.size());
+    s_Stats.triangles = 0;
+    s_Stats.full_triangles = 0;
+    for (const Packet& packet : s_Packets) {
+        s_Stats.triangles += packet.mesh->GetIndexCount(packet.lod) / 3;
+        s_Stats.full_triangles += packet.mesh->GetIndexCount() / 3;
+    }
+    s_Stats.unsorted_state_changes = CountStateChanges(s_Order);
+    if (s_Sorting)
+        RadixSort(s_Order, s_Scratch);
+    s_Stats.state_changes = CountStateChanges(s_Order);
+    s_Stats.texture_binds = 0;
+
+    // one object block per run of equal transforms, all written to the ring before the first draw
+    s_Objects.clear();
+    s_ObjectSlots.resize(s_Order.size());
+    const glm::mat4* transform = nullptr;
+    for (u32 i = 0; i < s_Order.size(); i++) {
+        const glm::mat4& current = s_Packets[s_Order[i].packet].transform;
+        if (!transform || std::memcmp(transform, &current, sizeof(glm::mat4)) != 0) {
+            transform = &current;
+            s_Objects.push_back(UniformBuffers::MakeObject(current));
+        }
+        s_ObjectSlots[i] = static_cast<u32>(s_Objects.size() - 1);
+    }
+    DrawState state;
+    state.first_slot = UniformBuffers::WriteObjects(s_Objects.data(), static_cast<u32>(s_Objects.size()));
+
+    // draws hidden according to the latest occlusion results are held back until the rest has filled the depth buffer
+    OcclusionMode occlusion = OcclusionCuller::GetMode();
+    OcclusionCuller::BeginFrame(s_ViewPosition);
+    s_Deferred.clear();
+    s_DeferredKeys.clear();
+    s_DeferredBoxes.clear();
+    s_Decisions.assign(s_Order.size(), OcclusionCuller::Decision::Draw);
+    if (occlusion != OcclusionMode::Off) {
+        for (u32 i = 0; i < s_Order.size(); i++) {
+            const Packet& packet = s_Packets[s_Order[i].packet];
+            BoundingBox box = packet.mesh->GetBoundingBox().Transform(packet.transform);
+            OcclusionCuller::Key key = {packet.mesh, packet.instance};
+            s_Decisions[i] = OcclusionCuller::Classify(key, box, packet.mesh->GetIndexCount(packet.lod));
+            if (s_Decisions[i] == OcclusionCuller::Decision::Test) {
+                s_Deferred.push_back(i);
+                s_DeferredKeys.push_back(key);
+                s_DeferredBoxes.push_back(box);
+            }
+        }
+    }
+
+    b8 prepass = s_DepthPrepass;
+    for (const Packet& packet : s_Packets)
+        prepass = prepass && s_DepthShaders[static_cast<u32>(packet.arena->GetFormat())];
+
+    if (prepass) {
+        OcclusionCuller::BeginTimer(OcclusionCuller::Prepass);
+        glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+        for (u32 i = 0; i < s_Order.size(); i++) {
+            if (s_Decisions[i] != OcclusionCuller::Decision::Test)
+                IssueDepth(i, state);
+        }
+        glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+        OcclusionCuller::EndTimer();
+
+        // the shading pass binds its own program and VAO, and only touches the fragments that won
+        state.shader = nullptr;
+        state.arena = nullptr;
+        glDepthFunc(GL_EQUAL);
+        glDepthMask(GL_FALSE);
+    }
+
+    u64 drawn_indices = 0;
+    OcclusionCuller::BeginTimer(OcclusionCuller::Draws);
+    for (u32 i = 0; i < s_Order.size(); i++) {
+        const Packet& packet = s_Packets[s_Order[i].packet];
+        OcclusionCuller::Decision decision = s_Decisions[i];
+        if (decision == OcclusionCuller::Decision::Test)
+            continue;
+
+        if (decision == OcclusionCuller::Decision::DrawAndQuery)
+            OcclusionCuller::BeginDrawQuery({packet.mesh, packet.instance});
+        Issue(i, state);
+        if (decision == OcclusionCuller::Decision::DrawAndQuery)
+            OcclusionCuller::EndDrawQuery();
+        drawn_indices += packet.mesh->GetIndexCount(packet.lod);
+    }
+    OcclusionCuller::EndTimer();
+
+    // the deferred draws weren't in the pre-pass, they test and write depth as usual
+    if (prepass) {
+        glDepthFunc(GL_LESS);
+        glDepthMask(GL_TRUE);
+    }
+
+    if (!s_Deferred.empty()) {
+        OcclusionCuller::QueryBoxes(s_DeferredKeys, s_DeferredBoxes);
+
+        // the box pass has its own program and VAO
+        state.shader = nullptr;
+        state.arena = nullptr;
+
+        if (occlusion == OcclusionMode::Conditional) {
+            OcclusionCuller::BeginTimer(OcclusionCuller::DeferredDraws);
+            for (u32 entry : s_Deferred) {
+                const Packet& packet = s_Packets[s_Order[entry].packet];
+                OcclusionCuller::BeginConditional({packet.mesh, packet.instance});
+                Issue(entry, state);
+                OcclusionCuller::EndConditional();
+                drawn_indices += packet.mesh->GetIndexCount(packet.lod);
+            }
+            OcclusionCuller::EndTimer();
+        }
+        else {
+            for (u32 entry : s_Deferred) {
+                const Packet& packet = s_Packets[s_Order[entry].packet];
+                OcclusionCuller::RecordSkipped(packet.mesh->GetIndexCount(packet.lod));
+            }
+        }
+    }
+
+    OcclusionCuller::RecordDrawn(drawn_indices);
+    OcclusionCuller::EndFrame();
+
+    // the timers read back are a few frames old, a pre-pass time tells which setting they were measured with
+    OcclusionCuller::Stats gpu = OcclusionCuller::GetStats();
+    if (gpu.draw_ms > 0.0) {
+        f64& average = s_Stats.gpu_ms[gpu.prepass_ms > 0.0 ? 1 : 0];
+        f64 total = gpu.prepass_ms + gpu.draw_ms;
+        UpdateRunningAverage(average, total);
+    }
+
+    if (state.arena)
+        state.arena->Unbind();
+    glActiveTexture(GL_TEXTURE0);
+
+    s_Packets.clear();
+    s_Stats.flush_ms = timer.ElapsedMillis();
+}
+
+void RenderQueue::Issue(u32 entry, DrawState& state)
+{
+    const Packet& packet = s_Packets[s_Order[entry].packet];
+
+    if (packet.shader != state.shader) {
+        state.shader = packet.shader;
+        state.shader->Use();
+        state.uniforms = &GetUniforms(*state.shader);
+    }
+    if (packet.arena != state.arena) {
+        state.arena = packet.arena;
+        state.arena->Bind();
+    }
+    BindObject(entry, state);
+    if (packet.mesh->GetMaterialId() != state.material) {
+        state.material = packet.mesh->GetMaterialId();
+        packet.mesh->BindMaterial();
+        s_Stats.texture_binds += static_cast<u32>(packet.mesh->textures.size());
+    }
+
+    packet.mesh->DrawGeometry(*state.shader, *state.uniforms, packet.lod);
+}
+
+void RenderQueue::IssueDepth(u32 entry, DrawState& state)
+{
+    const Packet& packet = s_Packets[s_Order[entry].packet];
+
+    Shader* shader = s_DepthShaders[static_cast<u32>(packet.arena->GetFormat())];
+    if (shader != state.shader) {
+        state.shader = shader;
+        state.shader->Use();
+        state.uniforms = &GetUniforms(*state.shader);
+    }
+    if (packet.arena != state.arena) {
+        state.arena = packet.arena;
+        state.arena->BindPositions();
+    }
+    BindObject(entry, state);
+
+    packet.mesh->DrawGeometry(*state.shader, *state.uniforms, packet.lod);
+}
+
+void RenderQueue::BindObject(u32 entry, DrawState& state)
+{
+    if (s_ObjectSlots[entry] != state.object) {
+        state.object = s_ObjectSlots[entry];
+        UniformBuffers::BindObject(state.first_slot + state.object);
+    }
+}
+
+const MeshUniforms& RenderQueue::GetUniforms(Shader& shader)
+{
+    u32 revision = shader.GetRevision();
+    auto it = s_Uniforms.find(&shader);
+    if (it == s_Uniforms.end() || it->second.first != revision) {
+        MeshUniforms uniforms = MeshUniforms::Resolve(shader);
+        it = s_Uniforms.insert_or_assign(&shader, std::make_pair(revision, uniforms)).first;
+    }
+    return it->second.second;
+}
+
+u32 RenderQueue::GetMaterialId(const std::vector<Texture2D>& textures)
+{
+    u64 hash = FNV1A_OFFSET_BASIS;
+    for (const Texture2D& texture : textures) {
+        u32 id = texture.GetTexID();
+        hash = HashBytes(&id, sizeof(id), hash);
+        hash = HashString(texture.GetType(), hash);
+    }
+
+    auto it = s_Materials.find(hash);
+    if (it != s_Materials.end())
+        return it->second;
+
+    u32 material_id = static_cast<u32>(s_Materials.size());
+    s_Materials[hash] = material_id;
+    return material_id;
+}
+
+void RenderQueue::SetSorting(b8 enabled)
+{
+    s_Sorting = enabled;
+}
+
+b8 RenderQueue::IsSorting()
+{
+    return s_Sorting;
+}
+
+void RenderQueue::SetDepthShader(VertexFormat format, Shader& shader)
+{
+    s_DepthShaders[static_cast<u32>(format)] = &shader;
+}
+
+void RenderQueue::SetDepthPrepass(b8 enabled)
+{
+    s_DepthPrepass = enabled;
+}
+
+b8 RenderQueue::IsDepthPrepass()
+{
+    return s_DepthPrepass;
+}
+
+RenderQueue::Stats RenderQueue::GetStats()
+{
+    return s_Stats;
+}
+
+u64 RenderQueue::MakeKey(RenderPass pass, const Shader& shader, const GeometryArena& arena, const Mesh& mesh,
+                         f32 depth)
+{
+    // positive floats order like their bit patterns, so the top bits make a monotonic depth key
+    u32 depth_bits;
+    std::memcpy(&depth_bits, &depth, sizeof(depth_bits));
+    depth_bits = (depth_bits >> 7) & 0xffffff;
+
+    u64 key = 0;
+    key |= static_cast<u64>(static_cast<u32>(pass) & 0xf) << 60;
+    key |= static_cast<u64>(shader.id & 0xff) << 52;
+    key |= static_cast<u64>(arena.GetId() & 0xf) << 48;
+    key |= static_cast<u64>(mesh.GetMaterialId() & 0xffffff) << 24;
+    key |= depth_bits;
+    return key;
+}
+
+void RenderQueue::RadixSort(std::vector<SortEntry>& entries, std::vector<SortEntry>& scratch)
+{
+    const u32 DIGIT_BITS = 8;
+    const u32 BUCKETS = 1 << DIGIT_BITS;
+
+    if (entries.size() < 2)
+        return;
+    scratch.resize(entries.size());
+
+    // digits where every key agrees don't move anything
+    u64 differing = 0;
+    for (const SortEntry& entry : entries)
+        differing |= entry.key ^ entries[0].key;
+
+    std::vector<u32> offsets(BUCKETS);
+    for (u32 shift = 0; shift < 64; shift += DIGIT_BITS) {
+        if (((differing >> shift) & (BUCKETS - 1)) == 0)
+            continue;
+
+        std::fill(offsets.begin(), offsets.end(), 0);
+        for (const SortEntry& entry : entries)
+            offsets[(entry.key >> shift) & (BUCKETS - 1)]++;
+
+        u32 sum = 0;
+        for (u32& offset : offsets) {
+            u32 count = offset;
+            offset = sum;
+            sum += count;
+        }
+
+        for (const SortEntry& entry : entries)
+            scratch[offsets[(entry.key >> shift) & (BUCKETS - 1)]++] = entry;
+        entries.swap(scratch);
+    }
+}
+
+u32 RenderQueue::CountStateChanges(const std::vector<SortEntry>& order)
+{
+    u32 changes = 0;
+    const Packet* previous = nullptr;
+    for (const SortEntry& entry : order) {
+        const Packet& packet = s_Packets[entry.packet];
+        if (!previous) {
+            changes += 4;
+            previous = &packet;
+            continue;
+        }
+        // the object block binding and texture units don't depend on the program
+        if (packet.shader != previous->shader)
+            changes++;
+        if (packet.arena != previous->arena)
+            changes++;
+        if (packet.mesh->GetMaterialId() != previous->mesh->GetMaterialId())
+            changes++;
+        if (std::memcmp(&packet.transform, &previous->transform, sizeof(glm::mat4)) != 0)
+            changes++;
+        previous = &packet;
+    }
+    return changes;
+}
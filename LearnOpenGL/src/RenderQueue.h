@@ -0,0 +1,137 @@
+#pragma once
+
+#include "defines.h"
+
+#include "GeometryArena.h"
+#include "Mesh.h"
+#include "OcclusionCuller.h"
+#include "Shader.h"
+#include "Texture2D.h"
+#include "UniformBuffers.h"
+
+#include <glm/glm.hpp>
+
+#include <unordered_map>
+#include <vector>
+
+enum class RenderPass
+{
+    Opaque = 0
+};
+
+// Collects the frame's draws as packets and issues them sorted by a 64-bit key, so consecutive draws share as
+// much state as possible. With occlusion culling on, draws the OcclusionCuller saw hidden are issued last, after
+// their bounding box queries. With the depth pre-pass on, the other draws first lay down depth from the arenas'
+// position streams and are then shaded with GL_EQUAL, so every pixel runs the fragment shader once.
+// Key layout, most significant first:
+//   pass (4) | shader (8) | arena (4, GeometryArena::GetId) | material (24) | depth (24, front to back)
+class RenderQueue
+{
+public:
+    struct Stats
+    {
+        u32 packets;
+        u32 state_changes;          // as issued
+        u32 unsorted_state_changes; // had the packets been issued in submission order
+        u32 texture_binds;
+        f64 flush_ms; // CPU time of the last Flush, sorting and issuing the draws
+        u32 meshes_tested; // by frustum culling since Begin
+        u32 meshes_visible;
+        u32 subtrees_culled; // node subtrees rejected without testing their meshes
+        u64 triangles;       // submitted, at the levels of detail picked for them
+        u64 full_triangles;  // the same draws at full detail
+        f64 gpu_ms[2];       // running average of the pre-pass and draws, without [0] and with [1] the pre-pass
+    };
+
+    // Starts a frame. Depth keys are measured from view_position.
+    static void Begin(const glm::vec3& view_position);
+
+    // lod is the mesh's level of detail to draw, see Mesh::GetLodCount. instance tells apart copies of the same
+    // mesh for occlusion culling and must stay the same for a copy from frame to frame.
+    static void Submit(RenderPass pass, Shader& shader, GeometryArena& arena, const Mesh& mesh,
+                       const glm::mat4& transform, u32 lod = 0, u32 instance = 0);
+
+    // counts meshes tested against the frustum before submission, for the stats
+    static void RecordCulling(u32 tested, u32 visible, u32 subtrees_culled);
+
+    // Sorts and draws everything submitted since Begin
+    static void Flush();
+
+    // Small, stable id for a set of textures, shared by every mesh using the same set
+    static u32 GetMaterialId(const std::vector<Texture2D>& textures);
+
+    static void SetSorting(b8 enabled);
+    static b8 IsSorting();
+
+    // shader is the depth-only program for packets from arenas of format. Formats without one skip the pre-pass.
+    static void SetDepthShader(VertexFormat format, Shader& shader);
+    static void SetDepthPrepass(b8 enabled);
+    static b8 IsDepthPrepass();
+
+    static Stats GetStats();
+
+private:
+    struct Packet
+    {
+        u64 key;
+        Shader* shader;
+        GeometryArena* arena;
+        const Mesh* mesh;
+        glm::mat4 transform;
+        u32 lod;
+        u32 instance;
+    };
+
+    struct SortEntry
+    {
+        u64 key;
+        u32 packet;
+    };
+
+    // the state bound by the last issued draw
+    struct DrawState
+    {
+        Shader* shader = nullptr;
+        const MeshUniforms* uniforms = nullptr;
+        GeometryArena* arena = nullptr;
+        u32 object = ~0u;
+        u32 material = ~0u;
+        u32 first_slot = 0; // of this frame's object blocks
+    };
+
+    // binds whatever differs from state and draws the entry of s_Order
+    static void Issue(u32 entry, DrawState& state);
+    // the same with the depth-only shader and the position stream
+    static void IssueDepth(u32 entry, DrawState& state);
+    // binds the uniform block of entry if it isn't already
+    static void BindObject(u32 entry, DrawState& state);
+
+    // the packed-vertex uniforms of shader, resolved again whenever the shader was rebuilt
+    static const MeshUniforms& GetUniforms(Shader& shader);
+
+    static u64 MakeKey(RenderPass pass, const Shader& shader, const GeometryArena& arena, const Mesh& mesh,
+                       f32 depth);
+
+    // LSD radix sort on 8-bit digits, skipping digits every key shares
+    static void RadixSort(std::vector<SortEntry>& entries, std::vector<SortEntry>& scratch);
+
+    // number of shader, arena, material and object block switches when drawing packets in the given order
+    static u32 CountStateChanges(const std::vector<SortEntry>& order);
+
+    static std::vector<Packet> s_Packets;
+    static std::vector<SortEntry> s_Order;
+    static std::vector<SortEntry> s_Scratch;
+    static std::unordered_map<u64, u32> s_Materials;
+    static std::unordered_map<const Shader*, std::pair<u32, MeshUniforms>> s_Uniforms; // shader revision, handles
+    static std::vector<ObjectConstants> s_Objects;
+    static std::vector<u32> s_ObjectSlots; // per entry of s_Order, index into s_Objects
+    static std::vector<OcclusionCuller::Decision> s_Decisions; // per entry of s_Order
+    static std::vector<u32> s_Deferred;    // entries of s_Order waiting for their occlusion test
+    static std::vector<OcclusionCuller::Key> s_DeferredKeys;
+    static std::vector<BoundingBox> s_DeferredBoxes; // world space
+    static glm::vec3 s_ViewPosition;
+    static Shader* s_DepthShaders[2]; // per VertexFormat
+    static b8 s_Sorting;
+    static b8 s_DepthPrepass;
+    static Stats s_Stats;
+};
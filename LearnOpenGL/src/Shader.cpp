@@ -1,90 +1,169 @@
 #include "Shader.h"
 
 #include "Log.h"
+#include "ProgramCache.h"
+#include "Timer.h"
+#include "UniformBuffers.h"
 
-Shader::Shader(const char* vertex_path, const char* fragment_path)
+#include <algorithm>
+#include <vector>
+
+u32 Shader::s_UnknownUniformLookups = 0;
+
+static void InsertDefines(std::string& src, const std::string& defines)
 {
+    if (defines.empty())
+        return;
+
+    // #version must stay the first statement of the source
+    size_t pos = 0;
+    if (src.compare(0, 8, "#version") == 0) {
+        pos = src.find('\n');
+        pos = pos == std::string::npos ? src.size() : pos + 1;
+    }
+    src.insert(pos, defines);
+}
+
+Shader::Shader(const char* vertex_path, const char* fragment_path, const std::string& defines)
+{
+    Timer timer;
+
     // 1. retrive the vertex/fragment source code from file path
     std::string vertex_src;
     std::string fragment_src;
-    std::ifstream v_shader_file;
-    std::ifstream f_shader_file;
+    ReadSource(vertex_path, defines, vertex_src);
+    ReadSource(fragment_path, defines, fragment_src);
 
-    // ensure ifstream objects can throw exceptrions:
-    v_shader_file.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-    f_shader_file.exceptions(std::ifstream::failbit | std::ifstream::badbit);
+    // 2. take the linked program from the binary cache, or compile and link it and cache the result
+    u64 cache_key = ProgramCache::MakeKey(vertex_src, fragment_src);
+    id = glCreateProgram();
+    b8 cached = ProgramCache::Load(cache_key, id);
+    if (!cached) {
+        // a rejected binary can leave the program in any state, start from a fresh one
+        glDeleteProgram(id);
+        ProgramBuild build = StartBuild(vertex_src, fragment_src);
+        id = build.program;
+        if (FinishBuild(build))
+            ProgramCache::Store(cache_key, id);
+    }
 
-    try {
-        // open files
-        v_shader_file.open(vertex_path);
-        f_shader_file.open(fragment_path);
-        std::stringstream v_shader_stream, f_shader_stream;
+    f64 build_ms = timer.ElapsedMillis();
+    ProgramCache::RecordBuild(cached, build_ms);
+    LOG_TRACE("Shader: {0} + {1} {2} in {3:.2f} ms", vertex_path, fragment_path,
+              cached ? "loaded from cache" : "compiled", build_ms);
+
+    UniformBuffers::BindBlocks(id);
+    ReflectUniforms();
+}
+
+b8 Shader::ReadSource(const char* path, const std::string& defines, std::string& src)
+{
+    std::ifstream shader_file;
 
-        // read file's buffer contents into streams
-        v_shader_stream << v_shader_file.rdbuf();
-        f_shader_stream << f_shader_file.rdbuf();
+    // ensure ifstream objects can throw exceptrions:
+    shader_file.exceptions(std::ifstream::failbit | std::ifstream::badbit);
 
-        // close the file handlers
-        v_shader_file.close();
-        f_shader_file.close();
+    try {
+        // read file's buffer contents into a stream
+        shader_file.open(path);
+        std::stringstream shader_stream;
+        shader_stream << shader_file.rdbuf();
+        shader_file.close();
 
         // convert stream into string
-        vertex_src = v_shader_stream.str();
-        fragment_src = f_shader_stream.str();
+        src = shader_stream.str();
     }
-    catch (const std::ifstream::failure e) {
-        LOG_ERROR("SHADER: File not succesfully read.");
+    catch (const std::ifstream::failure& e) {
+        LOG_ERROR("SHADER: File {0} not succesfully read.", path);
+        return false;
     }
 
+    InsertDefines(src, defines);
+    return true;
+}
+
+void Shader::ReplaceProgram(u32 program)
+{
+    glDeleteProgram(id);
+    id = program;
+    revision++;
+
+    uniforms.clear();
+    unknown_uniforms.clear();
+    UniformBuffers::BindBlocks(id);
+    ReflectUniforms();
+}
+
+u32 Shader::GetRevision() const
+{
+    return revision;
+}
+
+Shader::ProgramBuild Shader::StartBuild(const std::string& vertex_src, const std::string& fragment_src)
+{
     const char* v_shader_src = vertex_src.c_str();
     const char* f_shader_src = fragment_src.c_str();
 
-    // 2. compile shaders
-    u32 vertex, fragment;
-    i32 success;
-    char info_log[512];
+    // compile shaders
+    // nothing is queried here, so a driver that compiles in the background isn't forced to finish
+    ProgramBuild build;
 
     // vertex shader
-    vertex = glCreateShader(GL_VERTEX_SHADER);
-    glShaderSource(vertex, 1, &v_shader_src, NULL);
-    glCompileShader(vertex);
-
-    // print compile errors if any
-    glGetShaderiv(vertex, GL_COMPILE_STATUS, &success);
-    if (!success) {
-        glGetShaderInfoLog(vertex, 512, NULL, info_log);
-        LOG_ERROR("Shader: Vertex Shader Compilation Failed.");
-        // std::cout << "ERROR::SHADER::VERTEX::COMPILATION_FAILED\n" << info_log << std::endl;
-    }
+    build.vertex = glCreateShader(GL_VERTEX_SHADER);
+    glShaderSource(build.vertex, 1, &v_shader_src, NULL);
+    glCompileShader(build.vertex);
 
     // fragment shader
-    fragment = glCreateShader(GL_FRAGMENT_SHADER);
-    glShaderSource(fragment, 1, &f_shader_src, NULL);
-    glCompileShader(fragment);
+    build.fragment = glCreateShader(GL_FRAGMENT_SHADER);
+    glShaderSource(build.fragment, 1, &f_shader_src, NULL);
+    glCompileShader(build.fragment);
 
-    // print compile errors if any
-    glGetShaderiv(fragment, GL_COMPILE_STATUS, &success);
-    if (!success) {
-        glGetShaderInfoLog(fragment, 512, NULL, info_log);
-        LOG_ERROR("Shader: Fragment Shader Compilation Failed.");
-        // std::cout << "ERROR::SHADER::FRAGMENT::COMPILATION_FAILED\n" << info_log << std::endl;
-    }
+    build.program = glCreateProgram();
 
-    id = glCreateProgram();
-    glAttachShader(id, vertex);
-    glAttachShader(id, fragment);
-    glLinkProgram(id);
+    // the binary is only retrievable for ProgramCache if asked for before linking
+    if (ProgramCache::IsSupported())
+        glProgramParameteri(build.program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+
+    glAttachShader(build.program, build.vertex);
+    glAttachShader(build.program, build.fragment);
+    glLinkProgram(build.program);
+    return build;
+}
+
+b8 Shader::FinishBuild(ProgramBuild& build)
+{
+    i32 success;
+    char info_log[512];
 
     // check for shader linking errors
-    glGetProgramiv(id, GL_LINK_STATUS, &success);
+    glGetProgramiv(build.program, GL_LINK_STATUS, &success);
     if (!success) {
-        glGetProgramInfoLog(id, 512, NULL, info_log);
-        LOG_ERROR("Shader: Program Linkinkg Failed.");
-        // std::cout << "ERROR::SHADER::PROGRAM::LINKING_FAILED\n" << info_log << std::endl;
+        // print compile errors if any
+        i32 compiled;
+        glGetShaderiv(build.vertex, GL_COMPILE_STATUS, &compiled);
+        if (!compiled) {
+            glGetShaderInfoLog(build.vertex, 512, NULL, info_log);
+            LOG_ERROR("Shader: Vertex Shader Compilation Failed.\n{0}", info_log);
+        }
+
+        glGetShaderiv(build.fragment, GL_COMPILE_STATUS, &compiled);
+        if (!compiled) {
+            glGetShaderInfoLog(build.fragment, 512, NULL, info_log);
+            LOG_ERROR("Shader: Fragment Shader Compilation Failed.\n{0}", info_log);
+        }
+
+        glGetProgramInfoLog(build.program, 512, NULL, info_log);
+        LOG_ERROR("Shader: Program Linkinkg Failed.\n{0}", info_log);
     }
 
-    glDeleteShader(vertex);
-    glDeleteShader(fragment);
+    glDetachShader(build.program, build.vertex);
+    glDetachShader(build.program, build.fragment);
+    glDeleteShader(build.vertex);
+    glDeleteShader(build.fragment);
+    build.vertex = 0;
+    build.fragment = 0;
+
+    return success != 0;
 }
 
 void Shader::Use()
@@ -94,35 +173,123 @@ void Shader::Use()
 
 void Shader::SetBool(const std::string& name, bool value) const
 {
-    glUniform1i(glGetUniformLocation(id, name.c_str()), (int)value);
+    glUniform1i(GetLocation(name), (int)value);
 }
 
 void Shader::SetInt(const std::string& name, int value) const
 {
-    glUniform1i(glGetUniformLocation(id, name.c_str()), value);
+    glUniform1i(GetLocation(name), value);
 }
 
 void Shader::SetFloat(const std::string& name, f32 value) const
 {
-    glUniform1f(glGetUniformLocation(id, name.c_str()), value);
+    glUniform1f(GetLocation(name), value);
 }
 
 void Shader::SetVec3(const std::string& name, const glm::vec3 v) const
 {
-    glUniform3f(glGetUniformLocation(id, name.c_str()), v.x, v.y, v.z);
+    glUniform3f(GetLocation(name), v.x, v.y, v.z);
 }
 
 void Shader::SetVec3(const std::string& name, f32 v0, f32 v1, f32 v2) const
 {
-    glUniform3f(glGetUniformLocation(id, name.c_str()), v0, v1, v2);
+    glUniform3f(GetLocation(name), v0, v1, v2);
 }
 
 void Shader::SetMat4(const std::string& name, glm::mat4 matrix) const
 {
-    glUniformMatrix4fv(glGetUniformLocation(id, name.c_str()), 1, GL_FALSE, glm::value_ptr(matrix));
+    glUniformMatrix4fv(GetLocation(name), 1, GL_FALSE, glm::value_ptr(matrix));
+}
+
+void Shader::Set(Uniform<bool> uniform, bool value) const
+{
+    glUniform1i(uniform.location, (int)value);
+}
+
+void Shader::Set(Uniform<i32> uniform, i32 value) const
+{
+    glUniform1i(uniform.location, value);
+}
+
+void Shader::Set(Uniform<f32> uniform, f32 value) const
+{
+    glUniform1f(uniform.location, value);
+}
+
+void Shader::Set(Uniform<glm::vec3> uniform, const glm::vec3& v) const
+{
+    glUniform3f(uniform.location, v.x, v.y, v.z);
+}
+
+void Shader::Set(Uniform<glm::mat4> uniform, const glm::mat4& matrix) const
+{
+    glUniformMatrix4fv(uniform.location, 1, GL_FALSE, glm::value_ptr(matrix));
+}
+
+b8 Shader::HasUniform(const std::string& name) const
+{
+    return uniforms.find(name) != uniforms.end();
+}
+
+u32 Shader::GetUnknownUniformLookups()
+{
+    return s_UnknownUniformLookups;
 }
 
 void Shader::Destroy()
 {
     glDeleteProgram(id);
 }
+
+void Shader::ReflectUniforms()
+{
+    i32 count = 0;
+    i32 max_length = 0;
+    glGetProgramiv(id, GL_ACTIVE_UNIFORMS, &count);
+    glGetProgramiv(id, GL_ACTIVE_UNIFORM_MAX_LENGTH, &max_length);
+
+    std::vector<char> buffer(std::max(max_length, 1));
+    for (i32 i = 0; i < count; i++) {
+        i32 size = 0;
+        u32 type = 0;
+        glGetActiveUniform(id, static_cast<u32>(i), max_length, nullptr, &size, &type, buffer.data());
+
+        std::string name = buffer.data();
+        i32 location = glGetUniformLocation(id, name.c_str());
+        if (location < 0)
+            continue; // members of uniform blocks have no location
+
+        // arrays are reported as "name[0]", make both "name" and every "name[i]" resolvable
+        b8 is_array = name.size() > 3 && name.compare(name.size() - 3, 3, "[0]") == 0;
+        if (!is_array) {
+            uniforms[name] = {location, type};
+            continue;
+        }
+
+        std::string base = name.substr(0, name.size() - 3);
+        uniforms[base] = {location, type};
+        for (i32 element = 0; element < size; element++) {
+            std::string element_name = base + "[" + std::to_string(element) + "]";
+            uniforms[element_name] = {glGetUniformLocation(id, element_name.c_str()), type};
+        }
+    }
+
+    LOG_TRACE("Shader: Program {0} has {1} active uniforms", id, uniforms.size());
+}
+
+i32 Shader::GetLocation(const std::string& name, u32 type) const
+{
+    auto it = uniforms.find(name);
+    if (it != uniforms.end()) {
+        // samplers are set as ints
+        b8 is_sampler = it->second.type == GL_SAMPLER_2D || it->second.type == GL_SAMPLER_CUBE;
+        if (type != 0 && type != it->second.type && !(type == GL_INT && is_sampler))
+            LOG_WARN("Shader: Uniform '{0}' of program {1} is resolved with a different type", name, id);
+        return it->second.location;
+    }
+
+    s_UnknownUniformLookups++;
+    if (unknown_uniforms.insert(name).second)
+        LOG_WARN("Shader: Program {0} has no active uniform '{1}'", id, name);
+    return -1;
+}
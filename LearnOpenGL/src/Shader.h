@@ -8,22 +8,67 @@
 #include <iostream>
 #include <sstream>
 #include <string>
+#include <unordered_map>
+#include <unordered_set>
 
 #include <glm/glm.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
+// Location of a uniform, resolved once with Shader::GetUniform. T is the type it is set with, so a handle can only
+// be passed to the matching Shader::Set overload. A location of -1 is silently ignored by GL.
+template <typename T>
+struct Uniform
+{
+    i32 location = -1;
+};
+
+// GL type a uniform is declared with for each handle type, checked when the handle is resolved
+template <typename T>
+struct UniformType;
+
+template <>
+struct UniformType<bool>
+{
+    static const u32 value = GL_BOOL;
+};
+
+template <>
+struct UniformType<i32>
+{
+    static const u32 value = GL_INT;
+};
+
+template <>
+struct UniformType<f32>
+{
+    static const u32 value = GL_FLOAT;
+};
+
+template <>
+struct UniformType<glm::vec3>
+{
+    static const u32 value = GL_FLOAT_VEC3;
+};
+
+template <>
+struct UniformType<glm::mat4>
+{
+    static const u32 value = GL_FLOAT_MAT4;
+};
+
 class Shader
 {
 public:
     u32 id;
 
     // constructor reads and builds the shader
-    Shader(const char* vertex_path, const char* fragment_path);
+    // defines (e.g. "#define PACKED_VERTEX\n") are inserted right after the #version line of both stages
+    Shader(const char* vertex_path, const char* fragment_path, const std::string& defines = "");
 
     // use/activate the shader
     void Use();
 
-    // utility uniform functions
+    // utility uniform functions, looked up by name in the table built at link time
     void SetBool(const std::string& name, bool value) const;
     void SetInt(const std::string& name, int value) const;
     void SetFloat(const std::string& name, float value) const;
@@ -31,5 +76,66 @@ public:
     void SetVec3(const std::string& name, float v0, float v1, float v2) const;
     void SetMat4(const std::string& name, glm::mat4 matrix) const;
 
+    // resolves a handle once, for code that sets the same uniform every draw
+    template <typename T>
+    Uniform<T> GetUniform(const std::string& name) const
+    {
+        return {GetLocation(name, UniformType<T>::value)};
+    }
+
+    // setting through a handle does no lookup at all; the shader must be in use
+    void Set(Uniform<bool> uniform, bool value) const;
+    void Set(Uniform<i32> uniform, i32 value) const;
+    void Set(Uniform<f32> uniform, f32 value) const;
+    void Set(Uniform<glm::vec3> uniform, const glm::vec3& v) const;
+    void Set(Uniform<glm::mat4> uniform, const glm::mat4& matrix) const;
+
+    // true if the program has an active uniform of that name; unlike the setters it doesn't warn
+    b8 HasUniform(const std::string& name) const;
+
+    // lookups of names the program doesn't have, over all shaders. Each name is only warned about once.
+    static u32 GetUnknownUniformLookups();
+
+    // a program whose stages have been handed to the driver but not queried yet
+    struct ProgramBuild
+    {
+        u32 program;
+        u32 vertex;
+        u32 fragment;
+    };
+
+    // compiles and links without asking for any status, so drivers may build in the background
+    static ProgramBuild StartBuild(const std::string& vertex_src, const std::string& fragment_src);
+
+    // waits for the build if needed, logs errors and frees the stage objects. True if the program linked.
+    static b8 FinishBuild(ProgramBuild& build);
+
+    // reads a stage source and inserts the defines after its #version line
+    static b8 ReadSource(const char* path, const std::string& defines, std::string& src);
+
+    // Takes over a linked program in place of the current one, which is deleted. Handles resolved before
+    // are stale afterwards; GetRevision tells when to resolve them again.
+    void ReplaceProgram(u32 program);
+    u32 GetRevision() const;
+
     void Destroy();
+
+private:
+    struct UniformInfo
+    {
+        i32 location;
+        u32 type;
+    };
+
+    std::unordered_map<std::string, UniformInfo> uniforms;
+    mutable std::unordered_set<std::string> unknown_uniforms;
+    u32 revision = 0;
+
+    static u32 s_UnknownUniformLookups;
+
+    // fills the uniform table from the linked program
+    void ReflectUniforms();
+
+    // -1 for unknown names; type is checked if not 0
+    i32 GetLocation(const std::string& name, u32 type = 0) const;
 };
@@ -0,0 +1,309 @@
+#include "ShaderManager.h"
+
+#include "Log.h"
+#include "ProgramCache.h"
+
+#include <GLFW/glfw3.h>
+
+#include <cstring>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+// GL_KHR_parallel_shader_compile, glad is generated without extensions
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+typedef void (APIENTRYP PFNMAXSHADERCOMPILERTHREADSKHR)(GLuint count);
+
+std::vector<ShaderManager::Entry> ShaderManager::s_Entries;
+std::vector<ShaderManager::PendingBuild> ShaderManager::s_Pending;
+u32 ShaderManager::s_Reloads = 0;
+b8 ShaderManager::s_ParallelCompile = false;
+i32 ShaderManager::s_WatchFd = -1;
+std::vector<std::pair<i32, std::string>> ShaderManager::s_WatchedDirectories;
+Timer ShaderManager::s_PollTimer;
+
+static std::filesystem::file_time_type GetWriteTime(const std::string& path)
+{
+    std::error_code ec;
+    std::filesystem::file_time_type time = std::filesystem::last_write_time(path, ec);
+    return ec ? std::filesystem::file_time_type() : time;
+}
+
+static b8 IsSameFile(const std::filesystem::path& a, const std::string& b)
+{
+    return a.lexically_normal() == std::filesystem::path(b).lexically_normal();
+}
+
+void ShaderManager::Init()
+{
+    i32 extension_count = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &extension_count);
+    for (i32 i = 0; i < extension_count; i++) {
+        const char* extension = reinterpret_cast<const char*>(glGetStringi(GL_EXTENSIONS, static_cast<u32>(i)));
+        if (extension && (std::strcmp(extension, "GL_KHR_parallel_shader_compile") == 0 ||
+                          std::strcmp(extension, "GL_ARB_parallel_shader_compile") == 0))
+            s_ParallelCompile = true;
+    }
+
+    if (s_ParallelCompile) {
+        // let the driver use as many compiler threads as it likes
+        auto max_threads = reinterpret_cast<PFNMAXSHADERCOMPILERTHREADSKHR>(
+            glfwGetProcAddress("glMaxShaderCompilerThreadsKHR"));
+        if (!max_threads)
+            max_threads = reinterpret_cast<PFNMAXSHADERCOMPILERTHREADSKHR>(
+                glfwGetProcAddress("glMaxShaderCompilerThreadsARB"));
+        if (max_threads)
+            max_threads(0xFFFFFFFF);
+    }
+
+#ifdef __linux__
+    s_WatchFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (s_WatchFd < 0)
+        LOG_WARN("ShaderManager: inotify unavailable, polling shader sources instead");
+#endif
+
+    LOG_INFO("ShaderManager: Parallel shader compile {0}", s_ParallelCompile ? "supported" : "not supported");
+}
+
+void ShaderManager::Shutdown()
+{
+    for (PendingBuild& pending : s_Pending)
+        CancelBuild(pending);
+    s_Pending.clear();
+
+    for (Entry& entry : s_Entries)
+        entry.shader->Destroy();
+    s_Entries.clear();
+
+#ifdef __linux__
+    if (s_WatchFd >= 0)
+        close(s_WatchFd);
+#endif
+    s_WatchFd = -1;
+    s_WatchedDirectories.clear();
+}
+
+Shader& ShaderManager::Load(const std::string& vertex_path, const std::string& fragment_path,
+                            const std::string& defines, BuildCallback on_build)
+{
+    Entry entry;
+    entry.shader = std::make_unique<Shader>(vertex_path.c_str(), fragment_path.c_str(), defines);
+    entry.vertex_path = vertex_path;
+    entry.fragment_path = fragment_path;
+    entry.defines = defines;
+    entry.on_build = on_build;
+    entry.vertex_time = GetWriteTime(vertex_path);
+    entry.fragment_time = GetWriteTime(fragment_path);
+
+    WatchFile(vertex_path);
+    WatchFile(fragment_path);
+
+    if (entry.on_build)
+        entry.on_build(*entry.shader);
+
+    s_Entries.push_back(std::move(entry));
+    return *s_Entries.back().shader;
+}
+
+void ShaderManager::ReloadAll()
+{
+    for (u32 i = 0; i < s_Entries.size(); i++)
+        StartRebuild(i);
+}
+
+void ShaderManager::Update()
+{
+    std::vector<b8> changed(s_Entries.size(), false);
+    if (PollChanges(changed)) {
+        for (u32 i = 0; i < s_Entries.size(); i++) {
+            if (changed[i])
+                StartRebuild(i);
+        }
+    }
+
+    for (size_t i = 0; i < s_Pending.size();) {
+        PendingBuild& pending = s_Pending[i];
+        if (!IsBuildDone(pending)) {
+            i++;
+            continue;
+        }
+
+        Entry& entry = s_Entries[pending.entry];
+        if (Shader::FinishBuild(pending.build)) {
+            ProgramCache::Store(pending.cache_key, pending.build.program);
+            entry.shader->ReplaceProgram(pending.build.program);
+            if (entry.on_build)
+                entry.on_build(*entry.shader);
+            s_Reloads++;
+            LOG_INFO("ShaderManager: Reloaded {0} + {1} after {2:.1f} ms", entry.vertex_path, entry.fragment_path,
+                     pending.timer.ElapsedMillis());
+        }
+        else {
+            glDeleteProgram(pending.build.program);
+            LOG_WARN("ShaderManager: {0} + {1} failed to build, keeping the previous program", entry.vertex_path,
+                     entry.fragment_path);
+        }
+
+        s_Pending.erase(s_Pending.begin() + i);
+    }
+}
+
+u32 ShaderManager::GetPendingCount()
+{
+    return static_cast<u32>(s_Pending.size());
+}
+
+u32 ShaderManager::GetReloadCount()
+{
+    return s_Reloads;
+}
+
+b8 ShaderManager::IsParallelCompileSupported()
+{
+    return s_ParallelCompile;
+}
+
+void ShaderManager::StartRebuild(u32 index)
+{
+    Entry& entry = s_Entries[index];
+
+    // a newer edit supersedes a build still in flight
+    for (size_t i = 0; i < s_Pending.size(); i++) {
+        if (s_Pending[i].entry == index) {
+            CancelBuild(s_Pending[i]);
+            s_Pending.erase(s_Pending.begin() + i);
+            break;
+        }
+    }
+
+    std::string vertex_src;
+    std::string fragment_src;
+    if (!Shader::ReadSource(entry.vertex_path.c_str(), entry.defines, vertex_src) ||
+        !Shader::ReadSource(entry.fragment_path.c_str(), entry.defines, fragment_src))
+        return;
+
+    // an edit back to a version built before is already in the binary cache
+    u64 cache_key = ProgramCache::MakeKey(vertex_src, fragment_src);
+    u32 program = glCreateProgram();
+    if (ProgramCache::Load(cache_key, program)) {
+        entry.shader->ReplaceProgram(program);
+        if (entry.on_build)
+            entry.on_build(*entry.shader);
+        s_Reloads++;
+        LOG_INFO("ShaderManager: Reloaded {0} + {1} from cache", entry.vertex_path, entry.fragment_path);
+        return;
+    }
+    glDeleteProgram(program);
+
+    PendingBuild pending;
+    pending.entry = index;
+    pending.build = Shader::StartBuild(vertex_src, fragment_src);
+    pending.cache_key = cache_key;
+    pending.frames_waited = 0;
+    s_Pending.push_back(pending);
+}
+
+b8 ShaderManager::IsBuildDone(PendingBuild& pending)
+{
+    if (s_ParallelCompile) {
+        i32 done = GL_FALSE;
+        glGetProgramiv(pending.build.program, GL_COMPLETION_STATUS_KHR, &done);
+        return done == GL_TRUE;
+    }
+
+    // without the extension any status query may block, give the driver a few frames first
+    return ++pending.frames_waited > DEFERRED_STATUS_FRAMES;
+}
+
+void ShaderManager::CancelBuild(PendingBuild& pending)
+{
+    glDeleteShader(pending.build.vertex);
+    glDeleteShader(pending.build.fragment);
+    glDeleteProgram(pending.build.program);
+}
+
+b8 ShaderManager::PollChanges(std::vector<b8>& changed)
+{
+    b8 any = false;
+
+#ifdef __linux__
+    if (s_WatchFd >= 0) {
+        alignas(inotify_event) char buffer[4096];
+        for (;;) {
+            ssize_t length = read(s_WatchFd, buffer, sizeof(buffer));
+            if (length <= 0)
+                break;
+
+            for (ssize_t offset = 0; offset < length;) {
+                const inotify_event* event = reinterpret_cast<const inotify_event*>(buffer + offset);
+                offset += sizeof(inotify_event) + event->len;
+                if (event->len == 0)
+                    continue;
+
+                for (const auto& watched : s_WatchedDirectories) {
+                    if (watched.first != event->wd)
+                        continue;
+
+                    std::filesystem::path path = std::filesystem::path(watched.second) / event->name;
+                    for (u32 i = 0; i < s_Entries.size(); i++) {
+                        if (IsSameFile(path, s_Entries[i].vertex_path) ||
+                            IsSameFile(path, s_Entries[i].fragment_path)) {
+                            changed[i] = true;
+                            any = true;
+                        }
+                    }
+                }
+            }
+        }
+        return any;
+    }
+#endif
+
+    // no change notifications, compare modification times every so often
+    if (s_PollTimer.ElapsedMillis() < POLL_INTERVAL_MS)
+        return false;
+    s_PollTimer.Reset();
+
+    for (u32 i = 0; i < s_Entries.size(); i++) {
+        Entry& entry = s_Entries[i];
+        std::filesystem::file_time_type vertex_time = GetWriteTime(entry.vertex_path);
+        std::filesystem::file_time_type fragment_time = GetWriteTime(entry.fragment_path);
+        if (vertex_time != entry.vertex_time || fragment_time != entry.fragment_time) {
+            entry.vertex_time = vertex_time;
+            entry.fragment_time = fragment_time;
+            changed[i] = true;
+            any = true;
+        }
+    }
+    return any;
+}
+
+void ShaderManager::WatchFile(const std::string& path)
+{
+#ifdef __linux__
+    if (s_WatchFd < 0)
+        return;
+
+    // watch the directory, editors often save by writing a new file and renaming it over the old one
+    std::string directory = std::filesystem::path(path).parent_path().string();
+    if (directory.empty())
+        directory = ".";
+    for (const auto& watched : s_WatchedDirectories) {
+        if (watched.second == directory)
+            return;
+    }
+
+    i32 wd = inotify_add_watch(s_WatchFd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+    if (wd < 0) {
+        LOG_WARN("ShaderManager: Failed to watch {0}", directory);
+        return;
+    }
+    s_WatchedDirectories.push_back({wd, directory});
+#else
+    (void)path;
+#endif
+}
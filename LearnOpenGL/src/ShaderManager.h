@@ -0,0 +1,85 @@
+#pragma once
+
+#include "defines.h"
+
+#include "Shader.h"
+#include "Timer.h"
+
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Owns the application's shaders and rebuilds them when their sources change on disk.
+//
+// Shaders are built synchronously once by Load (from ProgramCache when possible). Rebuilds after that never
+// stall the frame: the stages are compiled and linked without querying anything, and the result is only checked
+// once GL_KHR_parallel_shader_compile reports it done or, without the extension, a few frames later. A program
+// that links replaces the old one in place, so every Shader& stays valid; one that fails is dropped and the old
+// program stays in use.
+//
+// Source changes are picked up through inotify on Linux and by polling modification times elsewhere.
+class ShaderManager
+{
+public:
+    // called after the first build and after every swap, e.g. to set sampler units
+    using BuildCallback = std::function<void(Shader&)>;
+
+    static void Init();
+    static void Shutdown();
+
+    static Shader& Load(const std::string& vertex_path, const std::string& fragment_path,
+                        const std::string& defines = "", BuildCallback on_build = nullptr);
+
+    // starts a rebuild of every shader, whether or not its sources changed
+    static void ReloadAll();
+
+    // Starts rebuilds for changed sources and swaps in finished ones. Once per frame on the GL thread.
+    static void Update();
+
+    static u32 GetPendingCount();
+    static u32 GetReloadCount();
+    static b8 IsParallelCompileSupported();
+
+private:
+    // frames to wait before querying a build when the driver can't say whether it's done
+    static const u32 DEFERRED_STATUS_FRAMES = 3;
+    static const u32 POLL_INTERVAL_MS = 250;
+
+    struct Entry
+    {
+        std::unique_ptr<Shader> shader;
+        std::string vertex_path;
+        std::string fragment_path;
+        std::string defines;
+        BuildCallback on_build;
+        std::filesystem::file_time_type vertex_time;
+        std::filesystem::file_time_type fragment_time;
+    };
+
+    struct PendingBuild
+    {
+        u32 entry;
+        Shader::ProgramBuild build;
+        u64 cache_key;
+        u32 frames_waited;
+        Timer timer;
+    };
+
+    static void StartRebuild(u32 entry);
+    static b8 IsBuildDone(PendingBuild& pending);
+    static void CancelBuild(PendingBuild& pending);
+
+    // marks the entries using a changed file, returns true if any
+    static b8 PollChanges(std::vector<b8>& changed);
+    static void WatchFile(const std::string& path);
+
+    static std::vector<Entry> s_Entries;
+    static std::vector<PendingBuild> s_Pending;
+    static u32 s_Reloads;
+    static b8 s_ParallelCompile;
+    static i32 s_WatchFd;
+    static std::vector<std::pair<i32, std::string>> s_WatchedDirectories; // watch descriptor, directory
+    static Timer s_PollTimer;
+};
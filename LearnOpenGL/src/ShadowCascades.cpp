@@ -0,0 +1,274 @@
+#include "ShadowCascades.h"
+
+#include "GpuProfiler.h"
+#include "Log.h"
+#include "Timer.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <cmath>
+
+// share of the logarithmic split scheme in the cascade splits, the rest is uniform
+static const f32 SPLIT_LAMBDA = 0.75f;
+// the light's near and far planes are pushed out this far past the casters
+static const f32 DEPTH_PADDING = 1.0f;
+// windows are sized up to whole steps of this, so small zoom changes leave the caches alone
+static const f32 RADIUS_STEP = 1.0f / 16.0f;
+// slope-scaled and constant depth bias of the casters
+static const f32 SLOPE_BIAS = 2.0f;
+static const f32 CONSTANT_BIAS = 4.0f;
+static const f32 SUN_INTENSITY = 0.5f;
+// the GpuProfiler scope of each cascade
+static const char* const CASCADE_NAMES[ShadowCascades::CASCADE_COUNT] = {"Cascade 0", "Cascade 1", "Cascade 2",
+                                                                          "Cascade 3"};
+
+const f32 ShadowCascades::SHADOW_DISTANCE = 120.0f;
+
+Shader* ShadowCascades::s_CasterShader = nullptr;
+u32 ShadowCascades::s_ShadowMap = 0;
+u32 ShadowCascades::s_StaticCache = 0;
+u32 ShadowCascades::s_Framebuffer = 0;
+u32 ShadowCascades::s_CacheFramebuffer = 0;
+b8 ShadowCascades::s_Enabled = true;
+glm::vec3 ShadowCascades::s_LightDirection = glm::normalize(glm::vec3(0.35f, -1.0f, 0.25f));
+ShadowCascades::Cascade ShadowCascades::s_Cascades[CASCADE_COUNT] = {};
+GpuTimer ShadowCascades::s_StaticTimers[CASCADE_COUNT];
+GpuTimer ShadowCascades::s_DynamicTimers[CASCADE_COUNT];
+u32 ShadowCascades::s_Frame = 0;
+ShadowCascades::Stats ShadowCascades::s_Stats = {};
+
+// one MAP_SIZE layer per cascade; the shadow map compares against a reference depth and filters the results
+static u32 CreateDepthArray(b8 compare)
+{
+    u32 texture;
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, texture);
+    glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_DEPTH_COMPONENT24, ShadowCascades::MAP_SIZE, ShadowCascades::MAP_SIZE,
+                 ShadowCascades::CASCADE_COUNT, 0, GL_DEPTH_COMPONENT, GL_UNSIGNED_INT, nullptr);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, compare ? GL_LINEAR : GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, compare ? GL_LINEAR : GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    if (compare) {
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+    }
+    return texture;
+}
+
+// depth-only framebuffer, its attachment is switched to the cascade being drawn
+static u32 CreateFramebuffer(u32 texture)
+{
+    u32 framebuffer;
+    glGenFramebuffers(1, &framebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, texture, 0, 0);
+    glDrawBuffer(GL_NONE);
+    glReadBuffer(GL_NONE);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+        LOG_ERROR("ShadowCascades: framebuffer incomplete");
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    return framebuffer;
+}
+
+void ShadowCascades::Init(Shader& caster_shader)
+{
+    s_CasterShader = &caster_shader;
+    s_ShadowMap = CreateDepthArray(true);
+    s_StaticCache = CreateDepthArray(false);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+    s_Framebuffer = CreateFramebuffer(s_ShadowMap);
+    s_CacheFramebuffer = CreateFramebuffer(s_StaticCache);
+
+    for (u32 c = 0; c < CASCADE_COUNT; c++) {
+        s_StaticTimers[c].Init();
+        s_DynamicTimers[c].Init();
+    }
+
+    // both arrays, 24-bit depth is stored in 4 bytes
+    f64 megabytes = 2.0 * MAP_SIZE * MAP_SIZE * CASCADE_COUNT * 4 / (1024.0 * 1024.0);
+    LOG_INFO("ShadowCascades: {0} cascades of {1}x{1} over {2} units, {3:.1f} MB with the static caches",
+             CASCADE_COUNT, MAP_SIZE, SHADOW_DISTANCE, megabytes);
+}
+
+void ShadowCascades::Shutdown()
+{
+    for (u32 c = 0; c < CASCADE_COUNT; c++) {
+        s_StaticTimers[c].Shutdown();
+        s_DynamicTimers[c].Shutdown();
+    }
+    glDeleteFramebuffers(1, &s_Framebuffer);
+    glDeleteFramebuffers(1, &s_CacheFramebuffer);
+    glDeleteTextures(1, &s_ShadowMap);
+    glDeleteTextures(1, &s_StaticCache);
+    s_Framebuffer = 0;
+    s_CacheFramebuffer = 0;
+    s_ShadowMap = 0;
+    s_StaticCache = 0;
+    for (Cascade& cascade : s_Cascades)
+        cascade.cached = false;
+    s_CasterShader = nullptr;
+}
+
+void ShadowCascades::SetEnabled(b8 enabled)
+{
+    s_Enabled = enabled;
+}
+
+b8 ShadowCascades::IsEnabled()
+{
+    return s_Enabled;
+}
+
+void ShadowCascades::SetLightDirection(const glm::vec3& direction)
+{
+    s_LightDirection = glm::normalize(direction);
+}
+
+const glm::vec3& ShadowCascades::GetLightDirection()
+{
+    return s_LightDirection;
+}
+
+void ShadowCascades::Update(const glm::mat4& view, f32 fov_y, f32 aspect, f32 near_plane, const BoundingBox& casters)
+{
+    glm::vec3 up = std::abs(s_LightDirection.y) > 0.99f ? glm::vec3(0.0f, 0.0f, 1.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+    glm::mat4 light_view = glm::lookAt(glm::vec3(0.0f), s_LightDirection, up);
+
+    // the light looks down -z, so the casters' depth range is the negated range of their z
+    f32 min_z = INFINITY;
+    f32 max_z = -INFINITY;
+    for (u32 i = 0; i < 8; i++) {
+        glm::vec3 corner = casters.center + casters.extent * glm::vec3(i & 1 ? 1.0f : -1.0f, i & 2 ? 1.0f : -1.0f,
+                                                                       i & 4 ? 1.0f : -1.0f);
+        f32 z = (light_view * glm::vec4(corner, 1.0f)).z;
+        min_z = std::min(min_z, z);
+        max_z = std::max(max_z, z);
+    }
+
+    // the corners of the view frustum at view depth d are k * d off its axis
+    f32 tan_y = std::tan(fov_y * 0.5f);
+    f32 k_squared = tan_y * tan_y * (1.0f + aspect * aspect);
+    glm::mat4 inverse_view = glm::inverse(view);
+
+    f32 split_near = near_plane;
+    for (u32 c = 0; c < CASCADE_COUNT; c++) {
+        f32 t = static_cast<f32>(c + 1) / CASCADE_COUNT;
+        f32 split_far = SPLIT_LAMBDA * near_plane * std::pow(SHADOW_DISTANCE / near_plane, t) +
+                        (1.0f - SPLIT_LAMBDA) * (near_plane + (SHADOW_DISTANCE - near_plane) * t);
+
+        // Bounding sphere of the slice, centered on the view axis where its near and far corners are equally far.
+        // It only depends on the projection, so the window keeps its size while the camera moves and turns.
+        f32 center = std::min(0.5f * (split_near + split_far) * (1.0f + k_squared), split_far);
+        f32 radius = std::sqrt((split_far - center) * (split_far - center) + k_squared * split_far * split_far);
+        radius = std::ceil(radius / RADIUS_STEP) * RADIUS_STEP;
+
+        // The center moves in steps of SNAP_TEXELS texels, so the window always lands on the same texel grid. The
+        // window is grown by half a step on each side, so the sphere stays inside it between steps.
+        f32 half_size = radius * MAP_SIZE / (MAP_SIZE - SNAP_TEXELS);
+        f32 texel_size = 2.0f * half_size / MAP_SIZE;
+        f32 step = SNAP_TEXELS * texel_size;
+        glm::vec4 light_center = light_view * (inverse_view * glm::vec4(0.0f, 0.0f, -center, 1.0f));
+        f32 x = std::round(light_center.x / step) * step;
+        f32 y = std::round(light_center.y / step) * step;
+
+        glm::mat4 projection = glm::ortho(x - half_size, x + half_size, y - half_size, y + half_size,
+                                          -max_z - DEPTH_PADDING, -min_z + DEPTH_PADDING);
+        s_Cascades[c].light_view_projection = projection * light_view;
+        s_Stats.cascades[c].far_depth = split_far;
+        s_Stats.cascades[c].texel_size = texel_size;
+        split_near = split_far;
+    }
+}
+
+void ShadowCascades::Render(const DrawCallback& draw_static, const DrawCallback& draw_dynamic)
+{
+    if (!s_Enabled)
+        return;
+
+    GpuProfiler::Scope scope("Shadows");
+    // the slot written FRAMES_IN_FLIGHT frames ago, normally long done; if not its samples are dropped
+    s_Frame++;
+    ReadTimers();
+    s_Stats.frames++;
+
+    glViewport(0, 0, MAP_SIZE, MAP_SIZE);
+    glEnable(GL_POLYGON_OFFSET_FILL);
+    glPolygonOffset(SLOPE_BIAS, CONSTANT_BIAS);
+    for (u32 c = 0; c < CASCADE_COUNT; c++) {
+        GpuProfiler::Scope cascade_scope(CASCADE_NAMES[c]);
+        Cascade& cascade = s_Cascades[c];
+        Frustum frustum(cascade.light_view_projection);
+        s_CasterShader->Use();
+        s_CasterShader->SetMat4("lightViewProjection", cascade.light_view_projection);
+
+        if (!cascade.cached || cascade.cached_view_projection != cascade.light_view_projection) {
+            GpuProfiler::Scope static_scope("Static casters");
+            s_StaticTimers[c].Begin(s_Frame);
+            glBindFramebuffer(GL_FRAMEBUFFER, s_CacheFramebuffer);
+            glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, s_StaticCache, 0, c);
+            glClear(GL_DEPTH_BUFFER_BIT);
+            draw_static(*s_CasterShader, frustum);
+            GpuTimer::End();
+
+            cascade.cached_view_projection = cascade.light_view_projection;
+            cascade.cached = true;
+            s_Stats.cascades[c].rerenders++;
+        }
+
+        GpuProfiler::Scope dynamic_scope("Dynamic casters");
+        s_DynamicTimers[c].Begin(s_Frame);
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, s_CacheFramebuffer);
+        glFramebufferTextureLayer(GL_READ_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, s_StaticCache, 0, c);
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, s_Framebuffer);
+        glFramebufferTextureLayer(GL_DRAW_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, s_ShadowMap, 0, c);
+        glBlitFramebuffer(0, 0, MAP_SIZE, MAP_SIZE, 0, 0, MAP_SIZE, MAP_SIZE, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+        glBindFramebuffer(GL_FRAMEBUFFER, s_Framebuffer);
+        draw_dynamic(*s_CasterShader, frustum);
+        GpuTimer::End();
+    }
+    glDisable(GL_POLYGON_OFFSET_FILL);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void ShadowCascades::ReadTimers()
+{
+    for (u32 c = 0; c < CASCADE_COUNT; c++) {
+        CascadeStats& stats = s_Stats.cascades[c];
+        s_StaticTimers[c].Read(s_Frame, stats.static_ms);
+        f64 ms = 0.0;
+        if (s_DynamicTimers[c].Read(s_Frame, ms) == GpuTimer::Sample::Ready)
+            UpdateRunningAverage(stats.dynamic_ms, ms);
+    }
+}
+
+void ShadowCascades::WriteFrameConstants(FrameConstants& constants)
+{
+    for (u32 c = 0; c < CASCADE_COUNT; c++) {
+        constants.shadow_matrices[c] = s_Cascades[c].light_view_projection;
+        // with shadows off every split is zero, so no fragment falls inside a cascade
+        constants.shadow_splits[c] = s_Enabled ? s_Stats.cascades[c].far_depth : 0.0f;
+        constants.shadow_texels[c] = s_Stats.cascades[c].texel_size;
+    }
+    constants.sun_direction = glm::vec4(-s_LightDirection, SUN_INTENSITY);
+}
+
+void ShadowCascades::Bind()
+{
+    glActiveTexture(GL_TEXTURE0 + TEXTURE_UNIT);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, s_ShadowMap);
+    glActiveTexture(GL_TEXTURE0);
+}
+
+void ShadowCascades::AssignTextureUnits(Shader& shader)
+{
+    shader.Use();
+    if (shader.HasUniform("shadowMap"))
+        shader.SetInt("shadowMap", static_cast<i32>(TEXTURE_UNIT));
+}
+
+ShadowCascades::Stats ShadowCascades::GetStats()
+{
+    return s_Stats;
+}
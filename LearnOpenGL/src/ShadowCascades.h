@@ -0,0 +1,105 @@
+#pragma once
+
+#include "defines.h"
+
+#include "Bounds.h"
+#include "Frustum.h"
+#include "GpuTimer.h"
+#include "Shader.h"
+#include "UniformBuffers.h"
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <functional>
+
+// Cascaded shadow maps for the sun, a directional light.
+//
+// The first SHADOW_DISTANCE of the view is split into CASCADE_COUNT depth ranges, each covered by one layer of a
+// depth texture array. A cascade's window is square around the bounding sphere of its slice of the view frustum, so
+// its size doesn't change as the camera turns, and its center is snapped to steps of SNAP_TEXELS texels in light
+// space, so shadow edges don't shimmer as the camera moves. Its depth range spans all shadow casters.
+//
+// Static casters are drawn into a cache layer per cascade that is only redrawn when the cascade's light matrix
+// changes: the sun turns, the camera crosses a snap step, or the casters' bounds change. Every frame each layer is
+// copied from its cache and the dynamic casters are drawn over it. GL thread only.
+class ShadowCascades
+{
+public:
+    static constexpr u32 CASCADE_COUNT = 4;
+    static constexpr u32 MAP_SIZE = 1024;
+    static const u32 TEXTURE_UNIT = 15; // after LightManager's
+    static const f32 SHADOW_DISTANCE;
+
+    struct CascadeStats
+    {
+        u32 rerenders;   // of the static cache since Init
+        f64 static_ms;   // GPU time of the latest re-render
+        f64 dynamic_ms;  // GPU time of copying the cache and drawing the dynamic casters, averaged
+        f32 far_depth;   // view depth the cascade reaches to
+        f32 texel_size;  // world units per shadow map texel
+    };
+
+    struct Stats
+    {
+        CascadeStats cascades[CASCADE_COUNT];
+        u32 frames; // rendered since Init
+    };
+
+    // Draws casters with the depth-only caster shader, which Render has bound and pointed at the cascade
+    using DrawCallback = std::function<void(Shader& caster_shader, const Frustum& frustum)>;
+
+    // caster_shader is depth_only_vs/fs.glsl built with SHADOW_CASTER for the models' vertex format
+    static void Init(Shader& caster_shader);
+    static void Shutdown();
+
+    static void SetEnabled(b8 enabled);
+    static b8 IsEnabled();
+
+    // direction the sunlight travels in, world space
+    static void SetLightDirection(const glm::vec3& direction);
+    static const glm::vec3& GetLightDirection();
+
+    // Fits the cascades to the view, a perspective projection with the given vertical field of view, aspect and
+    // near plane. casters are the world-space bounds of every shadow caster.
+    static void Update(const glm::mat4& view, f32 fov_y, f32 aspect, f32 near_plane, const BoundingBox& casters);
+
+    // Redraws the static caches that went stale and composites the dynamic casters over them. Needs the frame's
+    // UniformBuffers segment; leaves the default framebuffer bound and the viewport at MAP_SIZE.
+    static void Render(const DrawCallback& draw_static, const DrawCallback& draw_dynamic);
+
+    // cascade matrices, splits and the sun for the shaders' Frame block
+    static void WriteFrameConstants(FrameConstants& constants);
+
+    static void Bind();
+    // points the shader's shadowMap sampler at TEXTURE_UNIT
+    static void AssignTextureUnits(Shader& shader);
+
+    static Stats GetStats();
+
+private:
+    static const u32 SNAP_TEXELS = 64;
+
+    struct Cascade
+    {
+        glm::mat4 light_view_projection;
+        glm::mat4 cached_view_projection; // the static cache was drawn with this one
+        b8 cached;
+    };
+
+    // folds the results of the frame whose timers are about to be reused into the stats
+    static void ReadTimers();
+
+    static Shader* s_CasterShader;
+    static u32 s_ShadowMap;   // depth array, one layer per cascade, sampled with depth comparison
+    static u32 s_StaticCache; // the static casters alone
+    static u32 s_Framebuffer;
+    static u32 s_CacheFramebuffer;
+    static b8 s_Enabled;
+    static glm::vec3 s_LightDirection;
+    static Cascade s_Cascades[CASCADE_COUNT];
+    static GpuTimer s_StaticTimers[CASCADE_COUNT];
+    static GpuTimer s_DynamicTimers[CASCADE_COUNT];
+    static u32 s_Frame;
+    static Stats s_Stats;
+};
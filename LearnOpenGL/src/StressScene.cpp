@@ -0,0 +1,100 @@
+#include "StressScene.h"
+
+#include "Timer.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <cmath>
+
+const f32 StressScene::GRID_SPACING = 3.0f;
+const f32 StressScene::MODEL_SCALE = 2.0f;
+const glm::vec3 StressScene::GRID_ORIGIN(0.0f, 0.0f, -30.0f);
+
+std::vector<glm::mat4> StressScene::s_Transforms;
+StressMode StressScene::s_Mode = StressMode::Off;
+u32 StressScene::s_Count = StressScene::DEFAULT_COUNT;
+u32 StressScene::s_SettleFrames = 0;
+StressScene::Stats StressScene::s_Stats = {0, 0, 0.0, {0.0, 0.0, 0.0}};
+
+void StressScene::SetMode(StressMode mode)
+{
+    if (mode != s_Mode)
+        s_SettleFrames = SETTLE_FRAMES;
+    s_Mode = mode;
+}
+
+StressMode StressScene::GetMode()
+{
+    return s_Mode;
+}
+
+void StressScene::SetCount(u32 count)
+{
+    if (count != s_Count)
+        s_SettleFrames = SETTLE_FRAMES;
+    s_Count = count;
+}
+
+u32 StressScene::GetCount()
+{
+    return s_Count;
+}
+
+void StressScene::Render(Model& model, Shader& shader, Shader& instanced_shader, const Frustum& frustum,
+                         const LodSelection& selection)
+{
+    s_Stats.copies = 0;
+    s_Stats.visible = 0;
+    s_Stats.cpu_ms = 0.0;
+    if (s_Mode == StressMode::Off)
+        return;
+
+    Timer timer;
+    BuildGrid();
+    s_Stats.copies = static_cast<u32>(s_Transforms.size());
+
+    if (s_Mode == StressMode::Loop) {
+        // instance 0 is the model drawn outside the stress scene
+        for (u32 i = 0; i < s_Transforms.size(); i++)
+            model.Submit(shader, s_Transforms[i], frustum, selection, i + 1);
+    }
+    else {
+        s_Stats.visible = model.DrawInstanced(instanced_shader, s_Transforms, frustum);
+    }
+    s_Stats.cpu_ms = timer.ElapsedMillis();
+}
+
+void StressScene::RecordFrame(f64 frame_ms)
+{
+    // frames without the scene run with vsync, they'd only measure the display
+    if (s_Mode == StressMode::Off)
+        return;
+    if (s_SettleFrames > 0) {
+        s_SettleFrames--;
+        return;
+    }
+
+    UpdateRunningAverage(s_Stats.frame_ms[static_cast<u32>(s_Mode)], frame_ms);
+}
+
+StressScene::Stats StressScene::GetStats()
+{
+    return s_Stats;
+}
+
+void StressScene::BuildGrid()
+{
+    if (s_Transforms.size() == s_Count)
+        return;
+
+    // a square grid growing away from the camera's start, centered on x
+    u32 side = static_cast<u32>(std::ceil(std::sqrt(static_cast<f64>(s_Count))));
+    s_Transforms.clear();
+    s_Transforms.reserve(s_Count);
+    for (u32 i = 0; i < s_Count; i++) {
+        f32 x = (static_cast<f32>(i % side) - 0.5f * (side - 1)) * GRID_SPACING;
+        f32 z = -static_cast<f32>(i / side) * GRID_SPACING;
+        glm::mat4 transform = glm::translate(glm::mat4(1.0f), GRID_ORIGIN + glm::vec3(x, 0.0f, z));
+        s_Transforms.push_back(glm::scale(transform, glm::vec3(MODEL_SCALE)));
+    }
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include "defines.h"
+
+#include "Frustum.h"
+#include "Model.h"
+#include "Shader.h"
+
+#include <glm/glm.hpp>
+
+#include <vector>
+
+enum class StressMode
+{
+    Off = 0,
+    Loop,     // one Model::Submit per copy, each mesh its own packet
+    Instanced // one Model::DrawInstanced for every copy
+};
+
+// A grid of copies of one model, to compare drawing them one by one against instancing.
+class StressScene
+{
+public:
+    static const u32 MODE_COUNT = 3;
+    static const u32 DEFAULT_COUNT = 10000;
+
+    struct Stats
+    {
+        u32 copies;
+        u32 visible;              // drawn by the last instanced draw
+        f64 cpu_ms;               // spent in Render
+        f64 frame_ms[MODE_COUNT]; // running average of the whole frame, per mode, 0 for Off
+    };
+
+    static void SetMode(StressMode mode);
+    static StressMode GetMode();
+    static void SetCount(u32 count);
+    static u32 GetCount();
+
+    // Queues or draws the copies, between RenderQueue::Begin and Flush. instanced_shader is the model's shader
+    // built with INSTANCED.
+    static void Render(Model& model, Shader& shader, Shader& instanced_shader, const Frustum& frustum,
+                       const LodSelection& selection);
+
+    // Time of the last whole frame, attributed to the current mode. The caller turns vsync off while the scene is
+    // active, since waiting for the display would hide the difference between the modes; the first SETTLE_FRAMES
+    // after a mode or count change are left out while the swap interval and the grid catch up.
+    static void RecordFrame(f64 frame_ms);
+
+    static Stats GetStats();
+
+private:
+    static const u32 SETTLE_FRAMES = 3;
+    static const f32 GRID_SPACING;
+    static const f32 MODEL_SCALE;
+    static const glm::vec3 GRID_ORIGIN;
+
+    // rebuilds the copy transforms when the count changed
+    static void BuildGrid();
+
+    static std::vector<glm::mat4> s_Transforms;
+    static StressMode s_Mode;
+    static u32 s_Count;
+    static u32 s_SettleFrames; // still to skip in RecordFrame
+    static Stats s_Stats;
+};
@@ -1,5 +1,6 @@
 #include "Texture2D.h"
 
+#include "CompressedTexture.h"
 #include "Log.h"
 
 #include <iostream>
@@ -39,6 +40,69 @@ void Texture2D::Generate(u32 width, u32 height, const void* data, b8 mipmap)
     glBindTexture(GL_TEXTURE_2D, 0);
 }
 
+void Texture2D::BeginStreaming(u32 width, u32 height, u32 level_count)
+{
+    m_Width = width;
+    m_Height = height;
+    m_FilterMin = level_count > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR;
+
+    glBindTexture(GL_TEXTURE_2D, m_TextureID);
+
+    // nothing is resident yet, the first uploaded level lowers the base level
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, level_count - 1);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, level_count - 1);
+    if (level_count > 1)
+        glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAX_ANISOTROPY, 16.0f);
+
+    // set the texture wrapping parameters
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, m_WrapS);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, m_WrapT);
+
+    // set the texture filtering parameters
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, m_FilterMin);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, m_FilterMag);
+
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+void Texture2D::AllocateLevel(u32 level)
+{
+    u32 width = m_Width >> level > 0 ? m_Width >> level : 1;
+    u32 height = m_Height >> level > 0 ? m_Height >> level : 1;
+
+    glBindTexture(GL_TEXTURE_2D, m_TextureID);
+    u32 block_size = CompressedTexture::GetBlockSize(m_InternalFormat);
+    if (block_size > 0) {
+        u32 size = ((width + 3) / 4) * ((height + 3) / 4) * block_size;
+        glCompressedTexImage2D(GL_TEXTURE_2D, level, m_InternalFormat, width, height, 0, size, nullptr);
+    }
+    else {
+        glTexImage2D(GL_TEXTURE_2D, level, m_InternalFormat, width, height, 0, m_ImageFormat, m_DataType, nullptr);
+    }
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+void Texture2D::UploadLevelRows(u32 level, u32 y, u32 rows, const void* data, u32 size)
+{
+    u32 width = m_Width >> level > 0 ? m_Width >> level : 1;
+
+    glBindTexture(GL_TEXTURE_2D, m_TextureID);
+    if (CompressedTexture::GetBlockSize(m_InternalFormat) > 0) {
+        glCompressedTexSubImage2D(GL_TEXTURE_2D, level, 0, y, width, rows, m_InternalFormat, size, data);
+    }
+    else {
+        glTexSubImage2D(GL_TEXTURE_2D, level, 0, y, width, rows, m_ImageFormat, m_DataType, data);
+    }
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+void Texture2D::SetBaseLevel(u32 level)
+{
+    glBindTexture(GL_TEXTURE_2D, m_TextureID);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, level);
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
+
 void Texture2D::GenerateCubemap(u32 width, u32 height, b8 mipmap)
 {
     m_Width = width;
@@ -113,6 +177,45 @@ u32 Texture2D::GetHeight() const
     return m_Height;
 }
 
+u32 Texture2D::GetInternalFormat() const
+{
+    return m_InternalFormat;
+}
+
+u64 Texture2D::GetMemorySize() const
+{
+    u32 block_size = CompressedTexture::GetBlockSize(m_InternalFormat);
+    if (block_size > 0) {
+        u64 size = static_cast<u64>((m_Width + 3) / 4) * ((m_Height + 3) / 4) * block_size;
+        if (m_FilterMin == GL_LINEAR_MIPMAP_LINEAR)
+            size += size / 3;
+        return size;
+    }
+
+    u64 texel_size = 4;
+    switch (m_InternalFormat) {
+    case GL_RED:
+    case GL_R8:
+        texel_size = 1;
+        break;
+    case GL_RG:
+    case GL_RG8:
+        texel_size = 2;
+        break;
+    case GL_RGB:
+    case GL_RGB8:
+        texel_size = 3;
+        break;
+    default:
+        break;
+    }
+
+    u64 size = static_cast<u64>(m_Width) * m_Height * texel_size;
+    if (m_FilterMin == GL_LINEAR_MIPMAP_LINEAR)
+        size += size / 3;
+    return size;
+}
+
 std::string Texture2D::GetType() const
 {
     return m_Type;
@@ -6,6 +6,15 @@
 
 #include <string>
 
+// One level of a mip chain stored back to back with the other levels.
+struct TextureLevel
+{
+    u32 width;
+    u32 height;
+    u64 offset;
+    u64 size;
+};
+
 class Texture2D
 {
 public:
@@ -14,6 +23,15 @@ public:
     // Generates texture from image data
     void Generate(u32 width, u32 height, const void* data, b8 mipmap = false);
 
+    // Progressive residency: levels are defined one at a time, coarsest first, and sampling is clamped to the
+    // finest complete level through GL_TEXTURE_BASE_LEVEL.
+    void BeginStreaming(u32 width, u32 height, u32 level_count);
+    // defines the storage of a level without initializing it
+    void AllocateLevel(u32 level);
+    // uploads rows [y, y + rows) of a level; data may be an offset into the bound GL_PIXEL_UNPACK_BUFFER
+    void UploadLevelRows(u32 level, u32 y, u32 rows, const void* data, u32 size);
+    void SetBaseLevel(u32 level);
+
     // Generates cubemap texture from image data
     void GenerateCubemap(u32 width, u32 height, b8 mipmap = false);
 
@@ -27,6 +45,9 @@ public:
     u32 GetTexID() const;
     u32 GetWidth() const;
     u32 GetHeight() const;
+    u32 GetInternalFormat() const;
+    // approximate GPU memory footprint, including the mip chain
+    u64 GetMemorySize() const;
     std::string GetType() const;
     std::string GetPath() const;
 
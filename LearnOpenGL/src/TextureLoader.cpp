@@ -0,0 +1,184 @@
+#include "TextureLoader.h"
+
+#include "Log.h"
+#include "MipChain.h"
+#include "TextureStreamer.h"
+
+#include <stb_image.h>
+
+#include <cstring>
+
+ThreadPool* TextureLoader::s_Pool = nullptr;
+std::mutex TextureLoader::s_Mutex;
+std::condition_variable TextureLoader::s_Completed;
+std::deque<TextureLoader::DecodedImage> TextureLoader::s_CompletedQueue;
+u32 TextureLoader::s_Pending = 0;
+b8 TextureLoader::s_CompressedSupported = false;
+
+Timer TextureLoader::s_BatchTimer;
+u32 TextureLoader::s_BatchCount = 0;
+f64 TextureLoader::s_BatchDecodeMs = 0.0;
+f64 TextureLoader::s_BatchUploadMs = 0.0;
+
+void TextureLoader::Init(u32 thread_count)
+{
+    s_Pool = new ThreadPool(thread_count);
+    LOG_INFO("TextureLoader: {0} decode threads", s_Pool->GetThreadCount());
+
+    // BC5 (RGTC) is core, DXT1/DXT5 need the S3TC extension
+    i32 extension_count = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &extension_count);
+    for (i32 i = 0; i < extension_count; i++) {
+        const char* extension = reinterpret_cast<const char*>(glGetStringi(GL_EXTENSIONS, i));
+        if (std::strcmp(extension, "GL_EXT_texture_compression_s3tc") == 0)
+            s_CompressedSupported = true;
+    }
+    if (!s_CompressedSupported)
+        LOG_WARN("TextureLoader: S3TC not supported, cooked textures are ignored");
+}
+
+void TextureLoader::Shutdown()
+{
+    Flush();
+    delete s_Pool;
+    s_Pool = nullptr;
+}
+
+void TextureLoader::Enqueue(const Texture2D& texture, const std::string& path,
+                            std::function<void(const Texture2D&)> on_uploaded)
+{
+    {
+        std::lock_guard<std::mutex> lock(s_Mutex);
+        if (s_Pending == 0) {
+            s_BatchTimer.Reset();
+            s_BatchCount = 0;
+            s_BatchDecodeMs = 0.0;
+            s_BatchUploadMs = 0.0;
+        }
+        s_Pending++;
+        s_BatchCount++;
+    }
+
+    DecodedImage image = {texture, path, std::move(on_uploaded), GL_RGB, GL_RGBA, {}, {}, 0.0};
+    s_Pool->Submit([image]() { Decode(image); });
+}
+
+u32 TextureLoader::Poll()
+{
+    std::deque<DecodedImage> ready;
+    {
+        std::lock_guard<std::mutex> lock(s_Mutex);
+        ready.swap(s_CompletedQueue);
+    }
+
+    for (DecodedImage& image : ready) {
+        Upload(image);
+    }
+
+    if (!ready.empty())
+        FinishBatch();
+
+    return static_cast<u32>(ready.size());
+}
+
+void TextureLoader::Flush()
+{
+    while (true) {
+        std::deque<DecodedImage> ready;
+        {
+            std::unique_lock<std::mutex> lock(s_Mutex);
+            s_Completed.wait(lock, [] { return !s_CompletedQueue.empty() || s_Pending == 0; });
+            if (s_CompletedQueue.empty())
+                return;
+            ready.swap(s_CompletedQueue);
+        }
+
+        for (DecodedImage& image : ready) {
+            Upload(image);
+        }
+        FinishBatch();
+    }
+}
+
+u32 TextureLoader::GetPendingCount()
+{
+    std::lock_guard<std::mutex> lock(s_Mutex);
+    return s_Pending;
+}
+
+u32 TextureLoader::GetThreadCount()
+{
+    return s_Pool ? s_Pool->GetThreadCount() : 0;
+}
+
+void TextureLoader::Decode(DecodedImage image)
+{
+    Timer timer;
+
+    // prefer the cooked, block-compressed version of the texture
+    CompressedImage compressed;
+    if (s_CompressedSupported && CompressedTexture::IsCookedUpToDate(image.path) &&
+        CompressedTexture::Load(CompressedTexture::GetCookedPath(image.path), compressed)) {
+        image.internal_format = compressed.format;
+        image.levels = std::move(compressed.levels);
+        image.data = std::move(compressed.data);
+    }
+    else {
+        // the flip flag is thread-local, so every worker sets it for itself
+        stbi_set_flip_vertically_on_load_thread(false);
+        i32 width, height, components;
+        u8* pixels = stbi_load(image.path.c_str(), &width, &height, &components, 4);
+        if (pixels) {
+            if (components == 1)
+                image.internal_format = GL_RED;
+            else if (components == 3)
+                image.internal_format = GL_RGB;
+            else if (components == 4)
+                image.internal_format = GL_RGBA;
+
+            // mips are built here instead of with glGenerateMipmap, which would stall the GL thread
+            MipChain::Build(width, height, pixels, false, image.levels, image.data);
+            stbi_image_free(pixels);
+        }
+    }
+    image.decode_ms = timer.ElapsedMillis();
+
+    {
+        std::lock_guard<std::mutex> lock(s_Mutex);
+        s_CompletedQueue.push_back(std::move(image));
+    }
+    s_Completed.notify_one();
+}
+
+void TextureLoader::Upload(DecodedImage& image)
+{
+    Timer timer;
+
+    if (!image.levels.empty()) {
+        image.texture.SetInternalFormat(image.internal_format);
+        image.texture.SetImageFormat(image.image_format);
+        TextureStreamer::Submit(image.texture, std::move(image.levels), std::move(image.data));
+    }
+    else {
+        LOG_ERROR("Texture: Failed to load {0}", image.path);
+    }
+
+    if (image.on_uploaded)
+        image.on_uploaded(image.texture);
+
+    std::lock_guard<std::mutex> lock(s_Mutex);
+    s_Pending--;
+    s_BatchDecodeMs += image.decode_ms;
+    s_BatchUploadMs += timer.ElapsedMillis();
+}
+
+void TextureLoader::FinishBatch()
+{
+    std::lock_guard<std::mutex> lock(s_Mutex);
+    if (s_Pending != 0 || s_BatchCount == 0)
+        return;
+
+    LOG_INFO("TextureLoader: {0} textures in {1:.2f} ms on {2} threads (decode {3:.2f} ms cpu, upload {4:.2f} ms)",
+             s_BatchCount, s_BatchTimer.ElapsedMillis(), s_Pool->GetThreadCount(), s_BatchDecodeMs, s_BatchUploadMs);
+    s_BatchCount = 0;
+}
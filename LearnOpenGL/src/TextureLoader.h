@@ -0,0 +1,69 @@
+#pragma once
+
+#include "defines.h"
+
+#include "CompressedTexture.h"
+#include "Texture2D.h"
+#include "ThreadPool.h"
+#include "Timer.h"
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+
+// Decodes texture files and builds their mip chains on a pool of worker threads.
+// The GL thread drains the completion queue through Poll/Flush and hands each chain to TextureStreamer.
+// Textures cooked by TextureCooker are read from their block-compressed .dds instead of being decoded.
+class TextureLoader
+{
+public:
+    // thread_count == 0 uses one decode thread per hardware thread
+    static void Init(u32 thread_count = 0);
+    static void Shutdown();
+
+    // Queues a decode of the image at path. The result is uploaded into texture, which must already exist.
+    // on_uploaded runs on the GL thread once the texture is submitted for streaming, or after the decode failed.
+    static void Enqueue(const Texture2D& texture, const std::string& path,
+                        std::function<void(const Texture2D&)> on_uploaded = nullptr);
+
+    // Submits the images decoded so far without blocking. Returns the number of textures submitted.
+    static u32 Poll();
+
+    // Blocks until every queued texture has been decoded and submitted.
+    static void Flush();
+
+    static u32 GetPendingCount();
+    static u32 GetThreadCount();
+
+private:
+    struct DecodedImage
+    {
+        Texture2D texture;
+        std::string path;
+        std::function<void(const Texture2D&)> on_uploaded;
+        u32 internal_format;
+        u32 image_format;
+        std::vector<TextureLevel> levels;
+        std::vector<u8> data;
+        f64 decode_ms;
+    };
+
+    static void Decode(DecodedImage image);
+    static void Upload(DecodedImage& image);
+    static void FinishBatch();
+
+    static ThreadPool* s_Pool;
+    static std::mutex s_Mutex;
+    static std::condition_variable s_Completed;
+    static std::deque<DecodedImage> s_CompletedQueue;
+    static u32 s_Pending;
+    static b8 s_CompressedSupported;
+
+    // timings of the current batch, reported once the queue runs empty
+    static Timer s_BatchTimer;
+    static u32 s_BatchCount;
+    static f64 s_BatchDecodeMs;
+    static f64 s_BatchUploadMs;
+};
@@ -0,0 +1,164 @@
+#include "TextureRegistry.h"
+
+#include "Log.h"
+#include "TextureLoader.h"
+#include "TextureStreamer.h"
+
+#include <filesystem>
+
+std::unordered_map<std::string, TextureRegistry::Entry> TextureRegistry::s_Entries;
+u32 TextureRegistry::s_Hits = 0;
+u32 TextureRegistry::s_Misses = 0;
+b8 TextureRegistry::s_Shutdown = false;
+
+TextureHandle TextureRegistry::Acquire(const std::string& path)
+{
+    std::string key = NormalizePath(path);
+
+    auto it = s_Entries.find(key);
+    if (it != s_Entries.end()) {
+        s_Hits++;
+        it->second.hits++;
+        return TextureHandle(&it->second);
+    }
+
+    s_Misses++;
+    Entry& entry = s_Entries[key];
+    entry.key = key;
+    entry.ref_count = 0;
+    entry.hits = 0;
+    entry.bytes = 0;
+    entry.uploaded = false;
+    entry.texture.SetPath(path);
+
+    TextureLoader::Enqueue(entry.texture, path, [key](const Texture2D& texture) { OnUploaded(key, texture); });
+
+    return TextureHandle(&entry);
+}
+
+void TextureRegistry::Shutdown()
+{
+    TextureLoader::Flush();
+
+    for (auto& [key, entry] : s_Entries) {
+        TextureStreamer::Cancel(entry.texture.GetTexID());
+        entry.texture.Destroy();
+    }
+    s_Entries.clear();
+    s_Shutdown = true;
+}
+
+TextureRegistry::Stats TextureRegistry::GetStats()
+{
+    Stats stats = {};
+    stats.textures = static_cast<u32>(s_Entries.size());
+    stats.hits = s_Hits;
+    stats.misses = s_Misses;
+    for (const auto& [key, entry] : s_Entries) {
+        stats.resident_bytes += entry.bytes;
+        stats.bytes_saved += entry.bytes * entry.hits;
+    }
+    return stats;
+}
+
+std::string TextureRegistry::NormalizePath(const std::string& path)
+{
+    std::error_code ec;
+    std::filesystem::path normalized = std::filesystem::weakly_canonical(path, ec);
+    if (ec)
+        normalized = std::filesystem::absolute(path, ec).lexically_normal();
+    return normalized.generic_string();
+}
+
+void TextureRegistry::AddRef(Entry* entry)
+{
+    entry->ref_count++;
+}
+
+void TextureRegistry::Release(Entry* entry)
+{
+    if (s_Shutdown)
+        return;
+
+    entry->ref_count--;
+    // a texture still waiting for its upload is destroyed once the upload lands
+    if (entry->ref_count == 0 && entry->uploaded) {
+        TextureStreamer::Cancel(entry->texture.GetTexID());
+        entry->texture.Destroy();
+        // the key lives in the node being erased, so erase through an iterator
+        s_Entries.erase(s_Entries.find(entry->key));
+    }
+}
+
+void TextureRegistry::OnUploaded(const std::string& key, const Texture2D& texture)
+{
+    auto it = s_Entries.find(key);
+    if (it == s_Entries.end())
+        return;
+
+    Entry& entry = it->second;
+    entry.texture = texture;
+    entry.uploaded = true;
+    entry.bytes = texture.GetMemorySize();
+
+    if (entry.ref_count == 0) {
+        TextureStreamer::Cancel(entry.texture.GetTexID());
+        entry.texture.Destroy();
+        s_Entries.erase(it);
+    }
+}
+
+TextureHandle::TextureHandle(TextureRegistry::Entry* entry) : m_Entry(entry)
+{
+    TextureRegistry::AddRef(m_Entry);
+}
+
+TextureHandle::~TextureHandle()
+{
+    if (m_Entry)
+        TextureRegistry::Release(m_Entry);
+}
+
+TextureHandle::TextureHandle(const TextureHandle& other) : m_Entry(other.m_Entry)
+{
+    if (m_Entry)
+        TextureRegistry::AddRef(m_Entry);
+}
+
+TextureHandle& TextureHandle::operator=(const TextureHandle& other)
+{
+    if (this != &other) {
+        if (other.m_Entry)
+            TextureRegistry::AddRef(other.m_Entry);
+        if (m_Entry)
+            TextureRegistry::Release(m_Entry);
+        m_Entry = other.m_Entry;
+    }
+    return *this;
+}
+
+TextureHandle::TextureHandle(TextureHandle&& other) noexcept : m_Entry(other.m_Entry)
+{
+    other.m_Entry = nullptr;
+}
+
+TextureHandle& TextureHandle::operator=(TextureHandle&& other) noexcept
+{
+    if (this != &other) {
+        if (m_Entry)
+            TextureRegistry::Release(m_Entry);
+        m_Entry = other.m_Entry;
+        other.m_Entry = nullptr;
+    }
+    return *this;
+}
+
+const Texture2D& TextureHandle::Get() const
+{
+    return m_Entry->texture;
+}
+
+b8 TextureHandle::IsValid() const
+{
+    return m_Entry != nullptr;
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include "defines.h"
+
+#include "Texture2D.h"
+
+#include <string>
+#include <unordered_map>
+
+class TextureHandle;
+
+// Process-wide texture cache shared by every Model.
+//
+// Textures are keyed by their normalized absolute path, so the same file is decoded and uploaded once no matter how
+// many meshes or models reference it. Entries are reference counted through TextureHandle and the GL texture is
+// released together with the last handle.
+class TextureRegistry
+{
+public:
+    struct Stats
+    {
+        u32 textures;
+        u32 hits;
+        u32 misses;
+        u64 resident_bytes;
+        u64 bytes_saved;
+    };
+
+    // Returns a handle to the texture at path, queuing a load on the first request.
+    static TextureHandle Acquire(const std::string& path);
+
+    // Destroys every texture. Must run while the GL context is still current.
+    static void Shutdown();
+
+    static Stats GetStats();
+    static std::string NormalizePath(const std::string& path);
+
+private:
+    friend class TextureHandle;
+
+    struct Entry
+    {
+        std::string key;
+        Texture2D texture;
+        u32 ref_count;
+        u32 hits;
+        u64 bytes;
+        b8 uploaded;
+    };
+
+    static void AddRef(Entry* entry);
+    static void Release(Entry* entry);
+    static void OnUploaded(const std::string& key, const Texture2D& texture);
+
+    static std::unordered_map<std::string, Entry> s_Entries;
+    static u32 s_Hits;
+    static u32 s_Misses;
+    static b8 s_Shutdown;
+};
+
+// Reference-counted handle to a TextureRegistry entry.
+class TextureHandle
+{
+public:
+    TextureHandle() : m_Entry(nullptr)
+    {
+    }
+    ~TextureHandle();
+
+    TextureHandle(const TextureHandle& other);
+    TextureHandle& operator=(const TextureHandle& other);
+    TextureHandle(TextureHandle&& other) noexcept;
+    TextureHandle& operator=(TextureHandle&& other) noexcept;
+
+    const Texture2D& Get() const;
+    b8 IsValid() const;
+
+private:
+    friend class TextureRegistry;
+
+    explicit TextureHandle(TextureRegistry::Entry* entry);
+
+    TextureRegistry::Entry* m_Entry;
+};
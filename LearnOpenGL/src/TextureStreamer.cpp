@@ -0,0 +1,161 @@
+#include "TextureStreamer.h"
+
+#include "CompressedTexture.h"
+#include "Log.h"
+
+#include <algorithm>
+#include <cstring>
+
+std::deque<TextureStreamer::Request> TextureStreamer::s_Requests;
+u32 TextureStreamer::s_PBOs[TextureStreamer::PBO_COUNT] = {};
+u32 TextureStreamer::s_NextPBO = 0;
+u64 TextureStreamer::s_Budget = 0;
+u64 TextureStreamer::s_UploadedBytes = 0;
+
+void TextureStreamer::Init(u64 bytes_per_frame)
+{
+    glGenBuffers(PBO_COUNT, s_PBOs);
+    s_Budget = bytes_per_frame;
+    LOG_INFO("TextureStreamer: {0} KB per frame upload budget", s_Budget / 1024);
+}
+
+void TextureStreamer::Shutdown()
+{
+    s_Requests.clear();
+    glDeleteBuffers(PBO_COUNT, s_PBOs);
+}
+
+void TextureStreamer::Submit(Texture2D& texture, std::vector<TextureLevel> levels, std::vector<u8> data)
+{
+    if (levels.empty())
+        return;
+
+    texture.BeginStreaming(levels[0].width, levels[0].height, static_cast<u32>(levels.size()));
+
+    Request request;
+    request.texture = texture;
+    request.levels = std::move(levels);
+    request.data = std::move(data);
+    request.next_level = static_cast<i32>(request.levels.size()) - 1;
+    request.rows_done = 0;
+    request.bytes_left = 0;
+
+    // small levels go up right away so the texture is usable this frame
+    while (request.next_level >= 0) {
+        const TextureLevel& level = request.levels[request.next_level];
+        if (request.next_level < static_cast<i32>(request.levels.size()) - 1 &&
+            std::max(level.width, level.height) > IMMEDIATE_LEVEL_SIZE)
+            break;
+
+        request.texture.AllocateLevel(request.next_level);
+        request.texture.UploadLevelRows(request.next_level, 0, level.height, request.data.data() + level.offset,
+                                        static_cast<u32>(level.size));
+        request.next_level--;
+    }
+    request.texture.SetBaseLevel(request.next_level + 1);
+
+    if (request.next_level < 0)
+        return;
+
+    for (i32 i = 0; i <= request.next_level; i++)
+        request.bytes_left += request.levels[i].size;
+    s_Requests.push_back(std::move(request));
+}
+
+void TextureStreamer::Cancel(u32 texture_id)
+{
+    s_Requests.erase(std::remove_if(s_Requests.begin(), s_Requests.end(),
+                                    [texture_id](const Request& r) { return r.texture.GetTexID() == texture_id; }),
+                     s_Requests.end());
+}
+
+void TextureStreamer::Update()
+{
+    s_UploadedBytes = 0;
+
+    while (!s_Requests.empty()) {
+        Request& request = s_Requests.front();
+        const TextureLevel& level = request.levels[request.next_level];
+
+        u32 row_alignment = GetRowAlignment(request.texture);
+        u64 row_pitch = GetRowPitch(request, level);
+        u64 budget_left = s_Budget > s_UploadedBytes ? s_Budget - s_UploadedBytes : 0;
+
+        // whole row bands that fit the remaining budget; always make some progress each frame
+        u32 rows_left = level.height - request.rows_done;
+        u32 rows = static_cast<u32>(std::min<u64>(rows_left, budget_left / row_pitch * row_alignment));
+        if (rows == 0) {
+            if (s_UploadedBytes > 0)
+                break;
+            rows = std::min(rows_left, row_alignment);
+        }
+
+        u64 offset = level.offset + static_cast<u64>(request.rows_done / row_alignment) * row_pitch;
+        u64 size = std::min<u64>(static_cast<u64>((rows + row_alignment - 1) / row_alignment) * row_pitch,
+                                 level.offset + level.size - offset);
+
+        if (request.rows_done == 0)
+            request.texture.AllocateLevel(request.next_level);
+
+        // stage through the next PBO in the ring; orphaning its storage keeps the copy from waiting on the GPU
+        u32 pbo = s_PBOs[s_NextPBO];
+        s_NextPBO = (s_NextPBO + 1) % PBO_COUNT;
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pbo);
+        glBufferData(GL_PIXEL_UNPACK_BUFFER, size, nullptr, GL_STREAM_DRAW);
+        void* dst = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+        if (!dst) {
+            // nothing was uploaded, the same rows are tried again next frame
+            LOG_ERROR("TextureStreamer: Failed to map a {0} byte staging buffer", size);
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+            break;
+        }
+        std::memcpy(dst, request.data.data() + offset, size);
+        glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+        request.texture.UploadLevelRows(request.next_level, request.rows_done, rows, nullptr, static_cast<u32>(size));
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+        s_UploadedBytes += size;
+        request.bytes_left -= std::min(request.bytes_left, size);
+        request.rows_done += rows;
+
+        if (request.rows_done >= level.height) {
+            request.texture.SetBaseLevel(request.next_level);
+            request.next_level--;
+            request.rows_done = 0;
+
+            if (request.next_level < 0)
+                s_Requests.pop_front();
+        }
+    }
+}
+
+void TextureStreamer::SetBudget(u64 bytes_per_frame)
+{
+    s_Budget = bytes_per_frame;
+}
+
+TextureStreamer::Stats TextureStreamer::GetStats()
+{
+    Stats stats = {};
+    stats.pending_textures = static_cast<u32>(s_Requests.size());
+    for (const Request& request : s_Requests) {
+        stats.pending_levels += request.next_level + 1;
+        stats.pending_bytes += request.bytes_left;
+    }
+    stats.uploaded_bytes = s_UploadedBytes;
+    stats.budget = s_Budget;
+    return stats;
+}
+
+u32 TextureStreamer::GetRowAlignment(const Texture2D& texture)
+{
+    // compressed formats are uploaded in whole rows of 4x4 blocks
+    return CompressedTexture::GetBlockSize(texture.GetInternalFormat()) > 0 ? 4 : 1;
+}
+
+u64 TextureStreamer::GetRowPitch(const Request& request, const TextureLevel& level)
+{
+    // bytes per row (or per row of blocks)
+    u32 rows = (level.height + GetRowAlignment(request.texture) - 1) / GetRowAlignment(request.texture);
+    return level.size / rows;
+}
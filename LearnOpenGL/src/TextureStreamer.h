@@ -0,0 +1,65 @@
+#pragma once
+
+#include "defines.h"
+
+#include "Texture2D.h"
+
+#include <deque>
+#include <vector>
+
+// Uploads texture mip chains progressively under a per-frame byte budget.
+//
+// A submitted texture becomes usable right away at a small mip level. Finer levels are uploaded over the following
+// frames through a ring of pixel buffer objects, in row bands so a single large level never blows the budget, and
+// the texture's base level drops to each level once it is complete.
+class TextureStreamer
+{
+public:
+    struct Stats
+    {
+        u32 pending_textures;
+        u32 pending_levels;
+        u64 pending_bytes;
+        u64 uploaded_bytes; // last Update
+        u64 budget;
+    };
+
+    static void Init(u64 bytes_per_frame);
+    static void Shutdown();
+
+    // Takes over a full mip chain (level 0 first) for texture, whose formats must already be set.
+    // Levels up to IMMEDIATE_LEVEL_SIZE texels on a side are uploaded before returning.
+    static void Submit(Texture2D& texture, std::vector<TextureLevel> levels, std::vector<u8> data);
+
+    // Drops the pending uploads of a texture that is about to be destroyed.
+    static void Cancel(u32 texture_id);
+
+    // Uploads pending levels until this frame's budget is used up. Call once per frame on the GL thread.
+    static void Update();
+
+    static void SetBudget(u64 bytes_per_frame);
+    static Stats GetStats();
+
+private:
+    static const u32 IMMEDIATE_LEVEL_SIZE = 128;
+    static const u32 PBO_COUNT = 3;
+
+    struct Request
+    {
+        Texture2D texture;
+        std::vector<TextureLevel> levels;
+        std::vector<u8> data;
+        i32 next_level;  // finest level still missing
+        u32 rows_done;   // rows of next_level uploaded so far
+        u64 bytes_left;
+    };
+
+    static u32 GetRowAlignment(const Texture2D& texture);
+    static u64 GetRowPitch(const Request& request, const TextureLevel& level);
+
+    static std::deque<Request> s_Requests;
+    static u32 s_PBOs[PBO_COUNT];
+    static u32 s_NextPBO;
+    static u64 s_Budget;
+    static u64 s_UploadedBytes;
+};
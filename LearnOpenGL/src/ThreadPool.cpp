@@ -0,0 +1,77 @@
+#include "ThreadPool.h"
+
+ThreadPool::ThreadPool(u32 thread_count) : m_ActiveJobs(0), m_Stopping(false)
+{
+    if (thread_count == 0)
+        thread_count = GetHardwareThreadCount();
+
+    m_Workers.reserve(thread_count);
+    for (u32 i = 0; i < thread_count; i++) {
+        m_Workers.emplace_back(&ThreadPool::WorkerLoop, this);
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_Stopping = true;
+    }
+    m_JobAvailable.notify_all();
+
+    for (std::thread& worker : m_Workers) {
+        worker.join();
+    }
+}
+
+void ThreadPool::Submit(std::function<void()> job)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_Jobs.push_back(std::move(job));
+    }
+    m_JobAvailable.notify_one();
+}
+
+void ThreadPool::Wait()
+{
+    std::unique_lock<std::mutex> lock(m_Mutex);
+    m_AllDone.wait(lock, [this] { return m_Jobs.empty() && m_ActiveJobs == 0; });
+}
+
+u32 ThreadPool::GetThreadCount() const
+{
+    return static_cast<u32>(m_Workers.size());
+}
+
+u32 ThreadPool::GetHardwareThreadCount()
+{
+    u32 count = std::thread::hardware_concurrency();
+    return count > 0 ? count : 1;
+}
+
+void ThreadPool::WorkerLoop()
+{
+    while (true) {
+        std::function<void()> job;
+        {
+            std::unique_lock<std::mutex> lock(m_Mutex);
+            m_JobAvailable.wait(lock, [this] { return m_Stopping || !m_Jobs.empty(); });
+            if (m_Stopping && m_Jobs.empty())
+                return;
+
+            job = std::move(m_Jobs.front());
+            m_Jobs.pop_front();
+            m_ActiveJobs++;
+        }
+
+        job();
+
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            m_ActiveJobs--;
+            if (m_Jobs.empty() && m_ActiveJobs == 0)
+                m_AllDone.notify_all();
+        }
+    }
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include "defines.h"
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed-size pool of worker threads executing jobs in FIFO order.
+class ThreadPool
+{
+public:
+    // thread_count == 0 uses one thread per hardware thread
+    explicit ThreadPool(u32 thread_count = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    void Submit(std::function<void()> job);
+
+    // blocks until every submitted job has finished
+    void Wait();
+
+    u32 GetThreadCount() const;
+
+    static u32 GetHardwareThreadCount();
+
+private:
+    void WorkerLoop();
+
+    std::vector<std::thread> m_Workers;
+    std::deque<std::function<void()>> m_Jobs;
+    std::mutex m_Mutex;
+    std::condition_variable m_JobAvailable;
+    std::condition_variable m_AllDone;
+    u32 m_ActiveJobs;
+    b8 m_Stopping;
+};
@@ -0,0 +1,37 @@
+#pragma once
+
+#include "defines.h"
+
+#include <chrono>
+
+// Simple wall-clock stopwatch used for load-time and CPU cost measurements.
+class Timer
+{
+public:
+    Timer()
+    {
+        Reset();
+    }
+
+    void Reset()
+    {
+        m_Start = std::chrono::high_resolution_clock::now();
+    }
+
+    f64 ElapsedMillis() const
+    {
+        return std::chrono::duration<f64, std::milli>(std::chrono::high_resolution_clock::now() - m_Start).count();
+    }
+
+private:
+    std::chrono::time_point<std::chrono::high_resolution_clock> m_Start;
+};
+
+// Weight of the newest sample in the running averages shown in the stats
+const f64 RUNNING_AVERAGE_WEIGHT = 0.05;
+
+// Folds sample into a running average that starts out at the first sample, 0 meaning none yet
+inline void UpdateRunningAverage(f64& average, f64 sample)
+{
+    average = average == 0.0 ? sample : average + (sample - average) * RUNNING_AVERAGE_WEIGHT;
+}
@@ -0,0 +1,80 @@
+#include "UniformBuffers.h"
+
+#include "Log.h"
+
+#include <algorithm>
+
+u32 UniformBuffers::s_FrameBuffer = 0;
+FencedRing UniformBuffers::s_ObjectRing;
+
+void UniformBuffers::Init()
+{
+    glGenBuffers(1, &s_FrameBuffer);
+    glBindBuffer(GL_UNIFORM_BUFFER, s_FrameBuffer);
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(FrameConstants), nullptr, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    glBindBufferBase(GL_UNIFORM_BUFFER, static_cast<u32>(UniformBinding::Frame), s_FrameBuffer);
+
+    // bound ranges must start at a multiple of the offset alignment
+    i32 alignment = 0;
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+    u32 align = static_cast<u32>(std::max(alignment, 1));
+    u32 stride = (static_cast<u32>(sizeof(ObjectConstants)) + align - 1) / align * align;
+
+    s_ObjectRing.Init("UniformBuffers", stride, INITIAL_OBJECT_CAPACITY);
+    LOG_INFO("UniformBuffers: {0} byte object blocks, {1} per frame", stride, s_ObjectRing.GetCapacity());
+}
+
+void UniformBuffers::Shutdown()
+{
+    s_ObjectRing.Shutdown();
+    glDeleteBuffers(1, &s_FrameBuffer);
+    s_FrameBuffer = 0;
+}
+
+void UniformBuffers::BindBlocks(u32 program)
+{
+    u32 frame = glGetUniformBlockIndex(program, "Frame");
+    if (frame != GL_INVALID_INDEX)
+        glUniformBlockBinding(program, frame, static_cast<u32>(UniformBinding::Frame));
+
+    u32 object = glGetUniformBlockIndex(program, "Object");
+    if (object != GL_INVALID_INDEX)
+        glUniformBlockBinding(program, object, static_cast<u32>(UniformBinding::Object));
+}
+
+void UniformBuffers::BeginFrame(const FrameConstants& constants)
+{
+    s_ObjectRing.BeginFrame();
+
+    glBindBuffer(GL_UNIFORM_BUFFER, s_FrameBuffer);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(FrameConstants), &constants);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+void UniformBuffers::EndFrame()
+{
+    s_ObjectRing.EndFrame();
+}
+
+u32 UniformBuffers::WriteObjects(const ObjectConstants* objects, u32 count)
+{
+    return s_ObjectRing.Write(objects, sizeof(ObjectConstants), count);
+}
+
+void UniformBuffers::BindObject(u32 slot)
+{
+    glBindBufferRange(GL_UNIFORM_BUFFER, static_cast<u32>(UniformBinding::Object), s_ObjectRing.GetBuffer(),
+                      s_ObjectRing.GetOffset(slot), sizeof(ObjectConstants));
+}
+
+ObjectConstants UniformBuffers::MakeObject(const glm::mat4& model)
+{
+    glm::mat3 normal_matrix = glm::transpose(glm::inverse(glm::mat3(model)));
+
+    ObjectConstants object;
+    object.model = model;
+    for (u32 i = 0; i < 3; i++)
+        object.normal_matrix[i] = glm::vec4(normal_matrix[i], 0.0f);
+    return object;
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include "defines.h"
+
+#include "FencedRing.h"
+
+#include <glad/glad.h>
+
+#include <glm/glm.hpp>
+
+// Binding points of the shared uniform blocks, assigned to every program by block name
+enum class UniformBinding : u32
+{
+    Frame = 0,
+    Object = 1
+};
+
+// std140 layout of `uniform Frame` in the shaders
+struct FrameConstants
+{
+    glm::mat4 view;
+    glm::mat4 projection;
+    glm::mat4 view_projection;
+    glm::vec4 view_position;  // w unused
+    glm::vec4 light_position; // w unused
+    glm::vec4 cluster_scale;  // clusters per pixel in xy, depth slice scale and bias in zw, see LightManager
+    glm::vec4 cluster_grid;   // clusters along xyz, point light count in w
+    glm::mat4 shadow_matrices[4]; // world to cascade clip space, see ShadowCascades
+    glm::vec4 shadow_splits;      // view depth each cascade reaches to, zero with shadows off
+    glm::vec4 shadow_texels;      // world size of a texel of each cascade
+    glm::vec4 sun_direction;      // towards the sun, intensity in w
+};
+
+// std140 layout of `uniform Object` in the shaders
+struct ObjectConstants
+{
+    glm::mat4 model;
+    glm::vec4 normal_matrix[3]; // mat3 columns, padded to vec4 as std140 does
+};
+
+// Uniform buffers shared by every program.
+//
+// The per-frame block (camera and light) is uploaded once per frame and stays bound. Per-object blocks are
+// sub-allocated from a FencedRing with one segment per frame in flight, so writes never stall on the GPU.
+// GL thread only.
+class UniformBuffers
+{
+public:
+    static void Init();
+    static void Shutdown();
+
+    // Points the program's Frame and Object blocks, if it has them, at the shared binding points
+    static void BindBlocks(u32 program);
+
+    // Starts a frame: moves to the next ring segment and uploads the frame constants
+    static void BeginFrame(const FrameConstants& constants);
+    static void EndFrame();
+
+    // Copies count object blocks into this frame's segment, returns the slot of the first one.
+    // Slots stay valid until the end of the frame.
+    static u32 WriteObjects(const ObjectConstants* objects, u32 count);
+    static void BindObject(u32 slot);
+
+    // model matrix plus its normal matrix, inverted on the CPU once instead of per vertex
+    static ObjectConstants MakeObject(const glm::mat4& model);
+
+private:
+    static const u32 INITIAL_OBJECT_CAPACITY = 1024; // per frame
+
+    static u32 s_FrameBuffer;
+    static FencedRing s_ObjectRing;
+};
@@ -0,0 +1,129 @@
+#include "VertexPacking.h"
+
+#include <glm/gtc/packing.hpp>
+
+#include <algorithm>
+#include <cmath>
+
+static i16 QuantizeSnorm16(f32 v)
+{
+    return static_cast<i16>(std::lround(std::clamp(v, -1.0f, 1.0f) * 32767.0f));
+}
+
+static i8 QuantizeSnorm8(f32 v)
+{
+    return static_cast<i8>(std::lround(std::clamp(v, -1.0f, 1.0f) * 127.0f));
+}
+
+static glm::vec2 OctEncode(glm::vec3 n)
+{
+    f32 l1 = std::abs(n.x) + std::abs(n.y) + std::abs(n.z);
+    if (l1 < 1e-12f)
+        return glm::vec2(0.0f, 0.0f); // degenerate vectors decode to +z
+
+    n /= l1;
+    if (n.z < 0.0f) {
+        f32 x = (1.0f - std::abs(n.y)) * (n.x >= 0.0f ? 1.0f : -1.0f);
+        f32 y = (1.0f - std::abs(n.x)) * (n.y >= 0.0f ? 1.0f : -1.0f);
+        return glm::vec2(x, y);
+    }
+    return glm::vec2(n.x, n.y);
+}
+
+static glm::vec3 OctDecode(glm::vec2 e)
+{
+    glm::vec3 n(e.x, e.y, 1.0f - std::abs(e.x) - std::abs(e.y));
+    f32 t = std::max(-n.z, 0.0f);
+    n.x += n.x >= 0.0f ? -t : t;
+    n.y += n.y >= 0.0f ? -t : t;
+    return glm::normalize(n);
+}
+
+static f32 AngleDegrees(const glm::vec3& a, const glm::vec3& b)
+{
+    f32 la = glm::length(a);
+    f32 lb = glm::length(b);
+    if (la < 1e-12f || lb < 1e-12f)
+        return 0.0f;
+    return glm::degrees(std::acos(std::clamp(glm::dot(a, b) / (la * lb), -1.0f, 1.0f)));
+}
+
+VertexBounds VertexPacking::ComputeBounds(const Vertex* vertices, u32 count)
+{
+    if (count == 0)
+        return {glm::vec3(0.0f), glm::vec3(1.0f)};
+
+    glm::vec3 min = vertices[0].position;
+    glm::vec3 max = vertices[0].position;
+    for (u32 i = 1; i < count; i++) {
+        min = glm::min(min, vertices[i].position);
+        max = glm::max(max, vertices[i].position);
+    }
+
+    // flat meshes would divide by zero
+    glm::vec3 extent = glm::max((max - min) * 0.5f, glm::vec3(1e-6f));
+    return {(min + max) * 0.5f, extent};
+}
+
+void VertexPacking::Pack(const Vertex* vertices, u32 count, const VertexBounds& bounds, PackedVertex* packed)
+{
+    for (u32 i = 0; i < count; i++) {
+        const Vertex& v = vertices[i];
+        PackedVertex& p = packed[i];
+
+        glm::vec3 position = (v.position - bounds.center) / bounds.extent;
+        f32 sign = glm::dot(glm::cross(v.normal, v.tangents), v.bitangents) < 0.0f ? -1.0f : 1.0f;
+        p.position[0] = QuantizeSnorm16(position.x);
+        p.position[1] = QuantizeSnorm16(position.y);
+        p.position[2] = QuantizeSnorm16(position.z);
+        p.position[3] = QuantizeSnorm16(sign);
+
+        glm::vec2 normal = OctEncode(v.normal);
+        p.normal[0] = QuantizeSnorm16(normal.x);
+        p.normal[1] = QuantizeSnorm16(normal.y);
+
+        p.tex_coords[0] = glm::packHalf1x16(v.tex_coords.x);
+        p.tex_coords[1] = glm::packHalf1x16(v.tex_coords.y);
+
+        glm::vec2 tangent = OctEncode(v.tangents);
+        p.tangent[0] = QuantizeSnorm8(tangent.x);
+        p.tangent[1] = QuantizeSnorm8(tangent.y);
+
+        p.padding[0] = 0;
+        p.padding[1] = 0;
+    }
+}
+
+Vertex VertexPacking::Unpack(const PackedVertex& p, const VertexBounds& bounds)
+{
+    Vertex v;
+    glm::vec3 position(p.position[0] / 32767.0f, p.position[1] / 32767.0f, p.position[2] / 32767.0f);
+    v.position = bounds.center + bounds.extent * position;
+    v.normal = OctDecode(glm::vec2(p.normal[0] / 32767.0f, p.normal[1] / 32767.0f));
+    v.tex_coords = glm::vec2(glm::unpackHalf1x16(p.tex_coords[0]), glm::unpackHalf1x16(p.tex_coords[1]));
+    v.tangents = OctDecode(glm::vec2(p.tangent[0] / 127.0f, p.tangent[1] / 127.0f));
+    v.bitangents = glm::cross(v.normal, v.tangents) * (p.position[3] < 0 ? -1.0f : 1.0f);
+    return v;
+}
+
+VertexPacking::Error VertexPacking::MeasureError(const Vertex* vertices, const PackedVertex* packed, u32 count,
+                                                 const VertexBounds& bounds)
+{
+    Error error = {0.0f, 0.0f, 0.0f, 0.0f};
+    f32 scale = std::max(bounds.extent.x, std::max(bounds.extent.y, bounds.extent.z));
+
+    for (u32 i = 0; i < count; i++) {
+        const Vertex& v = vertices[i];
+        Vertex u = Unpack(packed[i], bounds);
+
+        error.max_position = std::max(error.max_position, glm::length(v.position - u.position) / scale);
+        error.max_normal_deg = std::max(error.max_normal_deg, AngleDegrees(v.normal, u.normal));
+        error.max_tangent_deg = std::max(error.max_tangent_deg, AngleDegrees(v.tangents, u.tangents));
+        // half floats lose absolute precision as tiling UVs grow, so compare against the UV magnitude
+        f32 tex_coord_x = std::abs(v.tex_coords.x - u.tex_coords.x) / std::max(1.0f, std::abs(v.tex_coords.x));
+        f32 tex_coord_y = std::abs(v.tex_coords.y - u.tex_coords.y) / std::max(1.0f, std::abs(v.tex_coords.y));
+        error.max_tex_coord = std::max(error.max_tex_coord, std::max(tex_coord_x, tex_coord_y));
+    }
+
+    return error;
+}
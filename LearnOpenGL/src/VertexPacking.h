@@ -0,0 +1,48 @@
+#pragma once
+
+#include "defines.h"
+
+#include "Mesh.h"
+
+#include <glm/glm.hpp>
+
+// 20-byte vertex, decoded in normal_mapping_vs.glsl when it is built with PACKED_VERTEX.
+// The bitangent is not stored, the shader rebuilds it as cross(normal, tangent) * sign.
+struct PackedVertex
+{
+    i16 position[4];   // snorm16 inside the mesh bounds, w = bitangent sign
+    i16 normal[2];     // octahedral, snorm16
+    u16 tex_coords[2]; // half float, UVs may tile outside [0, 1]
+    i8 tangent[2];     // octahedral, snorm8
+    i8 padding[2];
+};
+
+static_assert(sizeof(PackedVertex) == 20, "PackedVertex must stay tightly packed");
+
+// position = center + extent * snorm
+struct VertexBounds
+{
+    glm::vec3 center;
+    glm::vec3 extent;
+};
+
+class VertexPacking
+{
+public:
+    struct Error
+    {
+        f32 max_position;     // relative to the largest bounds extent
+        f32 max_normal_deg;
+        f32 max_tangent_deg;
+        f32 max_tex_coord;    // relative to the magnitude of tiling UVs
+    };
+
+    static VertexBounds ComputeBounds(const Vertex* vertices, u32 count);
+    static void Pack(const Vertex* vertices, u32 count, const VertexBounds& bounds, PackedVertex* packed);
+
+    // Reference decode, mirrors the shader
+    static Vertex Unpack(const PackedVertex& packed, const VertexBounds& bounds);
+
+    static Error MeasureError(const Vertex* vertices, const PackedVertex* packed, u32 count,
+                              const VertexBounds& bounds);
+};
@@ -0,0 +1,120 @@
+// Bins 4 to 10000 random point lights into the ClusterGrid from random views, multithreaded, on one thread and
+// with the scalar reference, and checks that the SIMD lists match the reference. Lights within rounding distance of
+// a cluster may go either way and are only counted. Returns non-zero on any other mismatch. Needs no GL context;
+// the shading side of the same sweep is the "Point lights" slider and the Draws GPU time in Metrics.
+
+#include "ClusterGrid.h"
+#include "Log.h"
+#include "ThreadPool.h"
+#include "Timer.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <iterator>
+#include <random>
+#include <vector>
+
+const u32 LIGHT_COUNTS[] = {4, 16, 64, 256, 1024, 4096, 10000};
+const u32 VIEW_COUNT = 20;
+const f32 DISTANCE_TOLERANCE = 1e-3f;
+
+// the area LightManager scatters its lights over
+const glm::vec3 AREA_MIN(-50.0f, -5.0f, -85.0f);
+const glm::vec3 AREA_MAX(50.0f, 25.0f, 85.0f);
+
+// distance from the light's sphere to the cluster's box, near zero means the result is down to rounding
+static f32 GetMargin(const ClusterGrid& grid, u32 cluster, const PointLights& lights, u32 light,
+                     const glm::mat4& view)
+{
+    const BoundingBox& box = grid.GetBounds(cluster);
+    glm::vec3 position(view * glm::vec4(lights.position_x[light], lights.position_y[light], lights.position_z[light],
+                                        1.0f));
+    glm::vec3 outside = glm::max(glm::abs(position - box.center) - box.extent, glm::vec3(0.0f));
+    return glm::length(outside) - lights.radius[light];
+}
+
+int main()
+{
+    Log::Init();
+
+    std::mt19937 rng(1234);
+    std::uniform_real_distribution<f32> unit(0.0f, 1.0f);
+    std::uniform_real_distribution<f32> angle(0.0f, 6.2831853f);
+
+    std::vector<glm::mat4> views;
+    for (u32 v = 0; v < VIEW_COUNT; v++) {
+        glm::vec3 eye = AREA_MIN + (AREA_MAX - AREA_MIN) * glm::vec3(unit(rng), unit(rng), unit(rng));
+        f32 yaw = angle(rng);
+        glm::vec3 forward(std::cos(yaw), 0.2f * (unit(rng) - 0.5f), std::sin(yaw));
+        views.push_back(glm::lookAt(eye, eye + forward, glm::vec3(0.0f, 1.0f, 0.0f)));
+    }
+
+    ThreadPool pool;
+    ClusterGrid grid;
+    ClusterGrid reference;
+    grid.Configure(glm::radians(45.0f), 16.0f / 9.0f, 0.1f, 1000.0f);
+    reference.Configure(glm::radians(45.0f), 16.0f / 9.0f, 0.1f, 1000.0f);
+
+    u32 mismatches = 0;
+    u32 borderline = 0;
+    LOG_INFO("ClusterBench: {0} clusters, {1} with {2} threads", ClusterGrid::CLUSTER_COUNT,
+             ClusterGrid::GetInstructionSet(), pool.GetThreadCount());
+    LOG_INFO("{0:>8} {1:>10} {2:>8} {3:>12} {4:>12} {5:>12} {6:>14}", "lights", "entries", "max", "threaded ms",
+             "1 thread ms", "scalar ms", "ns/light (MT)");
+    for (u32 count : LIGHT_COUNTS) {
+        PointLights lights;
+        for (u32 i = 0; i < count; i++) {
+            glm::vec3 position = AREA_MIN + (AREA_MAX - AREA_MIN) * glm::vec3(unit(rng), unit(rng), unit(rng));
+            lights.Add(position, 3.0f + 5.0f * unit(rng), glm::vec3(1.0f));
+        }
+
+        u64 entries = 0;
+        u32 max_cluster_lights = 0;
+        f64 threaded_ms = 0.0;
+        f64 single_ms = 0.0;
+        f64 scalar_ms = 0.0;
+        for (const glm::mat4& view : views) {
+            Timer timer;
+            grid.Bin(lights, view, nullptr);
+            single_ms += timer.ElapsedMillis();
+
+            timer.Reset();
+            grid.Bin(lights, view, &pool);
+            threaded_ms += timer.ElapsedMillis();
+
+            timer.Reset();
+            reference.BinScalar(lights, view);
+            scalar_ms += timer.ElapsedMillis();
+
+            entries += grid.GetIndices().size();
+            max_cluster_lights = std::max(max_cluster_lights, grid.GetMaxClusterLights());
+
+            // both lists of a cluster are in ascending light order
+            const std::vector<u16>& indices = grid.GetIndices();
+            const std::vector<u16>& expected = reference.GetIndices();
+            for (u32 c = 0; c < ClusterGrid::CLUSTER_COUNT; c++) {
+                ClusterGrid::Cluster a = grid.GetClusters()[c];
+                ClusterGrid::Cluster b = reference.GetClusters()[c];
+                std::vector<u16> differing;
+                std::set_symmetric_difference(indices.begin() + a.first, indices.begin() + a.first + a.count,
+                                              expected.begin() + b.first, expected.begin() + b.first + b.count,
+                                              std::back_inserter(differing));
+                for (u16 light : differing) {
+                    if (std::abs(GetMargin(grid, c, lights, light, view)) < DISTANCE_TOLERANCE)
+                        borderline++;
+                    else
+                        mismatches++;
+                }
+            }
+        }
+
+        LOG_INFO("{0:>8} {1:>10} {2:>8} {3:>12.3f} {4:>12.3f} {5:>12.3f} {6:>14.1f}", count, entries / VIEW_COUNT,
+                 max_cluster_lights, threaded_ms / VIEW_COUNT, single_ms / VIEW_COUNT, scalar_ms / VIEW_COUNT,
+                 threaded_ms * 1e6 / VIEW_COUNT / count);
+    }
+
+    LOG_INFO("ClusterBench: {0} mismatches, {1} on a cluster boundary", mismatches, borderline);
+    return mismatches > 0 ? 1 : 0;
+}
@@ -0,0 +1,106 @@
+// Culls random boxes against random view frustums with Frustum::Cull (SIMD) and Frustum::CullScalar and checks
+// that both agree. Boxes within rounding distance of a plane may go either way and are only counted. Also times
+// both paths. Returns non-zero on any other mismatch. Needs no GL context.
+
+#include "Frustum.h"
+#include "Log.h"
+#include "Timer.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+const u32 FRUSTUM_COUNT = 200;
+const u32 BOX_COUNT = 4099; // not a multiple of the SIMD width, so the padding is exercised
+const f32 PLANE_TOLERANCE = 1e-3f;
+
+// distance of the box's furthest point past the closest plane, near zero means the result is down to rounding
+static f32 GetMargin(const Frustum& frustum, const BoundingBox& box)
+{
+    f32 margin = 1e30f;
+    for (u32 p = 0; p < Frustum::Count; p++) {
+        const glm::vec4& plane = frustum.GetPlane(p);
+        f32 distance = glm::dot(glm::vec3(plane), box.center) + plane.w;
+        f32 radius = glm::dot(glm::abs(glm::vec3(plane)), box.extent);
+        margin = std::min(margin, distance + radius);
+    }
+    return margin;
+}
+
+int main()
+{
+    Log::Init();
+
+    std::mt19937 rng(1234);
+    std::uniform_real_distribution<f32> position(-100.0f, 100.0f);
+    std::uniform_real_distribution<f32> size(0.01f, 10.0f);
+    std::uniform_real_distribution<f32> angle(0.0f, 6.2831853f);
+    std::uniform_real_distribution<f32> fov(20.0f, 100.0f);
+
+    u32 mismatches = 0;
+    u32 borderline = 0;
+    u64 visible_total = 0;
+    f64 simd_ms = 0.0;
+    f64 scalar_ms = 0.0;
+
+    CullBatch batch;
+    std::vector<u8> simd_visible;
+    std::vector<u8> scalar_visible;
+    for (u32 f = 0; f < FRUSTUM_COUNT; f++) {
+        glm::vec3 eye(position(rng), position(rng), position(rng));
+        glm::vec3 forward(std::cos(angle(rng)), std::sin(angle(rng)) * 0.5f, std::sin(angle(rng)));
+        glm::mat4 view = glm::lookAt(eye, eye + forward, glm::vec3(0.0f, 1.0f, 0.0f));
+        glm::mat4 projection = glm::perspective(glm::radians(fov(rng)), 16.0f / 9.0f, 0.1f, 150.0f);
+        Frustum frustum(projection * view);
+
+        batch.Clear();
+        std::vector<BoundingBox> boxes;
+        for (u32 i = 0; i < BOX_COUNT; i++) {
+            BoundingBox box = {glm::vec3(position(rng), position(rng), position(rng)),
+                               glm::vec3(size(rng), size(rng), size(rng))};
+            boxes.push_back(box);
+            batch.Add(box);
+        }
+
+        Timer timer;
+        u32 simd_count = frustum.Cull(batch, simd_visible);
+        simd_ms += timer.ElapsedMillis();
+
+        timer.Reset();
+        u32 scalar_count = frustum.CullScalar(batch, scalar_visible);
+        scalar_ms += timer.ElapsedMillis();
+
+        visible_total += scalar_count;
+        if (simd_visible.size() != BOX_COUNT || scalar_visible.size() != BOX_COUNT) {
+            LOG_ERROR("FrustumCullCheck: Result has {0} entries instead of {1}", simd_visible.size(), BOX_COUNT);
+            return 1;
+        }
+
+        u32 differing = 0;
+        for (u32 i = 0; i < BOX_COUNT; i++) {
+            if (simd_visible[i] == scalar_visible[i])
+                continue;
+            differing++;
+            if (std::abs(GetMargin(frustum, boxes[i])) < PLANE_TOLERANCE)
+                borderline++;
+            else
+                mismatches++;
+        }
+        if (differing == 0 && simd_count != scalar_count) {
+            LOG_ERROR("FrustumCullCheck: Visible count {0} differs from the scalar count {1}", simd_count,
+                      scalar_count);
+            mismatches++;
+        }
+    }
+
+    u64 tested = static_cast<u64>(FRUSTUM_COUNT) * BOX_COUNT;
+    LOG_INFO("FrustumCullCheck: {0} boxes, {1:.1f}% visible, {2} mismatches, {3} on a plane", tested,
+             100.0 * visible_total / tested, mismatches, borderline);
+    LOG_INFO("FrustumCullCheck: {0} {1:.2f} ns/box, scalar {2:.2f} ns/box", Frustum::GetInstructionSet(),
+             simd_ms * 1e6 / tested, scalar_ms * 1e6 / tested);
+
+    return mismatches > 0 ? 1 : 0;
+}
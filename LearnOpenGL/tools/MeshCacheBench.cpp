@@ -0,0 +1,54 @@
+// Compares cold (Assimp import) and warm (mesh cache) load times for every model under assets/models.
+// Run from the repository root.
+
+#include "Log.h"
+#include "MeshCache.h"
+#include "ModelImporter.h"
+#include "Timer.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+int main()
+{
+    Log::Init();
+
+    std::vector<std::string> models;
+    for (const auto& entry : std::filesystem::recursive_directory_iterator("assets/models")) {
+        std::string ext = entry.path().extension().string();
+        if (ext == ".obj" || ext == ".gltf" || ext == ".glb")
+            models.push_back(entry.path().generic_string());
+    }
+    std::sort(models.begin(), models.end());
+
+    LOG_INFO("{0:<60} {1:>8} {2:>10} {3:>10} {4:>8}", "model", "meshes", "cold ms", "warm ms", "speedup");
+    for (const std::string& path : models) {
+        ModelData cold;
+        Timer timer;
+        if (!ModelImporter::Import(path, MODEL_IMPORT_FLAGS, cold))
+            continue;
+        f64 cold_ms = timer.ElapsedMillis();
+
+        MeshCache::Store(path, MODEL_IMPORT_FLAGS, cold);
+
+        ModelData warm;
+        timer.Reset();
+        if (!MeshCache::Load(path, MODEL_IMPORT_FLAGS, warm)) {
+            LOG_ERROR("MeshCacheBench: Failed to read back the cache for {0}", path);
+            continue;
+        }
+        // touch the geometry so the page faults of the mapping are part of the measurement
+        u64 checksum = 0;
+        for (u64 i = 0; i < warm.index_count; i++)
+            checksum += warm.indices[i];
+        f64 warm_ms = timer.ElapsedMillis();
+
+        LOG_INFO("{0:<60} {1:>8} {2:>10.2f} {3:>10.2f} {4:>7.1f}x", path, warm.meshes.size(), cold_ms, warm_ms,
+                 cold_ms / std::max(warm_ms, 0.001));
+        (void)checksum;
+    }
+
+    return 0;
+}
@@ -0,0 +1,198 @@
+// Checks MeshOptimizer's triangle reordering on synthetic meshes and on every mesh of every model under
+// assets/models, with its triangles shuffled first. After the vertex cache and the overdraw passes the triangles
+// must be a permutation of the input and the ACMR must not be worse than the input's. The overdraw pass gives
+// back some of the cache pass's ACMR, its threshold bounds that per cluster rather than for the whole mesh.
+// Returns non-zero if any mesh fails. Run from the repository root.
+
+#include "Log.h"
+#include "MeshOptimizer.h"
+#include "ModelImporter.h"
+
+#include <glm/gtc/constants.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <filesystem>
+#include <random>
+#include <string>
+#include <vector>
+
+const f32 OVERDRAW_THRESHOLD = 1.05f; // the default of OptimizeOverdraw
+const u32 SHUFFLE_SEED = 1234;
+
+// every triangle rotated to start at its smallest index, which keeps its winding, then sorted
+static std::vector<std::array<u32, 3>> SortedTriangles(const std::vector<u32>& indices)
+{
+    std::vector<std::array<u32, 3>> triangles;
+    triangles.reserve(indices.size() / 3);
+    for (u64 i = 0; i + 2 < indices.size(); i += 3) {
+        u32 a = indices[i], b = indices[i + 1], c = indices[i + 2];
+        if (b < a && b <= c)
+            triangles.push_back({b, c, a});
+        else if (c < a && c < b)
+            triangles.push_back({c, a, b});
+        else
+            triangles.push_back({a, b, c});
+    }
+    std::sort(triangles.begin(), triangles.end());
+    return triangles;
+}
+
+static f64 Acmr(const std::vector<u32>& indices, u32 vertex_count)
+{
+    MeshOptimizer::CacheStats stats =
+        MeshOptimizer::AnalyzeVertexCache(indices.data(), static_cast<u32>(indices.size()), vertex_count);
+    return stats.triangles > 0 ? static_cast<f64>(stats.transformed) / stats.triangles : 0.0;
+}
+
+static void ShuffleTriangles(std::vector<u32>& indices, std::mt19937& rng)
+{
+    u32 triangle_count = static_cast<u32>(indices.size() / 3);
+    for (u32 i = triangle_count; i > 1; i--) {
+        u32 j = std::uniform_int_distribution<u32>(0, i - 1)(rng);
+        for (u32 k = 0; k < 3; k++)
+            std::swap(indices[(i - 1) * 3 + k], indices[j * 3 + k]);
+    }
+}
+
+// runs both passes on a copy of indices and logs one row; false if a check fails
+static b8 CheckMesh(const std::string& name, const Vertex* vertices, u32 vertex_count,
+                    const std::vector<u32>& indices)
+{
+    std::vector<std::array<u32, 3>> input_triangles = SortedTriangles(indices);
+    f64 input_acmr = Acmr(indices, vertex_count);
+
+    std::vector<u32> cache_order = indices;
+    MeshOptimizer::OptimizeVertexCache(cache_order.data(), static_cast<u32>(cache_order.size()), vertex_count);
+    f64 cache_acmr = Acmr(cache_order, vertex_count);
+
+    std::vector<u32> overdraw_order = cache_order;
+    MeshOptimizer::OptimizeOverdraw(overdraw_order.data(), static_cast<u32>(overdraw_order.size()), vertices,
+                                    vertex_count, OVERDRAW_THRESHOLD);
+    f64 overdraw_acmr = Acmr(overdraw_order, vertex_count);
+
+    b8 cache_kept = SortedTriangles(cache_order) == input_triangles;
+    b8 overdraw_kept = SortedTriangles(overdraw_order) == input_triangles;
+    b8 acmr_ok = cache_acmr <= input_acmr && overdraw_acmr <= input_acmr;
+
+    LOG_INFO("{0:<60} {1:>10} {2:>8.3f} {3:>8.3f} {4:>8.3f} {5:>6}", name, indices.size() / 3, input_acmr,
+             cache_acmr, overdraw_acmr, cache_kept && overdraw_kept && acmr_ok ? "ok" : "FAIL");
+    if (!cache_kept)
+        LOG_ERROR("MeshOptimizerCheck: {0} lost or changed triangles in the vertex cache pass", name);
+    if (!overdraw_kept)
+        LOG_ERROR("MeshOptimizerCheck: {0} lost or changed triangles in the overdraw pass", name);
+    if (!acmr_ok)
+        LOG_ERROR("MeshOptimizerCheck: {0} got a worse ACMR", name);
+    return cache_kept && overdraw_kept && acmr_ok;
+}
+
+// side x side quads in the xz plane
+static void MakeGrid(u32 side, std::vector<Vertex>& vertices, std::vector<u32>& indices)
+{
+    vertices.clear();
+    indices.clear();
+    for (u32 z = 0; z <= side; z++) {
+        for (u32 x = 0; x <= side; x++) {
+            Vertex vertex = {};
+            vertex.position = glm::vec3(static_cast<f32>(x), 0.0f, static_cast<f32>(z));
+            vertex.normal = glm::vec3(0.0f, 1.0f, 0.0f);
+            vertices.push_back(vertex);
+        }
+    }
+    for (u32 z = 0; z < side; z++) {
+        for (u32 x = 0; x < side; x++) {
+            u32 corner = z * (side + 1) + x;
+            indices.insert(indices.end(), {corner, corner + side + 1, corner + 1});
+            indices.insert(indices.end(), {corner + 1, corner + side + 1, corner + side + 2});
+        }
+    }
+}
+
+// latitude-longitude sphere, closed, so the overdraw pass has faces pointing every way
+static void MakeSphere(u32 rings, u32 segments, std::vector<Vertex>& vertices, std::vector<u32>& indices)
+{
+    vertices.clear();
+    indices.clear();
+    for (u32 ring = 0; ring <= rings; ring++) {
+        f32 theta = glm::pi<f32>() * ring / rings;
+        for (u32 segment = 0; segment <= segments; segment++) {
+            f32 phi = 2.0f * glm::pi<f32>() * segment / segments;
+            Vertex vertex = {};
+            vertex.position =
+                glm::vec3(std::sin(theta) * std::cos(phi), std::cos(theta), std::sin(theta) * std::sin(phi));
+            vertex.normal = vertex.position;
+            vertices.push_back(vertex);
+        }
+    }
+    for (u32 ring = 0; ring < rings; ring++) {
+        for (u32 segment = 0; segment < segments; segment++) {
+            u32 corner = ring * (segments + 1) + segment;
+            indices.insert(indices.end(), {corner, corner + 1, corner + segments + 1});
+            indices.insert(indices.end(), {corner + 1, corner + segments + 2, corner + segments + 1});
+        }
+    }
+}
+
+int main()
+{
+    Log::Init();
+
+    std::mt19937 rng(SHUFFLE_SEED);
+    u32 failures = 0;
+    LOG_INFO("{0:<60} {1:>10} {2:>8} {3:>8} {4:>8} {5:>6}", "mesh", "triangles", "input", "cache", "overdraw",
+             "result");
+
+    std::vector<Vertex> vertices;
+    std::vector<u32> indices;
+    MakeGrid(64, vertices, indices);
+    failures += !CheckMesh("grid 64x64", vertices.data(), static_cast<u32>(vertices.size()), indices);
+    ShuffleTriangles(indices, rng);
+    failures += !CheckMesh("grid 64x64, shuffled", vertices.data(), static_cast<u32>(vertices.size()), indices);
+
+    MakeSphere(48, 96, vertices, indices);
+    failures += !CheckMesh("sphere 48x96", vertices.data(), static_cast<u32>(vertices.size()), indices);
+    ShuffleTriangles(indices, rng);
+    failures += !CheckMesh("sphere 48x96, shuffled", vertices.data(), static_cast<u32>(vertices.size()), indices);
+
+    // a soup of random triangles over few vertices, with repeats and degenerate ones
+    vertices.assign(256, Vertex{});
+    for (Vertex& vertex : vertices) {
+        std::uniform_real_distribution<f32> coordinate(-1.0f, 1.0f);
+        vertex.position = glm::vec3(coordinate(rng), coordinate(rng), coordinate(rng));
+    }
+    indices.resize(3 * 4096);
+    for (u32& index : indices)
+        index = std::uniform_int_distribution<u32>(0, 255)(rng);
+    failures += !CheckMesh("random soup", vertices.data(), static_cast<u32>(vertices.size()), indices);
+
+    std::vector<std::string> models;
+    for (const auto& entry : std::filesystem::recursive_directory_iterator("assets/models")) {
+        std::string ext = entry.path().extension().string();
+        if (ext == ".obj" || ext == ".gltf" || ext == ".glb")
+            models.push_back(entry.path().generic_string());
+    }
+    std::sort(models.begin(), models.end());
+
+    // the imported meshes come out optimized already, so their triangles are shuffled to start from a bad order
+    for (const std::string& path : models) {
+        ModelData data;
+        if (!ModelImporter::Import(path, MODEL_IMPORT_FLAGS, data))
+            continue;
+
+        for (u32 i = 0; i < data.meshes.size(); i++) {
+            const MeshData& mesh = data.meshes[i];
+            if (mesh.index_count < 3 || mesh.index_count % 3 != 0)
+                continue;
+
+            indices.assign(data.indices + mesh.first_index, data.indices + mesh.first_index + mesh.index_count);
+            ShuffleTriangles(indices, rng);
+            failures += !CheckMesh(path + " #" + std::to_string(i), data.vertices + mesh.first_vertex,
+                                   mesh.vertex_count, indices);
+        }
+    }
+
+    if (failures > 0)
+        LOG_ERROR("MeshOptimizerCheck: {0} meshes failed", failures);
+    return failures > 0 ? 1 : 0;
+}
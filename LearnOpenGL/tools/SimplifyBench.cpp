@@ -0,0 +1,59 @@
+// Measures MeshSimplifier throughput by halving every mesh of every model under assets/models, and reports the
+// levels of detail the importer generated for them. Run from the repository root.
+
+#include "Log.h"
+#include "MeshSimplifier.h"
+#include "ModelImporter.h"
+#include "Timer.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+int main()
+{
+    Log::Init();
+
+    std::vector<std::string> models;
+    for (const auto& entry : std::filesystem::recursive_directory_iterator("assets/models")) {
+        std::string ext = entry.path().extension().string();
+        if (ext == ".obj" || ext == ".gltf" || ext == ".glb")
+            models.push_back(entry.path().generic_string());
+    }
+    std::sort(models.begin(), models.end());
+
+    LOG_INFO("{0:<60} {1:>10} {2:>10} {3:>10} {4:>12} {5:>8}", "model", "triangles", "halved", "ms", "M tris/s",
+             "levels");
+    for (const std::string& path : models) {
+        ModelData data;
+        if (!ModelImporter::Import(path, MODEL_IMPORT_FLAGS, data))
+            continue;
+
+        u64 triangles = 0;
+        u64 halved = 0;
+        u32 levels = 0;
+        f64 milliseconds = 0.0;
+        std::vector<u32> destination;
+        for (const MeshData& mesh : data.meshes) {
+            levels += static_cast<u32>(mesh.lods.size());
+            if (mesh.index_count < 3 || mesh.index_count % 3 != 0)
+                continue;
+
+            destination.resize(mesh.index_count);
+            f32 error = 0.0f;
+            Timer timer;
+            u32 count = MeshSimplifier::Simplify(destination.data(), data.indices + mesh.first_index,
+                                                 mesh.index_count, data.vertices + mesh.first_vertex,
+                                                 mesh.vertex_count, mesh.index_count / 6 * 3, error);
+            milliseconds += timer.ElapsedMillis();
+            triangles += mesh.index_count / 3;
+            halved += count / 3;
+        }
+
+        LOG_INFO("{0:<60} {1:>10} {2:>10} {3:>10.2f} {4:>12.2f} {5:>8}", path, triangles, halved, milliseconds,
+                 triangles / std::max(milliseconds, 0.001) / 1000.0, levels);
+    }
+
+    return 0;
+}
@@ -0,0 +1,170 @@
+// Cooks the textures under the given directories (assets/models by default) into block-compressed DDS files with
+// a full mip chain. Normal maps (_ddn, _normal) become BC5, images with alpha BC3 and everything else BC1.
+// Run from the repository root. Pass --force to re-cook textures that are already up to date.
+
+#include "BCEncoder.h"
+#include "CompressedTexture.h"
+#include "Log.h"
+#include "MipChain.h"
+#include "ThreadPool.h"
+#include "Timer.h"
+
+#include <stb_image.h>
+
+#include <algorithm>
+#include <atomic>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+namespace
+{
+
+b8 IsImageFile(const std::filesystem::path& path)
+{
+    std::string ext = path.extension().string();
+    std::transform(ext.begin(), ext.end(), ext.begin(), [](unsigned char c) { return std::tolower(c); });
+    return ext == ".tga" || ext == ".png" || ext == ".jpg" || ext == ".jpeg" || ext == ".bmp";
+}
+
+b8 IsNormalMap(const std::string& path)
+{
+    std::string name = std::filesystem::path(path).stem().string();
+    std::transform(name.begin(), name.end(), name.begin(), [](unsigned char c) { return std::tolower(c); });
+    return name.find("_ddn") != std::string::npos || name.find("_normal") != std::string::npos;
+}
+
+struct CookResult
+{
+    std::atomic<u32> cooked{0};
+    std::atomic<u32> failed{0};
+    std::atomic<u64> source_bytes{0};
+    std::atomic<u64> cooked_bytes{0};
+};
+
+void CookTexture(const std::string& path, CookResult& result)
+{
+    Timer timer;
+
+    stbi_set_flip_vertically_on_load_thread(false);
+    i32 width, height, components;
+    u8* pixels = stbi_load(path.c_str(), &width, &height, &components, 4);
+    if (!pixels) {
+        LOG_ERROR("TextureCooker: Failed to load {0}", path);
+        result.failed++;
+        return;
+    }
+
+    b8 normal_map = IsNormalMap(path);
+    b8 has_alpha = false;
+    if (!normal_map && components == 4) {
+        for (u64 i = 0; i < static_cast<u64>(width) * height; i++) {
+            if (pixels[i * 4 + 3] != 255) {
+                has_alpha = true;
+                break;
+            }
+        }
+    }
+
+    BCEncoder::Format format = normal_map ? BCEncoder::BC5 : (has_alpha ? BCEncoder::BC3 : BCEncoder::BC1);
+
+    CompressedImage image;
+    image.format = format == BCEncoder::BC1   ? GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+                   : format == BCEncoder::BC3 ? GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+                                              : GL_COMPRESSED_RG_RGTC2;
+    image.width = width;
+    image.height = height;
+
+    std::vector<u8> level(pixels, pixels + static_cast<u64>(width) * height * 4);
+    stbi_image_free(pixels);
+
+    std::vector<u8> next_level;
+    std::vector<u8> blocks;
+    u32 level_width = width;
+    u32 level_height = height;
+    while (true) {
+        BCEncoder::CompressImage(format, level_width, level_height, level.data(), blocks);
+        image.levels.push_back({level_width, level_height, image.data.size(), blocks.size()});
+        image.data.insert(image.data.end(), blocks.begin(), blocks.end());
+
+        if (level_width == 1 && level_height == 1)
+            break;
+
+        MipChain::Downsample(level_width, level_height, level.data(), normal_map, next_level);
+        level.swap(next_level);
+        level_width = std::max(level_width / 2, 1u);
+        level_height = std::max(level_height / 2, 1u);
+    }
+
+    if (!CompressedTexture::Save(CompressedTexture::GetCookedPath(path), image)) {
+        result.failed++;
+        return;
+    }
+
+    // what the uncompressed upload would take, mips included
+    u64 source_bytes = static_cast<u64>(width) * height * (components == 4 ? 4 : 3) * 4 / 3;
+    result.cooked++;
+    result.source_bytes += source_bytes;
+    result.cooked_bytes += image.data.size();
+
+    const char* format_names[] = {"BC1", "BC3", "BC5"};
+    LOG_TRACE("TextureCooker: {0} {1}x{2} {3} ({4} levels) in {5:.1f} ms", path, width, height, format_names[format],
+              image.levels.size(), timer.ElapsedMillis());
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    Log::Init();
+
+    b8 force = false;
+    std::vector<std::string> roots;
+    for (i32 i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--force")
+            force = true;
+        else
+            roots.push_back(arg);
+    }
+    if (roots.empty())
+        roots.push_back("assets/models");
+
+    std::vector<std::string> textures;
+    for (const std::string& root : roots) {
+        std::error_code ec;
+        for (const auto& entry : std::filesystem::recursive_directory_iterator(root, ec)) {
+            if (!entry.is_regular_file() || !IsImageFile(entry.path()))
+                continue;
+
+            std::string path = entry.path().generic_string();
+            if (force || !CompressedTexture::IsCookedUpToDate(path))
+                textures.push_back(path);
+        }
+    }
+
+    Timer timer;
+    CookResult result;
+    {
+        ThreadPool pool;
+        LOG_INFO("TextureCooker: Cooking {0} textures on {1} threads", textures.size(), pool.GetThreadCount());
+
+        // biggest files first so a large texture does not end up alone at the tail of the queue
+        std::sort(textures.begin(), textures.end(), [](const std::string& a, const std::string& b) {
+            std::error_code ec;
+            return std::filesystem::file_size(a, ec) > std::filesystem::file_size(b, ec);
+        });
+
+        for (const std::string& path : textures) {
+            pool.Submit([path, &result]() { CookTexture(path, result); });
+        }
+        pool.Wait();
+    }
+
+    f64 ratio = result.cooked_bytes > 0 ? static_cast<f64>(result.source_bytes) / result.cooked_bytes : 0.0;
+    LOG_INFO("TextureCooker: {0} cooked, {1} failed in {2:.2f} s, {3:.1f} MB -> {4:.1f} MB ({5:.1f}x smaller)",
+             result.cooked.load(), result.failed.load(), timer.ElapsedMillis() / 1000.0,
+             result.source_bytes / (1024.0 * 1024.0), result.cooked_bytes / (1024.0 * 1024.0), ratio);
+
+    return result.failed > 0 ? 1 : 0;
+}
@@ -0,0 +1,122 @@
+// Measures the CPU cost per draw of setting the per-draw uniforms of the Sponza draw loop three ways: with a
+// glGetUniformLocation call per set, as Shader::SetMat4 and friends did before the uniform table; by name through
+// the table Shader reflects at link time; and through Uniform<T> handles resolved once. Each draw sets a mat4 and
+// the two vec3 bounds of a packed mesh on the depth-only shader, and no geometry is drawn. Opens a hidden window
+// for the GL context. Run from the repository root.
+
+#include "Log.h"
+#include "Shader.h"
+#include "Timer.h"
+
+#include <glad/glad.h>
+
+#include <GLFW/glfw3.h>
+
+#include <algorithm>
+#include <string>
+
+const u32 DRAWS = 100000; // per run, about a hundred frames of Sponza's draw packets
+const u32 RUNS = 5;       // the fastest is reported
+
+// the old path: every set looks the name up in the driver
+static void SetByLocationQuery(const Shader& shader, const glm::mat4& matrix, const glm::vec3& center,
+                               const glm::vec3& extent)
+{
+    glUniformMatrix4fv(glGetUniformLocation(shader.id, "lightViewProjection"), 1, GL_FALSE, glm::value_ptr(matrix));
+    glUniform3fv(glGetUniformLocation(shader.id, "positionCenter"), 1, glm::value_ptr(center));
+    glUniform3fv(glGetUniformLocation(shader.id, "positionExtent"), 1, glm::value_ptr(extent));
+}
+
+static void SetByName(const Shader& shader, const glm::mat4& matrix, const glm::vec3& center,
+                      const glm::vec3& extent)
+{
+    shader.SetMat4("lightViewProjection", matrix);
+    shader.SetVec3("positionCenter", center);
+    shader.SetVec3("positionExtent", extent);
+}
+
+// runs DRAWS draws of set RUNS times, returns the fastest run in ns per draw
+template <typename SetFunction>
+static f64 Measure(const SetFunction& set)
+{
+    f64 best = 0.0;
+    for (u32 run = 0; run < RUNS; run++) {
+        Timer timer;
+        for (u32 draw = 0; draw < DRAWS; draw++) {
+            f32 offset = static_cast<f32>(draw & 255);
+            set(glm::mat4(1.0f + offset), glm::vec3(offset), glm::vec3(1.0f + offset));
+        }
+        glFinish();
+        f64 ns = timer.ElapsedMillis() * 1e6 / DRAWS;
+        best = run == 0 ? ns : std::min(best, ns);
+    }
+    return best;
+}
+
+int main()
+{
+    Log::Init();
+
+    if (!glfwInit()) {
+        LOG_FATAL("UniformBench: Failed to initialize GLFW");
+        return 1;
+    }
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+#ifdef __APPLE__
+    glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+#endif // __APPLE__
+
+    GLFWwindow* window = glfwCreateWindow(64, 64, "UniformBench", NULL, NULL);
+    if (!window) {
+        LOG_FATAL("UniformBench: Failed to create a GL context");
+        glfwTerminate();
+        return 1;
+    }
+    glfwMakeContextCurrent(window);
+    if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
+        LOG_FATAL("UniformBench: Failed to initialize GLAD");
+        glfwTerminate();
+        return 1;
+    }
+
+    Shader shader("assets/shaders/depth_only_vs.glsl", "assets/shaders/depth_only_fs.glsl",
+                  "#define PACKED_VERTEX\n#define SHADOW_CASTER\n");
+    shader.Use();
+
+    Uniform<glm::mat4> matrix_uniform = shader.GetUniform<glm::mat4>("lightViewProjection");
+    Uniform<glm::vec3> center_uniform = shader.GetUniform<glm::vec3>("positionCenter");
+    Uniform<glm::vec3> extent_uniform = shader.GetUniform<glm::vec3>("positionExtent");
+    if (matrix_uniform.location < 0 || center_uniform.location < 0 || extent_uniform.location < 0) {
+        LOG_ERROR("UniformBench: the depth-only shader lacks the benchmarked uniforms");
+        shader.Destroy();
+        glfwTerminate();
+        return 1;
+    }
+
+    f64 query_ns = Measure([&](const glm::mat4& matrix, const glm::vec3& center, const glm::vec3& extent) {
+        SetByLocationQuery(shader, matrix, center, extent);
+    });
+    f64 name_ns = Measure([&](const glm::mat4& matrix, const glm::vec3& center, const glm::vec3& extent) {
+        SetByName(shader, matrix, center, extent);
+    });
+    f64 handle_ns = Measure([&](const glm::mat4& matrix, const glm::vec3& center, const glm::vec3& extent) {
+        shader.Set(matrix_uniform, matrix);
+        shader.Set(center_uniform, center);
+        shader.Set(extent_uniform, extent);
+    });
+
+    LOG_INFO("{0:<40} {1:>12}", "path", "ns/draw");
+    LOG_INFO("{0:<40} {1:>12.1f}", "glGetUniformLocation per set", query_ns);
+    LOG_INFO("{0:<40} {1:>12.1f}", "SetMat4/SetVec3 by name (table)", name_ns);
+    LOG_INFO("{0:<40} {1:>12.1f}", "Uniform<T> handles", handle_ns);
+    LOG_INFO("{0} draws per run, best of {1}, on {2}", DRAWS, RUNS,
+             reinterpret_cast<const char*>(glGetString(GL_RENDERER)));
+
+    shader.Destroy();
+    glfwDestroyWindow(window);
+    glfwTerminate();
+    return 0;
+}
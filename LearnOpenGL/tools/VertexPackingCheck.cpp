@@ -0,0 +1,73 @@
+// Packs every mesh of every model under assets/models into PackedVertex and compares the decoded result against
+// the float vertices. Returns non-zero if any model goes over the error limits. Run from the repository root.
+
+#include "Log.h"
+#include "MeshCache.h"
+#include "ModelImporter.h"
+#include "VertexPacking.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+// limits implied by the encodings, with some headroom
+const f32 MAX_POSITION_ERROR = 1e-4f;   // snorm16, relative to the mesh bounds
+const f32 MAX_NORMAL_ERROR_DEG = 0.05f; // octahedral snorm16
+const f32 MAX_TANGENT_ERROR_DEG = 2.0f; // octahedral snorm8
+const f32 MAX_TEX_COORD_ERROR = 1e-3f;  // half float, relative
+
+int main()
+{
+    Log::Init();
+
+    std::vector<std::string> models;
+    for (const auto& entry : std::filesystem::recursive_directory_iterator("assets/models")) {
+        std::string ext = entry.path().extension().string();
+        if (ext == ".obj" || ext == ".gltf" || ext == ".glb")
+            models.push_back(entry.path().generic_string());
+    }
+    std::sort(models.begin(), models.end());
+
+    b8 failed = false;
+    LOG_INFO("{0:<60} {1:>10} {2:>10} {3:>10} {4:>10} {5:>10} {6:>10}", "model", "float MB", "packed MB",
+             "pos", "normal deg", "tangent deg", "uv");
+    for (const std::string& path : models) {
+        ModelData data;
+        if (!MeshCache::Load(path, MODEL_IMPORT_FLAGS, data)) {
+            if (!ModelImporter::Import(path, MODEL_IMPORT_FLAGS, data))
+                continue;
+            MeshCache::Store(path, MODEL_IMPORT_FLAGS, data);
+        }
+
+        // packed per mesh, like Mesh::SetupPackedMesh
+        VertexPacking::Error error = {0.0f, 0.0f, 0.0f, 0.0f};
+        std::vector<PackedVertex> packed;
+        for (const MeshData& mesh : data.meshes) {
+            const Vertex* vertices = data.vertices + mesh.first_vertex;
+            VertexBounds bounds = VertexPacking::ComputeBounds(vertices, mesh.vertex_count);
+            packed.resize(mesh.vertex_count);
+            VertexPacking::Pack(vertices, mesh.vertex_count, bounds, packed.data());
+
+            VertexPacking::Error mesh_error =
+                VertexPacking::MeasureError(vertices, packed.data(), mesh.vertex_count, bounds);
+            error.max_position = std::max(error.max_position, mesh_error.max_position);
+            error.max_normal_deg = std::max(error.max_normal_deg, mesh_error.max_normal_deg);
+            error.max_tangent_deg = std::max(error.max_tangent_deg, mesh_error.max_tangent_deg);
+            error.max_tex_coord = std::max(error.max_tex_coord, mesh_error.max_tex_coord);
+        }
+
+        LOG_INFO("{0:<60} {1:>10.2f} {2:>10.2f} {3:>10.2e} {4:>10.4f} {5:>10.3f} {6:>10.2e}", path,
+                 data.vertex_count * sizeof(Vertex) / (1024.0 * 1024.0),
+                 data.vertex_count * sizeof(PackedVertex) / (1024.0 * 1024.0), error.max_position,
+                 error.max_normal_deg, error.max_tangent_deg, error.max_tex_coord);
+
+        if (error.max_position > MAX_POSITION_ERROR || error.max_normal_deg > MAX_NORMAL_ERROR_DEG ||
+            error.max_tangent_deg > MAX_TANGENT_ERROR_DEG || error.max_tex_coord > MAX_TEX_COORD_ERROR) {
+            LOG_ERROR("VertexPackingCheck: {0} exceeds the packing error limits", path);
+            failed = true;
+        }
+    }
+
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,125 @@
+#version 330 core
+
+// Lighting pass of the deferred path, see DeferredRenderer.h. Shades like normal_mapping_fs.glsl, from the
+// G-buffer instead of the mesh.
+out vec4 FragColor;
+
+in vec2 ScreenUV;
+
+// per-frame constants, FrameConstants in UniformBuffers.h
+layout (std140) uniform Frame
+{
+    mat4 view;
+    mat4 projection;
+    mat4 viewProjection;
+    vec4 viewPos;
+    vec4 lightPos;
+    vec4 clusterScale; // clusters per pixel in xy, depth slice scale and bias in zw
+    vec4 clusterGrid;  // clusters along xyz, point light count in w
+    mat4 shadowMatrices[4]; // world to cascade clip space
+    vec4 shadowSplits;      // view depth each cascade reaches to, zero with shadows off
+    vec4 shadowTexels;      // world size of a texel of each cascade
+    vec4 sunDirection;      // towards the sun, intensity in w
+};
+
+uniform sampler2D gAlbedoSpecular;
+uniform sampler2D gNormal;
+uniform sampler2D gDepth;
+
+uniform mat4 inverseViewProjection;
+uniform float shininess;
+
+// clustered point lights, see LightManager.h
+uniform samplerBuffer lightData;      // position and radius, color
+uniform usamplerBuffer lightClusters; // first index and count in lightIndices
+uniform usamplerBuffer lightIndices;
+
+// the sun's cascades, see ShadowCascades.h
+uniform sampler2DArrayShadow shadowMap;
+
+vec3 OctDecode(vec2 e)
+{
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    float t = max(-n.z, 0.0);
+    n.x += n.x >= 0.0 ? -t : t;
+    n.y += n.y >= 0.0 ? -t : t;
+    return normalize(n);
+}
+
+// Blinn-Phong from the point lights of this pixel's cluster, fading to zero at each light's radius
+vec3 ShadePointLights(vec3 position, vec3 normal, vec3 color, float specular)
+{
+    vec3 viewDir = normalize(viewPos.xyz - position);
+    float depth = -(view * vec4(position, 1.0)).z;
+
+    ivec3 grid = ivec3(clusterGrid.xyz);
+    ivec2 tile = min(ivec2(gl_FragCoord.xy * clusterScale.xy), grid.xy - 1);
+    int slice = clamp(int(floor(log(max(depth, 1e-4)) * clusterScale.z + clusterScale.w)), 0, grid.z - 1);
+    uvec2 cluster = texelFetch(lightClusters, tile.x + tile.y * grid.x + slice * grid.x * grid.y).xy;
+
+    vec3 result = vec3(0.0);
+    for (uint i = 0u; i < cluster.y; i++) {
+        int light = int(texelFetch(lightIndices, int(cluster.x + i)).x);
+        vec4 positionRadius = texelFetch(lightData, light * 2);
+        vec3 lightColor = texelFetch(lightData, light * 2 + 1).rgb;
+
+        vec3 toLight = positionRadius.xyz - position;
+        float distanceSquared = dot(toLight, toLight);
+        float falloff = clamp(1.0 - pow(distanceSquared / (positionRadius.w * positionRadius.w), 2.0), 0.0, 1.0);
+        float attenuation = falloff * falloff / (distanceSquared + 1.0);
+
+        vec3 lightDir = toLight * inversesqrt(max(distanceSquared, 1e-8));
+        float diff = max(dot(lightDir, normal), 0.0);
+        float spec = pow(max(dot(normal, normalize(lightDir + viewDir)), 0.0), shininess);
+        result += (diff * color + specular * spec) * lightColor * attenuation;
+    }
+    return result;
+}
+
+// 1 where the sun reaches position, 0 in its shadow; the depth comparison filters 2x2 texels
+float SunShadow(vec3 position, vec3 normal)
+{
+    float depth = -(view * vec4(position, 1.0)).z;
+    int cascade = 0;
+    while (cascade < 4 && depth > shadowSplits[cascade])
+        cascade++;
+    if (cascade == 4)
+        return 1.0;
+
+    // pushed off the surface by a texel and a half, so it doesn't shadow itself where the sun grazes it
+    vec3 offset = normal * shadowTexels[cascade] * 1.5;
+    vec3 coord = (shadowMatrices[cascade] * vec4(position + offset, 1.0)).xyz * 0.5 + 0.5;
+    return texture(shadowMap, vec4(coord.xy, float(cascade), coord.z));
+}
+
+void main(){
+    ivec2 texel = ivec2(gl_FragCoord.xy);
+    float depth = texelFetch(gDepth, texel, 0).r;
+    if (depth == 1.0)
+        discard;
+
+    // world position back from the depth buffer
+    vec4 clip = vec4(ScreenUV * 2.0 - 1.0, depth * 2.0 - 1.0, 1.0);
+    vec4 world = inverseViewProjection * clip;
+    vec3 position = world.xyz / world.w;
+
+    vec4 albedoSpecular = texelFetch(gAlbedoSpecular, texel, 0);
+    vec3 color = albedoSpecular.rgb;
+    vec3 normal = OctDecode(texelFetch(gNormal, texel, 0).rg * 2.0 - 1.0);
+
+    // the key light, as the forward path shades it in tangent space
+    vec3 ambient = 0.1 * color;
+    vec3 lightDir = normalize(lightPos.xyz - position);
+    vec3 diffuse = max(dot(lightDir, normal), 0.0) * color;
+    vec3 viewDir = normalize(viewPos.xyz - position);
+    float spec = pow(max(dot(normal, normalize(lightDir + viewDir)), 0.0), shininess);
+    vec3 specular = vec3(albedoSpecular.a * spec);
+
+    vec3 points = ShadePointLights(position, normal, color, albedoSpecular.a);
+
+    float sunDiff = max(dot(normal, sunDirection.xyz), 0.0);
+    float sunSpec = pow(max(dot(normal, normalize(sunDirection.xyz + viewDir)), 0.0), shininess);
+    vec3 sun = (sunDiff * color + albedoSpecular.a * sunSpec) * sunDirection.w * SunShadow(position, normal);
+
+    FragColor = vec4(ambient + diffuse + specular + points + sun, 1.0);
+}
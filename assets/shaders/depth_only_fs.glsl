@@ -0,0 +1,5 @@
+#version 330 core
+
+// nothing to shade, the pass only writes depth
+void main() {
+}
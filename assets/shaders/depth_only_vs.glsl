@@ -0,0 +1,58 @@
+#version 330 core
+
+// Depth pre-pass over GeometryArena's position-only stream. The position math must match normal_mapping_vs.glsl
+// step for step, so the shading pass can test against these depths with GL_EQUAL. Built with SHADOW_CASTER it
+// draws into a shadow cascade instead, see ShadowCascades.h.
+
+#ifdef PACKED_VERTEX
+layout (location = 0) in vec4 aPackedPos; // snorm16 inside the mesh bounds, w = bitangent sign
+
+uniform vec3 positionCenter;
+uniform vec3 positionExtent;
+#else
+layout (location = 0) in vec3 aPos;
+#endif
+
+// per-frame constants, FrameConstants in UniformBuffers.h
+layout (std140) uniform Frame
+{
+    mat4 view;
+    mat4 projection;
+    mat4 viewProjection;
+    vec4 viewPos;
+    vec4 lightPos;
+    vec4 clusterScale; // clusters per pixel in xy, depth slice scale and bias in zw
+    vec4 clusterGrid;  // clusters along xyz, point light count in w
+    mat4 shadowMatrices[4]; // world to cascade clip space
+    vec4 shadowSplits;      // view depth each cascade reaches to, zero with shadows off
+    vec4 shadowTexels;      // world size of a texel of each cascade
+    vec4 sunDirection;      // towards the sun, intensity in w
+};
+
+// per-object constants, ObjectConstants in UniformBuffers.h
+layout (std140) uniform Object
+{
+    mat4 model;
+    mat3 normalMatrix;
+};
+
+#ifdef SHADOW_CASTER
+uniform mat4 lightViewProjection;
+#endif
+
+invariant gl_Position;
+
+void main() {
+#ifdef PACKED_VERTEX
+    vec3 position = positionCenter + positionExtent * (aPackedPos.xyz / 32767.0);
+#else
+    vec3 position = aPos;
+#endif
+
+    vec3 fragPos = vec3(model * vec4(position, 1.0));
+#ifdef SHADOW_CASTER
+    gl_Position = lightViewProjection * vec4(fragPos, 1.0);
+#else
+    gl_Position = viewProjection * vec4(fragPos, 1.0);
+#endif
+}
@@ -0,0 +1,37 @@
+#version 330 core
+
+// G-buffer fill for the deferred path, see DeferredRenderer.h. Runs after normal_mapping_vs.glsl.
+layout (location = 0) out vec4 gAlbedoSpecular; // albedo, specular strength
+layout (location = 1) out vec2 gNormal;         // world-space normal, octahedral in [0, 1]
+
+struct Material {
+    sampler2D texture_diffuse1;
+    sampler2D texture_specular1;
+    sampler2D texture_normal1;
+    float shininess;
+};
+
+in vec2 TexCoords;
+in mat3 TangentToWorld;
+
+uniform Material material;
+
+vec2 OctEncode(vec3 n)
+{
+    n /= abs(n.x) + abs(n.y) + abs(n.z);
+    vec2 e = n.xy;
+    if (n.z < 0.0)
+        e = (1.0 - abs(n.yx)) * vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+    return e;
+}
+
+void main(){
+    // rebuild z from xy so two-channel (BC5) normal maps work the same as RGB ones
+    vec3 normal;
+    normal.xy = texture(material.texture_normal1, TexCoords).rg * 2.0 - 1.0;
+    normal.z = sqrt(max(1.0 - dot(normal.xy, normal.xy), 0.0));
+
+    // the same constant specular strength as normal_mapping_fs.glsl
+    gAlbedoSpecular = vec4(texture(material.texture_diffuse1, TexCoords).rgb, 0.2);
+    gNormal = OctEncode(normalize(TangentToWorld * normal)) * 0.5 + 0.5;
+}
@@ -2,10 +2,29 @@
 
 layout(location = 0) in vec3 aPos;
 
-uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+// per-frame constants, FrameConstants in UniformBuffers.h
+layout (std140) uniform Frame
+{
+    mat4 view;
+    mat4 projection;
+    mat4 viewProjection;
+    vec4 viewPos;
+    vec4 lightPos;
+    vec4 clusterScale; // clusters per pixel in xy, depth slice scale and bias in zw
+    vec4 clusterGrid;  // clusters along xyz, point light count in w
+    mat4 shadowMatrices[4]; // world to cascade clip space
+    vec4 shadowSplits;      // view depth each cascade reaches to, zero with shadows off
+    vec4 shadowTexels;      // world size of a texel of each cascade
+    vec4 sunDirection;      // towards the sun, intensity in w
+};
+
+// per-object constants, ObjectConstants in UniformBuffers.h
+layout (std140) uniform Object
+{
+    mat4 model;
+    mat3 normalMatrix;
+};
 
 void main() {
-    gl_Position = projection * view * model * vec4(aPos, 1.0);
+    gl_Position = viewProjection * model * vec4(aPos, 1.0);
 }
@@ -8,14 +8,33 @@ out vec3 FragPos;
 out vec3 Normal;
 out vec2 TexCoords;
 
-uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+// per-frame constants, FrameConstants in UniformBuffers.h
+layout (std140) uniform Frame
+{
+    mat4 view;
+    mat4 projection;
+    mat4 viewProjection;
+    vec4 viewPos;
+    vec4 lightPos;
+    vec4 clusterScale; // clusters per pixel in xy, depth slice scale and bias in zw
+    vec4 clusterGrid;  // clusters along xyz, point light count in w
+    mat4 shadowMatrices[4]; // world to cascade clip space
+    vec4 shadowSplits;      // view depth each cascade reaches to, zero with shadows off
+    vec4 shadowTexels;      // world size of a texel of each cascade
+    vec4 sunDirection;      // towards the sun, intensity in w
+};
+
+// per-object constants, ObjectConstants in UniformBuffers.h
+layout (std140) uniform Object
+{
+    mat4 model;
+    mat3 normalMatrix;
+};
 
 void main()
 {
-    gl_Position = projection * view * model * vec4(aPos, 1.0);
     FragPos = vec3(model * vec4(aPos, 1.0));
-    Normal = mat3(transpose(inverse(model))) * aNormal;
+    Normal = normalMatrix * aNormal;
+    gl_Position = viewProjection * vec4(FragPos, 1.0);
     TexCoords = aTexCoords;
 }
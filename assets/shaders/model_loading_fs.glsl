@@ -47,7 +47,22 @@ in vec3 FragPos;
 in vec3 Normal;
 in vec2 TexCoords;
 
-uniform vec3 view_pos;
+// per-frame constants, FrameConstants in UniformBuffers.h
+layout (std140) uniform Frame
+{
+    mat4 view;
+    mat4 projection;
+    mat4 viewProjection;
+    vec4 viewPos;
+    vec4 lightPos;
+    vec4 clusterScale; // clusters per pixel in xy, depth slice scale and bias in zw
+    vec4 clusterGrid;  // clusters along xyz, point light count in w
+    mat4 shadowMatrices[4]; // world to cascade clip space
+    vec4 shadowSplits;      // view depth each cascade reaches to, zero with shadows off
+    vec4 shadowTexels;      // world size of a texel of each cascade
+    vec4 sunDirection;      // towards the sun, intensity in w
+};
+
 uniform DirLight dir_light;
 uniform PointLight point_lights[NR_POINT_LIGHTS];
 uniform SpotLight spot_light;
@@ -65,7 +80,7 @@ void main()
 
     // properties
     vec3 norm = normalize(Normal);
-    vec3 view_dir = normalize(view_pos - FragPos);
+    vec3 view_dir = normalize(viewPos.xyz - FragPos);
 
     // Phase 1: Directional Lighting
     result += calc_dir_light(dir_light, norm, view_dir);
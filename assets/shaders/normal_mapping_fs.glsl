@@ -14,15 +14,85 @@ in vec2 TexCoords;
 in vec3 TangentLightPos;
 in vec3 TangentViewPos;
 in vec3 TangentFragPos;
+in mat3 TangentToWorld;
+
+// per-frame constants, FrameConstants in UniformBuffers.h
+layout (std140) uniform Frame
+{
+    mat4 view;
+    mat4 projection;
+    mat4 viewProjection;
+    vec4 viewPos;
+    vec4 lightPos;
+    vec4 clusterScale; // clusters per pixel in xy, depth slice scale and bias in zw
+    vec4 clusterGrid;  // clusters along xyz, point light count in w
+    mat4 shadowMatrices[4]; // world to cascade clip space
+    vec4 shadowSplits;      // view depth each cascade reaches to, zero with shadows off
+    vec4 shadowTexels;      // world size of a texel of each cascade
+    vec4 sunDirection;      // towards the sun, intensity in w
+};
 
 uniform Material material;
 
-uniform vec3 lightPos;
-uniform vec3 viewPos;
+// clustered point lights, see LightManager.h
+uniform samplerBuffer lightData;      // position and radius, color
+uniform usamplerBuffer lightClusters; // first index and count in lightIndices
+uniform usamplerBuffer lightIndices;
+
+// the sun's cascades, see ShadowCascades.h
+uniform sampler2DArrayShadow shadowMap;
+
+// Blinn-Phong from the point lights of this fragment's cluster, fading to zero at each light's radius
+vec3 ShadePointLights(vec3 normal, vec3 color)
+{
+    vec3 viewDir = normalize(viewPos.xyz - FragPos);
+    float depth = -(view * vec4(FragPos, 1.0)).z;
+
+    ivec3 grid = ivec3(clusterGrid.xyz);
+    ivec2 tile = min(ivec2(gl_FragCoord.xy * clusterScale.xy), grid.xy - 1);
+    int slice = clamp(int(floor(log(max(depth, 1e-4)) * clusterScale.z + clusterScale.w)), 0, grid.z - 1);
+    uvec2 cluster = texelFetch(lightClusters, tile.x + tile.y * grid.x + slice * grid.x * grid.y).xy;
+
+    vec3 result = vec3(0.0);
+    for (uint i = 0u; i < cluster.y; i++) {
+        int light = int(texelFetch(lightIndices, int(cluster.x + i)).x);
+        vec4 positionRadius = texelFetch(lightData, light * 2);
+        vec3 lightColor = texelFetch(lightData, light * 2 + 1).rgb;
+
+        vec3 toLight = positionRadius.xyz - FragPos;
+        float distanceSquared = dot(toLight, toLight);
+        float falloff = clamp(1.0 - pow(distanceSquared / (positionRadius.w * positionRadius.w), 2.0), 0.0, 1.0);
+        float attenuation = falloff * falloff / (distanceSquared + 1.0);
+
+        vec3 lightDir = toLight * inversesqrt(max(distanceSquared, 1e-8));
+        float diff = max(dot(lightDir, normal), 0.0);
+        float spec = pow(max(dot(normal, normalize(lightDir + viewDir)), 0.0), material.shininess);
+        result += (diff * color + 0.2 * spec) * lightColor * attenuation;
+    }
+    return result;
+}
+
+// 1 where the sun reaches position, 0 in its shadow; the depth comparison filters 2x2 texels
+float SunShadow(vec3 position, vec3 normal)
+{
+    float depth = -(view * vec4(position, 1.0)).z;
+    int cascade = 0;
+    while (cascade < 4 && depth > shadowSplits[cascade])
+        cascade++;
+    if (cascade == 4)
+        return 1.0;
+
+    // pushed off the surface by a texel and a half, so it doesn't shadow itself where the sun grazes it
+    vec3 offset = normal * shadowTexels[cascade] * 1.5;
+    vec3 coord = (shadowMatrices[cascade] * vec4(position + offset, 1.0)).xyz * 0.5 + 0.5;
+    return texture(shadowMap, vec4(coord.xy, float(cascade), coord.z));
+}
 
 void main(){
-    vec3 normal = texture(material.texture_normal1, TexCoords).rgb;
-    normal = normalize(normal * 2.0 - 1.0);
+    // rebuild z from xy so two-channel (BC5) normal maps work the same as RGB ones
+    vec3 normal;
+    normal.xy = texture(material.texture_normal1, TexCoords).rg * 2.0 - 1.0;
+    normal.z = sqrt(max(1.0 - dot(normal.xy, normal.xy), 0.0));
 
     vec3 color = texture(material.texture_diffuse1, TexCoords).rgb;
 
@@ -41,5 +111,14 @@ void main(){
     float spec = pow(max(dot(normal, halfwayDir), 0.0), material.shininess);
     vec3 specular = vec3(0.2 * spec);
 
-    FragColor = vec4(ambient + diffuse + specular, 1.0);
+    vec3 worldNormal = normalize(TangentToWorld * normal);
+    vec3 points = ShadePointLights(worldNormal, color);
+
+    // the sun, Blinn-Phong in world space like the point lights
+    vec3 worldViewDir = normalize(viewPos.xyz - FragPos);
+    float sunDiff = max(dot(worldNormal, sunDirection.xyz), 0.0);
+    float sunSpec = pow(max(dot(worldNormal, normalize(sunDirection.xyz + worldViewDir)), 0.0), material.shininess);
+    vec3 sun = (sunDiff * color + 0.2 * sunSpec) * sunDirection.w * SunShadow(FragPos, worldNormal);
+
+    FragColor = vec4(ambient + diffuse + specular + points + sun, 1.0);
 }
@@ -2,39 +2,105 @@
 
 #extension GL_ARB_explicit_uniform_location : enable
 
+#ifdef PACKED_VERTEX
+// PackedVertex, see VertexPacking.h. The integer attributes arrive unnormalized.
+layout (location = 0) in vec4 aPackedPos;     // snorm16 inside the mesh bounds, w = bitangent sign
+layout (location = 1) in vec2 aPackedNormal;  // octahedral snorm16
+layout (location = 2) in vec2 aTexCoords;     // half float
+layout (location = 3) in vec2 aPackedTangent; // octahedral snorm8
+
+uniform vec3 positionCenter;
+uniform vec3 positionExtent;
+
+vec3 OctDecode(vec2 e)
+{
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    float t = max(-n.z, 0.0);
+    n.x += n.x >= 0.0 ? -t : t;
+    n.y += n.y >= 0.0 ? -t : t;
+    return normalize(n);
+}
+#else
 layout (location = 0) in vec3 aPos;
 layout (location = 1) in vec3 aNormal;
 layout (location = 2) in vec2 aTexCoords;
 layout (location = 3) in vec3 aTangent;
 layout (location = 4) in vec3 aBitangent;
+#endif
+
+#ifdef INSTANCED
+// ObjectConstants per instance, see InstanceBuffer.h
+layout (location = 5) in mat4 aInstanceModel;
+layout (location = 9) in mat3 aInstanceNormalMatrix;
+#endif
 
 out vec3 FragPos;
 out vec2 TexCoords;
 out vec3 TangentLightPos;
 out vec3 TangentViewPos;
 out vec3 TangentFragPos;
+out mat3 TangentToWorld; // for the point lights, which are shaded in world space
 
-uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+// per-frame constants, FrameConstants in UniformBuffers.h
+layout (std140) uniform Frame
+{
+    mat4 view;
+    mat4 projection;
+    mat4 viewProjection;
+    vec4 viewPos;
+    vec4 lightPos;
+    vec4 clusterScale; // clusters per pixel in xy, depth slice scale and bias in zw
+    vec4 clusterGrid;  // clusters along xyz, point light count in w
+    mat4 shadowMatrices[4]; // world to cascade clip space
+    vec4 shadowSplits;      // view depth each cascade reaches to, zero with shadows off
+    vec4 shadowTexels;      // world size of a texel of each cascade
+    vec4 sunDirection;      // towards the sun, intensity in w
+};
 
-uniform vec3 lightPos;
-uniform vec3 viewPos;
+// per-object constants, ObjectConstants in UniformBuffers.h
+layout (std140) uniform Object
+{
+    mat4 model;
+    mat3 normalMatrix;
+};
+
+// depth_only_vs.glsl computes the same position for the depth pre-pass
+invariant gl_Position;
 
 void main(){
-    FragPos = vec3(model * vec4(aPos, 1.0));
+#ifdef PACKED_VERTEX
+    vec3 position = positionCenter + positionExtent * (aPackedPos.xyz / 32767.0);
+    vec3 normal = OctDecode(aPackedNormal / 32767.0);
+    vec3 tangent = OctDecode(aPackedTangent / 127.0);
+    float handedness = aPackedPos.w < 0.0 ? -1.0 : 1.0;
+#else
+    vec3 position = aPos;
+    vec3 normal = aNormal;
+    vec3 tangent = aTangent;
+    float handedness = dot(cross(aNormal, aTangent), aBitangent) < 0.0 ? -1.0 : 1.0;
+#endif
+
+#ifdef INSTANCED
+    mat4 modelMatrix = aInstanceModel;
+    mat3 normalTransform = aInstanceNormalMatrix;
+#else
+    mat4 modelMatrix = model;
+    mat3 normalTransform = normalMatrix;
+#endif
+
+    FragPos = vec3(modelMatrix * vec4(position, 1.0));
     TexCoords = aTexCoords;
 
-    mat3 normal_matrix = transpose(inverse(mat3(model)));
-    vec3 T = normalize(normal_matrix * aTangent);
-    vec3 N = normalize(normal_matrix * aNormal);
+    vec3 T = normalize(normalTransform * tangent);
+    vec3 N = normalize(normalTransform * normal);
     T = normalize(T - dot(T, N) * N);
-    vec3 B = cross(N, T);
+    vec3 B = cross(N, T) * handedness;
 
-    mat3 TBN = transpose(mat3(T, B, N));
-    TangentLightPos = TBN * lightPos;
-    TangentViewPos = TBN * viewPos;
+    TangentToWorld = mat3(T, B, N);
+    mat3 TBN = transpose(TangentToWorld);
+    TangentLightPos = TBN * lightPos.xyz;
+    TangentViewPos = TBN * viewPos.xyz;
     TangentFragPos = TBN * FragPos;
 
-    gl_Position = projection * view * model * vec4(aPos, 1.0);
+    gl_Position = viewProjection * vec4(FragPos, 1.0);
 }
@@ -0,0 +1,8 @@
+#version 330 core
+
+// color writes are masked off, only the samples passing the depth test matter
+out vec4 frag_color;
+
+void main() {
+    frag_color = vec4(1.0);
+}
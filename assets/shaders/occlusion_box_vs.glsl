@@ -0,0 +1,27 @@
+#version 330 core
+
+// corners of the unit cube, scaled into the tested world-space box
+layout(location = 0) in vec3 aPos;
+
+// per-frame constants, FrameConstants in UniformBuffers.h
+layout (std140) uniform Frame
+{
+    mat4 view;
+    mat4 projection;
+    mat4 viewProjection;
+    vec4 viewPos;
+    vec4 lightPos;
+    vec4 clusterScale; // clusters per pixel in xy, depth slice scale and bias in zw
+    vec4 clusterGrid;  // clusters along xyz, point light count in w
+    mat4 shadowMatrices[4]; // world to cascade clip space
+    vec4 shadowSplits;      // view depth each cascade reaches to, zero with shadows off
+    vec4 shadowTexels;      // world size of a texel of each cascade
+    vec4 sunDirection;      // towards the sun, intensity in w
+};
+
+uniform vec3 boxCenter;
+uniform vec3 boxExtent;
+
+void main() {
+    gl_Position = viewProjection * vec4(boxCenter + aPos * boxExtent, 1.0);
+}